@@ -0,0 +1,60 @@
+#-------------------------------------------------
+#
+# Headless export benchmark: builds synthetic projects, exports them, and compares the
+# results against a stored baseline. See benchmarks/encodebenchmark.cpp for the options.
+#
+#-------------------------------------------------
+
+QT       += core gui multimedia multimediawidgets widgets concurrent
+
+TARGET = encode_benchmark
+TEMPLATE = app
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+INCLUDEPATH += $$PWD
+
+SOURCES += benchmarks/encodebenchmark.cpp \
+           benchmarks/benchmarkutils.cpp \
+           movie.cpp \
+           projectcatalog.cpp \
+           soundeffect.cpp \
+           avcodecwrapper.cpp \
+           utils.cpp \
+           settings.cpp \
+           audioinputstream.cpp \
+           audiojoiner.cpp \
+           packetwriter.cpp \
+           encodedsegment.cpp \
+           encodestatistics.cpp \
+           streamcapture.cpp \
+           videoframeconverter.cpp \
+           imagewriter.cpp \
+           frametable.cpp
+
+HEADERS  += benchmarks/benchmarkutils.h \
+            movie.h \
+            projectcatalog.h \
+            soundeffect.h \
+            avcodecwrapper.h \
+            utils.h \
+            settings.h \
+            audioinputstream.h \
+            audiojoiner.h \
+            packetwriter.h \
+            encodedsegment.h \
+            encodestatistics.h \
+            streamcapture.h \
+            videoframeconverter.h \
+            spscqueue.h \
+            imagewriter.h \
+            frametable.h \
+            plsexception.h \
+            avexception.h
+
+include(ffmpeg.pri)
+
+win32: LIBS += -lpsapi
@@ -0,0 +1,36 @@
+#-------------------------------------------------
+#
+# Peak extraction microbenchmark: compares the SIMD peak kernels with the old per-sample
+# waveform loop, against a stored baseline. See benchmarks/peakbenchmark.cpp for the details.
+#
+#-------------------------------------------------
+
+QT       += core gui multimedia concurrent
+
+TARGET = peak_benchmark
+TEMPLATE = app
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+INCLUDEPATH += $$PWD
+
+SOURCES += benchmarks/peakbenchmark.cpp \
+           benchmarks/benchmarkutils.cpp \
+           peakkernel.cpp \
+           peakpyramid.cpp \
+           utils.cpp \
+           settings.cpp \
+           imagewriter.cpp
+
+HEADERS  += benchmarks/benchmarkutils.h \
+            peakkernel.h \
+            peakpyramid.h \
+            utils.h \
+            settings.h \
+            imagewriter.h \
+            plsexception.h
+
+win32: LIBS += -lpsapi
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui multimedia multimediawidgets widgets
+QT       += core gui multimedia multimediawidgets widgets concurrent
 
 TARGET = Stop_Motion_Creator
 TEMPLATE = app
@@ -12,6 +12,7 @@ TEMPLATE = app
 CONFIG += c++17
 
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+#DEFINES += LOG_ENCODER                             # per-frame debug output from the encoder
 
 
 SOURCES += main.cpp \
@@ -24,18 +25,34 @@ SOURCES += main.cpp \
            avcodecwrapper.cpp \
            utils.cpp \
            waveform.cpp \
+           peakpyramid.cpp \
+           peakkernel.cpp \
+           waveformloader.cpp \
+           soundeffecttimeline.cpp \
+           streamcapture.cpp \
+           imagewriter.cpp \
+           frametable.cpp \
+           viewfinderwidget.cpp \
+           videoframeconverter.cpp \
+           startuptimer.cpp \
            savefinalmoviedialog.cpp \
-           previousframeoverlayeffect.cpp \
            frameeditor.cpp \
            frame.cpp \
            settings.cpp \
            audioinputstream.cpp \
            audiojoiner.cpp \
+           packetwriter.cpp \
+           encodedsegment.cpp \
+           encodestatistics.cpp \
+           batchexporter.cpp \
            multiregionwaveform.cpp \
            variableselectionwaveform.cpp \
            soundselectiondialog.cpp \
            movieframeslider.cpp \
            addtopreviousmoviedialog.cpp \
+           projectcatalog.cpp \
+           projectlistmodel.cpp \
+           thumbnailloader.cpp \
            cameramonitor.cpp \
     importprogressdialog.cpp \
     soundeffectlistdialog.cpp
@@ -49,13 +66,27 @@ HEADERS  += stopmotionanimation.h \
             avcodecwrapper.h \
             utils.h \
             waveform.h \
+            peakpyramid.h \
+            peakkernel.h \
+            waveformloader.h \
+            soundeffecttimeline.h \
+            streamcapture.h \
+            imagewriter.h \
+            frametable.h \
+            viewfinderwidget.h \
+            videoframeconverter.h \
+            startuptimer.h \
+            spscqueue.h \
             savefinalmoviedialog.h \
-            previousframeoverlayeffect.h \
             frameeditor.h \
             frame.h \
             settings.h \
             audioinputstream.h \
             audiojoiner.h  \
+            packetwriter.h \
+            encodedsegment.h \
+            encodestatistics.h \
+            batchexporter.h \
             plsexception.h \
             avexception.h \
             multiregionwaveform.h \
@@ -63,6 +94,9 @@ HEADERS  += stopmotionanimation.h \
             soundselectiondialog.h \
             movieframeslider.h \
             addtopreviousmoviedialog.h \
+            projectcatalog.h \
+            projectlistmodel.h \
+            thumbnailloader.h \
             cameramonitor.h \
     importprogressdialog.h \
     soundeffectlistdialog.h
@@ -88,40 +122,10 @@ GIT_TIMESTAMP = $$system($$quote(git log -n 1 --format=format:"%at"))
 
 QMAKE_SUBSTITUTES += $$PWD/version.h.in
 
-win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lavutil
-
-INCLUDEPATH += $$PWD/../ffmpeg/win64/include
-DEPENDPATH += $$PWD/../ffmpeg/win64/include
-
-win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/avutil.lib
-else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libavutil.a
-
-win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lavcodec
-
-win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/avcodec.lib
-else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libavcodec.a
-
-win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lavformat
-
-win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/avformat.lib
-else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libavformat.a
-
-win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lavfilter
-
-win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/avfilter.lib
-else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libavfilter.a
-
-win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lswscale
-
-win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/swscale.lib
-else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libswscale.a
-
-win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lswresample
-
-win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/swresample.lib
-else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libswresample.a
+include(ffmpeg.pri)
 
 DISTFILES += \
     StopMotionAnimation.rc \
-    version.h.in
+    version.h.in \
+    ffmpeg.pri
 
@@ -1,15 +1,22 @@
 #include "addtopreviousmoviedialog.h"
 #include "ui_addtopreviousmoviedialog.h"
 
-#include "settings.h"
-
-#include <QDir>
+static const QSize PREVIEW_SIZE (640, 480);
+static const int PREVIEW_CACHE_KILOBYTES = 64 * 1024;
 
 AddToPreviousMovieDialog::AddToPreviousMovieDialog(QWidget *parent) :
     QDialog(parent),
-    ui(new Ui::AddToPreviousMovieDialog)
+    ui(new Ui::AddToPreviousMovieDialog),
+    _framePreviews (PREVIEW_SIZE, PREVIEW_CACHE_KILOBYTES)
 {
     ui->setupUi(this);
+    ui->treeView->setModel(&_projects);
+    ui->treeView->setIconSize(QSize(64, 48));
+    ui->treeView->setUniformRowHeights(true);
+    connect (ui->treeView->selectionModel(), &QItemSelectionModel::selectionChanged,
+             this, &AddToPreviousMovieDialog::projectSelectionChanged);
+    connect (&_framePreviews, &ThumbnailLoader::thumbnailReady,
+             this, &AddToPreviousMovieDialog::framePreviewReady);
 }
 
 
@@ -22,92 +29,25 @@ void AddToPreviousMovieDialog::showEvent(QShowEvent *)
 
 void AddToPreviousMovieDialog::Reset ()
 {
-    _itemToMovieMap.clear();
-    for (int i = 0; i < ui->treeWidget->topLevelItemCount(); i++) {
-        QTreeWidgetItem *tli = ui->treeWidget->topLevelItem(i);
-        qDeleteAll (tli->takeChildren());
-    }
-
-    Settings settings;
-    QString imageStorageLocation = settings.Get("settings/imageStorageLocation").toString();
-    QString imageFilenameFormat = settings.Get("settings/imageFilenameFormat").toString();
-
-    // Find all the files that match the appropriate pattern:
-    // imageStorageLocation/timestamp/timestamp.json
-
-    QDir dir (imageStorageLocation);
-    dir.setSorting(QDir::Name | QDir::Reversed);
-    if (dir.isReadable()) {
-        auto entryList = dir.entryList(QDir::Dirs);
-        for (auto entry : entryList) {
-            QDateTime timestamp (QDateTime::fromString(entry, imageFilenameFormat));
-            if (timestamp.isValid()) {
-                QDir subdir (imageStorageLocation + entry);
-                if (subdir.isReadable()) {
-                    QString filename (imageStorageLocation + entry + "/" + entry + ".json");
-                    std::shared_ptr<Movie> movie = std::shared_ptr<Movie> (new Movie(entry, false));
-                    bool loaded = movie->load (filename);
-                    if (loaded) {
-                        QStringList columns;
-                        QString niceDate = timestamp.toString("MMMM d");
-                        if (timestamp.daysTo(QDateTime::currentDateTime()) > 365) {
-                            niceDate = timestamp.date().toString(Qt::SystemLocaleLongDate);
-                        }
-                        QString niceTime = timestamp.toLocalTime().time().toString(Qt::SystemLocaleShortDate);
-                        QString nFrames = QString::number(movie->getNumberOfFrames());
-                        columns.append (niceDate);
-                        columns.append (niceTime);
-                        columns.append (nFrames);
-                        // 0 -Today
-                        // 1 - Yesterday
-                        // 2 - This week (assume the week started on Monday)
-                        // 3 - Last week (really, to the previous Monday)
-                        // 4 - Earlier
-                        int insertionItem;
-                        int daysToToday = int(abs(timestamp.daysTo(QDateTime::currentDateTime())));
-                        int daysToMonday = QDate::currentDate().dayOfWeek() - 1;
-                        if (daysToToday <= 0) {
-                            insertionItem = 0;
-                        } else if (daysToToday == 1) {
-                            insertionItem = 1;
-                        } else if (daysToToday <= daysToMonday) {
-                            insertionItem = 2;
-                        } else if (daysToToday < daysToMonday+7) {
-                            insertionItem = 3;
-                        } else {
-                            insertionItem = 4;
-                        }
-                        QTreeWidgetItem *item = new QTreeWidgetItem(ui->treeWidget->topLevelItem(insertionItem), columns);
-                        _itemToMovieMap[item] = movie;
-                    }
-                }
-            }
-        }
-    }
-
-    bool foundFirst = false;
-    for (int i = 0; i < ui->treeWidget->topLevelItemCount(); i++) {
-        QTreeWidgetItem *tli = ui->treeWidget->topLevelItem(i);
-        if (tli->childCount() == 0) {
-            tli->setHidden (true);
-        } else {
-            tli->setHidden (false);
-            tli->setSelected(false);
-            for (int child = 0; child < tli->childCount(); child++) {
-                if (!foundFirst) {
-                    foundFirst = true;
-                    ui->treeWidget->expandItem(tli);
-                    tli->child(child)->setSelected(true);
-                } else {
-                    tli->child(child)->setSelected(false);
-                }
-            }
-        }
+    _selectedMovie.reset();
+    _framePreviews.CancelPending();
+    _requestedFrame.clear();
+
+    // The catalog has every project in imageStorageLocation/timestamp/timestamp.json, newest first
+    ProjectCatalog catalog;
+    _projects.setProjects(catalog.GetProjects());
+
+    QModelIndex first = _projects.firstProject();
+    if (first.isValid()) {
+        ui->treeView->expand(first.parent());
+        ui->treeView->selectionModel()->select(first, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+    } else {
+        projectSelectionChanged(QItemSelection(), QItemSelection());
     }
 
-    ui->treeWidget->resizeColumnToContents(0);
-    ui->treeWidget->resizeColumnToContents(1);
-    ui->treeWidget->resizeColumnToContents(2);
+    ui->treeView->resizeColumnToContents(0);
+    ui->treeView->resizeColumnToContents(1);
+    ui->treeView->resizeColumnToContents(2);
 }
 
 AddToPreviousMovieDialog::~AddToPreviousMovieDialog()
@@ -117,51 +57,79 @@ AddToPreviousMovieDialog::~AddToPreviousMovieDialog()
 
 QString AddToPreviousMovieDialog::getSelectedMovie() const
 {
-    auto selection = ui->treeWidget->selectedItems();
-    if (selection.size() == 1) {
-        ui->horizontalSlider->setMinimum(1);
-        auto itr = _itemToMovieMap.find (selection[0]);
-        if (itr != _itemToMovieMap.end()) {
-            return itr->second->getSaveFilename();
-        }
+    QModelIndex selection = getSelectedProject();
+    if (selection.isValid()) {
+        return _projects.getProject(selection).saveFilename;
     }
     return QString ();
 }
 
-void AddToPreviousMovieDialog::on_treeWidget_itemSelectionChanged()
+QModelIndex AddToPreviousMovieDialog::getSelectedProject () const
+{
+    auto selection = ui->treeView->selectionModel()->selectedRows();
+    if (selection.size() == 1 && _projects.isProject(selection[0])) {
+        return selection[0];
+    }
+    return QModelIndex();
+}
+
+void AddToPreviousMovieDialog::projectSelectionChanged(const QItemSelection &, const QItemSelection &)
 {
-    // Hook up to the movie to show the frames:
+    // Nothing queued for the previous movie matters any more
+    _framePreviews.CancelPending();
+    _requestedFrame.clear();
+    _selectedMovie.reset();
+
     ui->frameLabel->setPixmap(QPixmap());
     ui->frameLabel->setText("<b>Select a movie from the list on the left</b>");
-    auto selection = ui->treeWidget->selectedItems();
-    if (selection.size() > 0) {
-        ui->horizontalSlider->setMinimum(1);
-        auto movie = _itemToMovieMap[selection[0]];
-        if (movie) {
+    QModelIndex selection = getSelectedProject();
+    if (selection.isValid()) {
+        ProjectCatalog::Entry project = _projects.getProject(selection);
+        std::shared_ptr<Movie> movie = std::shared_ptr<Movie> (new Movie(project.name, false));
+        if (movie->load (project.saveFilename) && movie->getNumberOfFrames() > 0) {
+            _selectedMovie = movie;
+            ui->horizontalSlider->setMinimum(1);
             ui->horizontalSlider->setMaximum(movie->getNumberOfFrames());
-            movie->setStillFrame (0, ui->frameLabel);
+            if (ui->horizontalSlider->value() == 1) {
+                showFrame(0);
+            } else {
+                ui->horizontalSlider->setValue(1);
+            }
         }
     }
 }
 
 void AddToPreviousMovieDialog::on_horizontalSlider_valueChanged(int value)
 {
-    auto selection = ui->treeWidget->selectedItems();
-    if (selection.size() == 1) {
-        auto movie = _itemToMovieMap[selection[0]];
-        if (movie) {
-            movie->setStillFrame (value-1, ui->frameLabel);
-        }
+    showFrame(value-1);
+}
+
+void AddToPreviousMovieDialog::showFrame (int frame)
+{
+    if (!_selectedMovie || frame < 0 || frame >= _selectedMovie->getNumberOfFrames()) {
+        return;
+    }
+
+    // Only the most recent position matters: anything still waiting for the last one is dropped,
+    // and the current picture stays up until the new one is ready.
+    _requestedFrame = _selectedMovie->getImageFilename(frame);
+    _framePreviews.CancelPending();
+    QImage image = _framePreviews.Get(_requestedFrame);
+    if (!image.isNull()) {
+        framePreviewReady(_requestedFrame, image);
     }
 }
 
-void AddToPreviousMovieDialog::on_treeWidget_doubleClicked(const QModelIndex &)
+void AddToPreviousMovieDialog::framePreviewReady(const QString &filename, const QImage &image)
 {
-    auto selection = ui->treeWidget->selectedItems();
-    if (selection.size() > 0) {
-        auto movie = _itemToMovieMap[selection[0]];
-        if (movie) {
-            this->accept();
-        }
+    if (filename == _requestedFrame) {
+        ui->frameLabel->setPixmap(QPixmap::fromImage(image));
+    }
+}
+
+void AddToPreviousMovieDialog::on_treeView_doubleClicked(const QModelIndex &)
+{
+    if (getSelectedProject().isValid() && _selectedMovie) {
+        this->accept();
     }
 }
@@ -2,8 +2,10 @@
 #define ADDTOPREVIOUSMOVIEDIALOG_H
 
 #include <QDialog>
-#include <QTreeWidgetItem>
+#include <QItemSelection>
 #include "movie.h"
+#include "projectlistmodel.h"
+#include "thumbnailloader.h"
 #include <memory>
 
 namespace Ui {
@@ -26,18 +28,30 @@ public slots:
 
 private slots:
 
-    void on_treeWidget_itemSelectionChanged();
+    void projectSelectionChanged(const QItemSelection &selected, const QItemSelection &deselected);
 
     void on_horizontalSlider_valueChanged(int value);
 
-    void on_treeWidget_doubleClicked(const QModelIndex &index);
+    void on_treeView_doubleClicked(const QModelIndex &index);
+
+    void framePreviewReady(const QString &filename, const QImage &image);
 
 protected:
     virtual void showEvent(QShowEvent *)  ;
 
 private:
+    QModelIndex getSelectedProject () const;
+    void showFrame (int frame);
+
     Ui::AddToPreviousMovieDialog *ui;
-    std::map<QTreeWidgetItem *, std::shared_ptr<Movie> > _itemToMovieMap;
+    ProjectListModel _projects;
+
+    // Frames are decoded in the background, so dragging the slider never waits on a JPEG
+    ThumbnailLoader _framePreviews;
+    QString _requestedFrame;
+
+    // Only the selected movie is ever loaded
+    std::shared_ptr<Movie> _selectedMovie;
 };
 
 #endif // ADDTOPREVIOUSMOVIEDIALOG_H
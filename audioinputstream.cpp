@@ -1,4 +1,5 @@
 #include "audioinputstream.h"
+#include "avcodecwrapper.h"
 #include "plsexception.h"
 
 extern "C" {
@@ -21,7 +22,7 @@ AudioInputStream::AudioInputStream(const QString &filename) :
     _codecContext(nullptr),
     _index(-1)
 {
-    av_register_all();
+    avcodecWrapper::InitializeLibraries();
     _frame = av_frame_alloc();
 
     int ret = 0;
@@ -50,7 +51,13 @@ AVFrame *AudioInputStream::GetNextFrame()
                 avcodec_send_packet(_codecContext, nullptr);
             } else if (ret != AVERROR(EAGAIN)){
                 CheckAndThrow(ret);
-                ret = avcodec_send_packet(_codecContext, &_packet);
+                // Other streams (e.g. an MP3's cover art) aren't for this decoder
+                if (_packet.stream_index == _index) {
+                    ret = avcodec_send_packet(_codecContext, &_packet);
+                } else {
+                    ret = 0;
+                }
+                av_packet_unref(&_packet);
                 CheckAndThrow(ret);
             }
         } else if (ret == AVERROR_EOF) {
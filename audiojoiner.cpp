@@ -1,5 +1,7 @@
 #include "audiojoiner.h"
+#include "avcodecwrapper.h"
 #include "avexception.h"
+#include "utils.h"
 #include <qdebug.h>
 
 #include <iostream>
@@ -13,9 +15,10 @@ AudioJoiner::AudioJoiner() :
     _started (false),
     _sampleFormat (AV_SAMPLE_FMT_FLTP),
     _sampleRate (44100),
-    _outputFrameSize (1024)
+    _outputFrameSize (1024),
+    _statistics (nullptr)
 {
-    avfilter_register_all();
+    avcodecWrapper::InitializeLibraries();
     _outputFrame = av_frame_alloc();
 }
 
@@ -44,6 +47,11 @@ void AudioJoiner::SetFrameSize (unsigned int frameSize)
     _outputFrameSize = frameSize;
 }
 
+void AudioJoiner::SetStatistics (EncodeStatistics *statistics)
+{
+    _statistics = statistics;
+}
+
 
 void AudioJoiner::StartStream()
 {
@@ -233,21 +241,33 @@ AVFrame* AudioJoiner::GetNextFrame()
     // Try the naive way for now (pushing all the frames into the buffer every time,
     // instead of checking to see if this file is actually needed right now:
     int ret = 0, ret2=0;
+
+    // The encoder takes its own reference to the last frame we handed out, so drop ours before
+    // the buffersink moves the next one in.
+    av_frame_unref(_outputFrame);
     while (true) {
         ret = AVERROR(EAGAIN);
         while (ret == AVERROR(EAGAIN)) {
             // Start by checking to see if we even need to read another frame of audio information
             // from the files to get another frame...
-            qDebug() << "Asking filtergraph for another frame...";
-            av_buffersink_set_frame_size (_bufferSinkContext, _outputFrameSize);
-            ret = av_buffersink_get_frame(_bufferSinkContext, _outputFrame);
-            qDebug() << "Filtergraph said " << (ret == AVERROR(EAGAIN) ? "\"Feed me!\"" : "\"OK\"");
+            ENCODER_DEBUG << "Asking filtergraph for another frame...";
+            {
+                EncodeStatistics::ScopedTimer timer (_statistics, EncodeStatistics::AUDIO_MIX);
+                av_buffersink_set_frame_size (_bufferSinkContext, _outputFrameSize);
+                ret = av_buffersink_get_frame(_bufferSinkContext, _outputFrame);
+            }
+            ENCODER_DEBUG << "Filtergraph said " << (ret == AVERROR(EAGAIN) ? "\"Feed me!\"" : "\"OK\"");
             if (ret == AVERROR(EAGAIN)) {
                 // We need more data: we don't know which file is the holdup, so just load one more
                 // frame from all of them
-                qDebug() << "Getting the next audio frame";
+                ENCODER_DEBUG << "Getting the next audio frame";
                 for (auto&& file: _files) {
-                    AVFrame *frame = file.ais->GetNextFrame();
+                    AVFrame *frame;
+                    {
+                        EncodeStatistics::ScopedTimer timer (_statistics, EncodeStatistics::AUDIO_DECODE);
+                        frame = file.ais->GetNextFrame();
+                    }
+                    EncodeStatistics::ScopedTimer timer (_statistics, EncodeStatistics::AUDIO_MIX);
                     if (frame) {
                         ret2 = av_buffersrc_add_frame_flags(file.bufferSourceContext, frame, 0);
                         if (ret2 < 0) {
@@ -271,7 +291,7 @@ AVFrame* AudioJoiner::GetNextFrame()
         if (ret < 0){
             throw AVException("av_buffersink_get_frame",ret);
         } else {
-            qDebug() << "Returning an audio frame";
+            ENCODER_DEBUG << "Returning an audio frame";
             return _outputFrame;
         }
     }
@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QString>
 #include "audioinputstream.h"
+#include "encodestatistics.h"
 #include <memory>
 
 extern "C" {
@@ -31,6 +32,8 @@ public:
 
     void SetFrameSize (unsigned int frameSize);
 
+    void SetStatistics (EncodeStatistics *statistics);
+
     void StartStream();
 
     AVFrame* GetNextFrame();
@@ -80,6 +83,7 @@ private:
     int _sampleRate;
     unsigned int _outputFrameSize;
     AVFrame *_outputFrame;
+    EncodeStatistics *_statistics;
 
     // Variables for the filter chain:
     AVFilterContext *_bufferSinkContext;
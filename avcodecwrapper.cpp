@@ -25,6 +25,8 @@
 
 
 #include "avcodecwrapper.h"
+#include "plsexception.h"
+#include "utils.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -32,6 +34,13 @@
 #include <math.h>
 
 #include <iostream>
+#include <mutex>
+#include <new>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
 
 extern "C" {
     #include <libavcodec/avcodec.h>
@@ -44,6 +53,7 @@ extern "C" {
     #include <libavutil/opt.h>
     #include <libavutil/mathematics.h>
     #include <libavformat/avformat.h>
+    #include <libavfilter/avfilter.h>
     #include <libswscale/swscale.h>
 }
 
@@ -51,7 +61,49 @@ extern "C" {
  * C code adapted from ffmpeg examples                                     *
  **************************************************************************/
 
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+// Before FFmpeg 4.0, avcodec_open2 and avcodec_close are only safe to call from several threads
+// if the application supplies the mutexes
+static int LockManager (void **mutex, enum AVLockOp op)
+{
+    switch (op) {
+    case AV_LOCK_CREATE:
+        *mutex = new (std::nothrow) std::mutex;
+        return *mutex ? 0 : 1;
+    case AV_LOCK_OBTAIN:
+        static_cast<std::mutex *>(*mutex)->lock();
+        return 0;
+    case AV_LOCK_RELEASE:
+        static_cast<std::mutex *>(*mutex)->unlock();
+        return 0;
+    case AV_LOCK_DESTROY:
+        delete static_cast<std::mutex *>(*mutex);
+        *mutex = nullptr;
+        return 0;
+    }
+    return 1;
+}
+#endif
+
+void avcodecWrapper::InitializeLibraries ()
+{
+    static std::once_flag initialized;
+    std::call_once(initialized, []() {
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+        if (av_lockmgr_register(&LockManager) != 0) {
+            std::cerr << "Could not register the FFmpeg lock manager" << std::endl;
+        }
+#endif
+        av_register_all();
+        avfilter_register_all();
+    });
+}
+
 avcodecWrapper::avcodecWrapper() :
+    _currentSegment (-1),
+    _decodedSource (-1),
+    _videoEncoderUsed (false),
+    _videoEncoderPending (false),
     src_samples_data (nullptr),
     dst_samples_data (nullptr),
     frame (nullptr),
@@ -61,9 +113,26 @@ avcodecWrapper::avcodecWrapper() :
 
 
 
-void avcodecWrapper::AddVideoFrame (const QString &filename)
+void avcodecWrapper::AddVideoFrame (const QString &filename, int holdCount)
 {
+    if (_videoSegments.empty()) {
+        StartVideoSegment();
+    }
+    holdCount = qMax(1, holdCount);
     _videoFrames.append(filename);
+    for (int repeat = 0; repeat < holdCount; repeat++) {
+        _outputFrameSources.append(_videoFrames.length() - 1);
+    }
+    _videoSegments.back().numberOfFrames += holdCount;
+}
+
+void avcodecWrapper::StartVideoSegment (const QString &cacheFilename)
+{
+    VideoSegment segment;
+    segment.firstFrame = _outputFrameSources.length();
+    segment.numberOfFrames = 0;
+    segment.cacheFilename = cacheFilename;
+    _videoSegments.append(segment);
 }
 
 void avcodecWrapper::AddAudioFile (const SoundEffect &soundEffect, double tOffset)
@@ -75,14 +144,35 @@ void avcodecWrapper::AddAudioFile (const SoundEffect &soundEffect, double tOffse
 void avcodecWrapper::Encode (const QString &filename, int w, int h, int fps)
 {
     _outputFilename = filename;
-    _numberOfFrames = _videoFrames.length();
+    _numberOfFrames = _outputFrameSources.length();
     _w = w;
     _h = h;
     _framesPerSecond = fps;
     _streamDuration = double(_numberOfFrames) / double(_framesPerSecond);
 
+    for (auto &&segment: _videoSegments) {
+        if (!segment.cacheFilename.isEmpty()) {
+            segment.cacheKey = segment_cache_key(segment);
+        }
+    }
+
     // Eventually move the necesary contents of wrapMain to here...
-    wrapMain();
+    if (_videoSourceFilename.isEmpty()) {
+        wrapMain();
+    } else {
+        remuxMain();
+    }
+    _statistics.Finish();
+}
+
+EncodeStatistics &avcodecWrapper::GetStatistics ()
+{
+    return _statistics;
+}
+
+void avcodecWrapper::SetVideoSource (const QString &filename)
+{
+    _videoSourceFilename = filename;
 }
 
 // Quick utility function...
@@ -123,15 +213,54 @@ void avcodecWrapper::log_packet(const AVFormatContext *fmt_ctx, const AVPacket *
            pkt->stream_index);
 }
 
-int avcodecWrapper::write_frame(AVFormatContext *fmt_ctx, const AVRational *time_base, AVStream *st, AVPacket *pkt)
+/*
+ * send one frame to the encoder (or nullptr to flush it) and pass every packet
+ * the encoder has ready on to the writer thread
+ */
+void avcodecWrapper::encode_frame(OutputStream *ost, AVFrame *frame, EncodedSegment *capture)
 {
-    /* rescale output packet timestamp values from codec to stream timebase */
-    av_packet_rescale_ts(pkt, *time_base, st->time_base);
-    pkt->stream_index = st->index;
+    EncodeStatistics::Stage stage = (ost->enc->codec_type == AVMEDIA_TYPE_VIDEO) ?
+                EncodeStatistics::VIDEO_ENCODE : EncodeStatistics::AUDIO_ENCODE;
+    int ret;
+    {
+        EncodeStatistics::ScopedTimer timer (&_statistics, stage);
+        ret = avcodec_send_frame(ost->enc, frame);
+    }
+    if (ret < 0) {
+        throw libavException("Error sending a frame to the encoder: " + avErrorToQString(ret));
+    }
 
-    /* Write the compressed frame to the media file. */
-    //log_packet(fmt_ctx, pkt);
-    return av_interleaved_write_frame(fmt_ctx, pkt);
+    while (true) {
+        AVPacket *pkt = av_packet_alloc();
+        if (!pkt) {
+            throw libavException("Could not allocate a packet");
+        }
+        {
+            EncodeStatistics::ScopedTimer timer (&_statistics, stage);
+            ret = avcodec_receive_packet(ost->enc, pkt);
+        }
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            // The encoder needs more input (or is completely drained)
+            av_packet_free(&pkt);
+            return;
+        } else if (ret < 0) {
+            av_packet_free(&pkt);
+            throw libavException("Error encoding a frame: " + avErrorToQString(ret));
+        }
+
+        if (capture) {
+            /* keep a copy for the segment cache, with timestamps relative to the segment */
+            capture->AddPacket(pkt, -_videoSegments[_currentSegment].firstFrame);
+        }
+
+        /* rescale output packet timestamp values from codec to stream timebase */
+        av_packet_rescale_ts(pkt, ost->enc->time_base, ost->st->time_base);
+        pkt->stream_index = ost->st->index;
+
+        /* The writer thread takes ownership of the packet and writes it to the media file. */
+        //log_packet(fmt_ctx, pkt);
+        _packetWriter->Enqueue(pkt);
+    }
 }
 
 /* Add an output stream. */
@@ -187,32 +316,13 @@ void avcodecWrapper::add_stream(OutputStream *ost, AVFormatContext *oc,
         break;
 
     case AVMEDIA_TYPE_VIDEO:
-        c->codec_id = codec_id;
-        /* Resolution must be a multiple of two. */
-        c->width    = _w;
-        c->height   = _h;
         /* timebase: This is the fundamental unit of time (in seconds) in terms
          * of which frame timestamps are represented. For fixed-fps content,
          * timebase should be 1/framerate and timestamp increments should be
          * identical to 1. */
         ost->st->time_base.num = 1;
         ost->st->time_base.den = _framesPerSecond;
-        c->time_base       = ost->st->time_base;
-        c->pix_fmt       = STREAM_PIX_FMT;
-
-        if (codec_id == AV_CODEC_ID_H264) {
-            av_opt_set(c->priv_data, "preset", "slow", 0);
-        }
-        if (c->codec_id == AV_CODEC_ID_MPEG2VIDEO) {
-            /* just for testing, we also add B-frames */
-            c->max_b_frames = 2;
-        }
-        if (c->codec_id == AV_CODEC_ID_MPEG1VIDEO) {
-            /* Needed to avoid using macroblocks in which some coeffs overflow.
-             * This does not happen with normal video, it just happens here as
-             * the motion of the chroma plane does not match the luma plane. */
-            c->mb_decision = 2;
-        }
+        configure_video_context(c, oc, codec_id);
     break;
 
     default:
@@ -224,6 +334,43 @@ void avcodecWrapper::add_stream(OutputStream *ost, AVFormatContext *oc,
         c->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 }
 
+/* Set up a video encoding context: shared by the stream setup and by every
+ * fresh encoder session started for a new video segment. */
+void avcodecWrapper::configure_video_context(AVCodecContext *c, AVFormatContext *oc, AVCodecID codec_id)
+{
+    c->codec_id = codec_id;
+    /* Resolution must be a multiple of two. */
+    c->width    = _w;
+    c->height   = _h;
+    /* The muxer may change the stream timebase when the header is written, so
+     * don't copy it from there. */
+    c->time_base.num = 1;
+    c->time_base.den = _framesPerSecond;
+    c->pix_fmt       = STREAM_PIX_FMT;
+
+    if (codec_id == AV_CODEC_ID_H264) {
+        av_opt_set(c->priv_data, "preset", "slow", 0);
+    }
+    if (c->codec_id == AV_CODEC_ID_MPEG2VIDEO) {
+        /* just for testing, we also add B-frames */
+        c->max_b_frames = 2;
+    }
+    if (c->codec_id == AV_CODEC_ID_MPEG1VIDEO) {
+        /* Needed to avoid using macroblocks in which some coeffs overflow.
+         * This does not happen with normal video, it just happens here as
+         * the motion of the chroma plane does not match the luma plane. */
+        c->mb_decision = 2;
+    }
+    if (_videoSegments.size() > 1) {
+        /* Segments are spliced together by offsetting their timestamps, which is
+         * only safe if decode order and presentation order are the same. */
+        c->max_b_frames = 0;
+    }
+
+    if (oc->oformat->flags & AVFMT_GLOBALHEADER)
+        c->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+}
+
 /**************************************************************/
 /* audio output */
 
@@ -286,52 +433,38 @@ void avcodecWrapper::open_audio(AVFormatContext *, AVCodec *codec, OutputStream
 }
 
 
+/* Set up the mix of all the sound files to match the audio encoder */
+void avcodecWrapper::start_audio_mix(OutputStream *ost)
+{
+    for (auto s = _soundEffects.begin(); s != _soundEffects.end(); ++s) {
+        _audioJoiner.AddFile(s->getFilename(), s->getStartTime(), s->getInPoint(), s->getOutPoint(),s->getVolume());
+    }
+    _audioJoiner.SetFormat(ost->enc->sample_fmt);
+    _audioJoiner.SetSampleRate(ost->enc->sample_rate);
+    _audioJoiner.SetStatistics(&_statistics);
+    _audioJoiner.StartStream();
+}
+
 /*
  * encode one audio frame and send it to the muxer
  * return 1 when encoding is finished, 0 otherwise
  */
-int avcodecWrapper::write_audio_frame(AVFormatContext *oc, OutputStream *ost)
+int avcodecWrapper::write_audio_frame(AVFormatContext *, OutputStream *ost)
 {
-    AVCodecContext *c;
-    AVPacket pkt; // data and size must be 0;
-    pkt.data = nullptr;
-    pkt.size = 0;
-    pkt.buf = nullptr;
-    int ret;
-    int got_packet = 0;
-
-    av_init_packet(&pkt);
-    c = ost->enc;
+    AVCodecContext *c = ost->enc;
 
     _audioJoiner.SetFrameSize (static_cast<unsigned int>(ost->enc->frame_size));
-    ret = av_frame_make_writable(ost->frame);
     ost->frame = _audioJoiner.GetNextFrame(); // This will always return a frame, even if it is silent
     ost->next_pts += ost->frame->nb_samples;
 
-    /* when we pass a frame to the encoder, it may keep a reference to it
-     * internally; make sure we do not overwrite it here
-     */
-    if (ret < 0) {
-        throw libavException("Could not make the frame writable: " + avErrorToQString(ret));
-    }
-
     AVRational tb;
     tb.num=1;
     tb.den=c->sample_rate;
     ost->frame->pts = av_rescale_q(ost->samples_count, tb, c->time_base);
     ost->samples_count += ost->frame->nb_samples;
+    _statistics.Count(EncodeStatistics::AUDIO_FRAMES);
 
-    ret = avcodec_encode_audio2(c, &pkt, ost->frame, &got_packet);
-    if (ret < 0) {
-        throw libavException("Error encoding audio frame: " + avErrorToQString(ret));
-    }
-
-    if (got_packet) {
-        ret = write_frame(oc, &c->time_base, ost->st, &pkt);
-        if (ret < 0) {
-            throw libavException("Error while writing audio frame: " + avErrorToQString(ret));
-        }
-    }
+    encode_frame(ost, ost->frame);
 
     return 0; // This always writes data, the audio stream never ends.
 }
@@ -481,6 +614,15 @@ AVFrame *avcodecWrapper::get_video_frame(OutputStream *ost)
         return nullptr;
     }
 
+    /* a held frame is sent to the encoder again as it is: it was decoded once, and
+     * the encoder keeps its own reference to what it was given, so only the pts changes */
+    int source = _outputFrameSources.at(int(ost->next_pts));
+    if (source == _decodedSource && ost->frame) {
+        ost->frame->pts = ost->next_pts++;
+        _statistics.Count(EncodeStatistics::VIDEO_FRAMES_HELD);
+        return ost->frame;
+    }
+
     AVInputFormat *iformat = nullptr;
     AVFormatContext *format_ctx = nullptr;
     AVCodec *codec;
@@ -492,7 +634,7 @@ AVFrame *avcodecWrapper::get_video_frame(OutputStream *ost)
     pkt.size = 0;
     AVDictionary *opt=nullptr;
 
-    QByteArray filenameBytes = _videoFrames.at(int(ost->next_pts)).toLatin1();
+    QByteArray filenameBytes = _videoFrames.at(source).toLatin1();
     const char *filename = filenameBytes.data();
 
     av_init_packet(&pkt);
@@ -536,6 +678,7 @@ AVFrame *avcodecWrapper::get_video_frame(OutputStream *ost)
     // Store the new one:
     ost->frame = frame;
     ost->frame->pts = ost->next_pts++;
+    _decodedSource = source;
 
     // Deallocate the extra stuff we no longer need, but keep the frame!
     //av_packet_unref(&pkt);
@@ -546,48 +689,179 @@ AVFrame *avcodecWrapper::get_video_frame(OutputStream *ost)
     return frame;
 }
 
-/*
- * encode one video frame and send it to the muxer
- * return 1 when encoding is finished, 0 otherwise
- */
-int avcodecWrapper::write_video_frame(AVFormatContext *oc, OutputStream *ost)
+/**************************************************************/
+/* video segments */
+
+/* The cache key covers everything that affects the encoded packets: the frame
+ * files themselves (by name, size and modification time, so nothing has to be
+ * read to check it), how long each one is held, and the encoder settings. */
+QByteArray avcodecWrapper::segment_cache_key(const VideoSegment &segment) const
 {
-    int ret;
-    AVCodecContext *c;
-    AVFrame *frame;
-    int got_packet = 0;
-    AVPacket pkt;
-    pkt.data = nullptr;
-    pkt.size = 0;
-    pkt.buf = nullptr;
+    QCryptographicHash hash (QCryptographicHash::Sha1);
+    QString settings = QString ("%1 %2x%3 %4fps %5 %6 %7")
+            .arg(QString::fromUtf8(avcodec_get_name(AV_CODEC_ID_H264)))
+            .arg(_w).arg(_h).arg(_framesPerSecond)
+            .arg(int(STREAM_PIX_FMT))
+            .arg("slow")
+            .arg(LIBAVCODEC_VERSION_INT);
+    hash.addData(settings.toUtf8());
+    int end = segment.firstFrame + segment.numberOfFrames;
+    for (int frame = segment.firstFrame; frame < end; ) {
+        int source = _outputFrameSources.at(frame);
+        int holdCount = 1;
+        while (frame + holdCount < end && _outputFrameSources.at(frame + holdCount) == source) {
+            holdCount++;
+        }
+        QFileInfo info (_videoFrames.at(source));
+        hash.addData(_videoFrames.at(source).toUtf8());
+        hash.addData(QByteArray::number(info.size()));
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+        hash.addData(QByteArray::number(holdCount));
+        frame += holdCount;
+    }
+    return hash.result();
+}
 
-    c = ost->enc;
+int avcodecWrapper::segment_for_frame(int64_t frame) const
+{
+    for (int segment = 0; segment < _videoSegments.size(); segment++) {
+        const VideoSegment &s = _videoSegments.at(segment);
+        if (frame >= s.firstFrame && frame < s.firstFrame + s.numberOfFrames) {
+            return segment;
+        }
+    }
+    return -1;
+}
 
-    frame = get_video_frame(ost);
-    qDebug() << frame;
+/* If the current segment has a valid cache, send its packets straight to the
+ * writer and skip past its frames. Returns false if it has to be encoded. */
+bool avcodecWrapper::use_cached_segment(OutputStream *ost)
+{
+    const VideoSegment &segment = _videoSegments.at(_currentSegment);
+    if (segment.cacheFilename.isEmpty()) {
+        return false;
+    }
 
-    av_init_packet(&pkt);
+    EncodedSegment cached (segment.cacheKey);
+    {
+        EncodeStatistics::ScopedTimer timer (&_statistics, EncodeStatistics::CACHE_IO);
+        if (!cached.Load(segment.cacheFilename)) {
+            return false;
+        }
+    }
 
-    /* encode the image */
-    ret = avcodec_encode_video2(c, &pkt, frame, &got_packet);
-    if (ret < 0) {
-        throw libavException("Error encoding video frame:" + avErrorToQString(ret));
+    // The packets were encoded against the headers of an earlier session: if ours differ
+    // (e.g. a different libx264), they can't be spliced in
+    AVCodecParameters *par = ost->st->codecpar;
+    if (!cached.ExtradataMatches(par->extradata, par->extradata_size)) {
+        return false;
     }
 
-    if (got_packet) {
-        ret = write_frame(oc, &c->time_base, ost->st, &pkt);
-    } else {
-        ret = 0;
+    qDebug() << "Reusing" << segment.numberOfFrames << "encoded frames from" << segment.cacheFilename;
+    AVRational tb;
+    tb.num = 1;
+    tb.den = _framesPerSecond;
+    for (int p = 0; p < cached.GetNumberOfPackets(); p++) {
+        AVPacket *pkt = cached.CreatePacket(p, segment.firstFrame);
+        av_packet_rescale_ts(pkt, tb, ost->st->time_base);
+        pkt->stream_index = ost->st->index;
+        _packetWriter->Enqueue(pkt);
     }
+    ost->next_pts += segment.numberOfFrames;
+    _statistics.Count(EncodeStatistics::VIDEO_FRAMES_REUSED, segment.numberOfFrames);
+    return true;
+}
 
-    if (ret < 0) {
-        throw libavException("Error while writing video frame: " + avErrorToQString(ret));
+/* Each segment gets its own encoder session, so it begins with a clean IDR
+ * frame and references nothing encoded before it. */
+void avcodecWrapper::start_video_segment(AVFormatContext *oc, OutputStream *ost)
+{
+    if (_videoEncoderUsed) {
+        const AVCodec *codec = ost->enc->codec;
+        avcodec_free_context(&ost->enc);
+        ost->enc = avcodec_alloc_context3(codec);
+        if (!ost->enc) {
+            throw libavException("Could not allocate an encoding context");
+        }
+        configure_video_context(ost->enc, oc, codec->id);
+        int ret = avcodec_open2(ost->enc, codec, nullptr);
+        if (ret < 0) {
+            throw libavException("Could not open video codec: " + avErrorToQString(ret));
+        }
+        _videoEncoderUsed = false;
+    }
+
+    const VideoSegment &segment = _videoSegments.at(_currentSegment);
+    if (!segment.cacheFilename.isEmpty()) {
+        _segmentCapture = std::unique_ptr<EncodedSegment>(new EncodedSegment(segment.cacheKey));
+        _segmentCapture->SetExtradata(ost->enc->extradata, ost->enc->extradata_size);
+    }
+}
+
+/* Drain the encoder for the segment that just ended, and cache it if asked to. */
+void avcodecWrapper::finish_video_segment(OutputStream *ost)
+{
+    if (_videoEncoderPending) {
+        encode_frame(ost, nullptr, _segmentCapture.get());
+        _videoEncoderPending = false;
+    }
+    if (_segmentCapture) {
+        try {
+            EncodeStatistics::ScopedTimer timer (&_statistics, EncodeStatistics::CACHE_IO);
+            _segmentCapture->Save(_videoSegments.at(_currentSegment).cacheFilename);
+        } catch (const PLSException &e) {
+            // Not fatal: the movie itself is fine, it just can't be reused next time
+            qDebug() << e.message();
+        }
+        _segmentCapture.reset();
+    }
+}
+
+/*
+ * encode one video frame and send it to the muxer
+ * return 1 when encoding is finished, 0 otherwise
+ */
+int avcodecWrapper::write_video_frame(AVFormatContext *oc, OutputStream *ost)
+{
+    int segment = segment_for_frame(ost->next_pts);
+    if (segment != _currentSegment) {
+        if (_currentSegment >= 0) {
+            finish_video_segment(ost);
+        }
+        _currentSegment = segment;
+        if (segment >= 0) {
+            if (use_cached_segment(ost)) {
+                /* Nothing was sent to the encoder; the next call moves on to the next segment */
+                return 0;
+            }
+            start_video_segment(oc, ost);
+        }
     }
 
-    av_packet_unref(&pkt);
+    AVFrame *frame;
+    {
+        EncodeStatistics::ScopedTimer timer (&_statistics, EncodeStatistics::VIDEO_DECODE);
+        frame = get_video_frame(ost);
+    }
+    ENCODER_DEBUG << frame;
+
+    if (!frame) {
+        /* No more input. Every segment is flushed as it finishes, so normally there is nothing
+         * left, but if a frame failed to load mid-segment this flushes what we have. That
+         * segment is incomplete, so it must not be cached. */
+        _segmentCapture.reset();
+        if (_videoEncoderPending) {
+            encode_frame(ost, nullptr);
+            _videoEncoderPending = false;
+        }
+        return 1;
+    }
 
-    qDebug() << frame << " " << got_packet;
-    return (frame || got_packet) ? 0 : 1;
+    encode_frame(ost, frame, _segmentCapture.get());
+    _statistics.Count(EncodeStatistics::VIDEO_FRAMES_ENCODED);
+    _videoEncoderUsed = true;
+    _videoEncoderPending = true;
+    return 0;
 }
 
 void avcodecWrapper::close_stream(AVFormatContext *, OutputStream *ost)
@@ -614,7 +888,7 @@ void avcodecWrapper::wrapMain()
     AVDictionary *opt = nullptr;
 
     /* Initialize libavcodec, and register all codecs and formats. */
-    av_register_all();
+    InitializeLibraries();
 
     /* allocate the output media context */
     avformat_alloc_output_context2(&oc, nullptr, nullptr, _outputFilename.toUtf8().data());
@@ -622,76 +896,93 @@ void avcodecWrapper::wrapMain()
         throw libavException("Could not deduce file type from filename: " + _outputFilename);
     }
 
-    fmt = oc->oformat;
-    fmt->video_codec = AV_CODEC_ID_H264;
+    try {
+        fmt = oc->oformat;
+        fmt->video_codec = AV_CODEC_ID_H264;
 
-    /* Add the audio and video streams using the default format codecs
-     * and initialize the codecs. */
-    if (fmt->video_codec != AV_CODEC_ID_NONE) {
-        add_stream(&video_st, oc, &video_codec, fmt->video_codec);
-        have_video = 1;
-        encode_video = 1;
-    }
-    if (fmt->audio_codec != AV_CODEC_ID_NONE && !_soundEffects.empty()) {
-        add_stream(&audio_st, oc, &audio_codec, fmt->audio_codec);
-        have_audio = 1;
-        encode_audio = 1;
-    }
+        /* Add the audio and video streams using the default format codecs
+         * and initialize the codecs. */
+        if (fmt->video_codec != AV_CODEC_ID_NONE) {
+            add_stream(&video_st, oc, &video_codec, fmt->video_codec);
+            have_video = 1;
+            encode_video = 1;
+        }
+        if (fmt->audio_codec != AV_CODEC_ID_NONE && !_soundEffects.empty()) {
+            add_stream(&audio_st, oc, &audio_codec, fmt->audio_codec);
+            have_audio = 1;
+            encode_audio = 1;
+        }
 
-    /* Now that all the parameters are set, we can open the audio and
-     * video codecs and allocate the necessary encode buffers. */
-    if (have_video) {
-        open_video(oc, video_codec, &video_st, opt);
-    }
+        /* Now that all the parameters are set, we can open the audio and
+         * video codecs and allocate the necessary encode buffers. */
+        if (have_video) {
+            open_video(oc, video_codec, &video_st, opt);
+        }
 
-    if (have_audio) {
-        for (auto s = _soundEffects.begin(); s != _soundEffects.end(); ++s) {
-            _audioJoiner.AddFile(s->getFilename(), s->getStartTime(), s->getInPoint(), s->getOutPoint(),s->getVolume());
+        if (have_audio) {
+            start_audio_mix(&audio_st);
+            open_audio(oc, audio_codec, &audio_st, opt);
         }
-        _audioJoiner.SetFormat(audio_st.enc->sample_fmt);
-        _audioJoiner.SetSampleRate(audio_st.enc->sample_rate);
-        _audioJoiner.StartStream();
-        open_audio(oc, audio_codec, &audio_st, opt);
-    }
 
-    av_dump_format(oc, 0, _outputFilename.toUtf8(), 1);
+        av_dump_format(oc, 0, _outputFilename.toUtf8(), 1);
+
+        /* open the output file, if needed */
+        if (!(fmt->flags & AVFMT_NOFILE)) {
+            ret = avio_open(&oc->pb, _outputFilename.toUtf8().data(), AVIO_FLAG_WRITE);
+            if (ret < 0) {
+                throw libavException("Could not open file for writing: " + avErrorToQString(ret));
+            }
+        }
 
-    /* open the output file, if needed */
-    if (!(fmt->flags & AVFMT_NOFILE)) {
-        ret = avio_open(&oc->pb, _outputFilename.toUtf8().data(), AVIO_FLAG_WRITE);
+        /* Write the stream header, if any. */
+        ret = avformat_write_header(oc, &opt);
         if (ret < 0) {
-            throw libavException("Could not open file for writing: " + avErrorToQString(ret));
+            throw libavException("Error occurred when opening output file: " + avErrorToQString(ret));
         }
-    }
 
-    /* Write the stream header, if any. */
-    ret = avformat_write_header(oc, &opt);
-    if (ret < 0) {
-        throw libavException("Error occurred when opening output file: " + avErrorToQString(ret));
-    }
-
-    char tsbuf[AV_TS_MAX_STRING_SIZE];
-    while (encode_video) {
-        qDebug() << "Encoding a frame...";
-        /* select the stream to encode */
-        if (encode_video &&
-            (!encode_audio || av_compare_ts(video_st.next_pts, video_st.enc->time_base,
-                                            audio_st.next_pts, audio_st.enc->time_base) <= 0)) {
-            qDebug() << "Video PTS " << av_ts_make_time_string (tsbuf, video_st.next_pts, &video_st.enc->time_base);
-            encode_video = !write_video_frame(oc, &video_st);
-        } else {
-            qDebug() << "Audio PTS " << av_ts_make_time_string (tsbuf, audio_st.next_pts, &audio_st.enc->time_base);
-            encode_audio = !write_audio_frame(oc, &audio_st);
+        /* From here until the trailer, all writing to oc happens on the writer thread. */
+        _packetWriter = std::unique_ptr<PacketWriter>(new PacketWriter(oc, &_statistics));
+        _packetWriter->start();
+
+        char tsbuf[AV_TS_MAX_STRING_SIZE];
+        while (encode_video) {
+            ENCODER_DEBUG << "Encoding a frame...";
+            /* select the stream to encode */
+            if (encode_video &&
+                (!encode_audio || av_compare_ts(video_st.next_pts, video_st.enc->time_base,
+                                                audio_st.next_pts, audio_st.enc->time_base) <= 0)) {
+                ENCODER_DEBUG << "Video PTS " << av_ts_make_time_string (tsbuf, video_st.next_pts, &video_st.enc->time_base);
+                encode_video = !write_video_frame(oc, &video_st);
+            } else {
+                ENCODER_DEBUG << "Audio PTS " << av_ts_make_time_string (tsbuf, audio_st.next_pts, &audio_st.enc->time_base);
+                encode_audio = !write_audio_frame(oc, &audio_st);
+            }
+            ENCODER_DEBUG << "Done.";
+        }
+        if (have_audio) {
+            /* The audio never ends on its own, but its encoder may still be holding samples */
+            encode_frame(&audio_st, nullptr);
         }
-        qDebug() << "Done.";
+        qDebug() << "Finished encoding frames.";
+
+        /* Wait for the writer thread to get everything onto the disk */
+        _packetWriter->Finish();
+        _packetWriter.reset();
+
+        /* Write the trailer, if any. The trailer must be written before you
+         * close the CodecContexts open when you wrote the header; otherwise
+         * av_write_trailer() may try to use memory that was freed on
+         * av_codec_close(). */
+        av_write_trailer(oc);
+    } catch (...) {
+        /* The writer thread uses oc, so it has to be stopped (dropping whatever it still has
+         * queued) before oc is freed and the file closed under it */
+        _packetWriter.reset();
+        if (!(oc->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&oc->pb);
+        avformat_free_context(oc);
+        throw;
     }
-    qDebug() << "Finished encoding frames.";
-
-    /* Write the trailer, if any. The trailer must be written before you
-     * close the CodecContexts open when you wrote the header; otherwise
-     * av_write_trailer() may try to use memory that was freed on
-     * av_codec_close(). */
-    av_write_trailer(oc);
 
     /* Close each codec. */
     if (have_video)
@@ -710,3 +1001,171 @@ void avcodecWrapper::wrapMain()
 /***************************************************************************
  * End of C code adapted from ffmpeg examples                              *
  **************************************************************************/
+
+/* Read packets until we get one from the requested stream. Returns false at the end of the file. */
+static bool readStreamPacket(AVFormatContext *ic, int streamIndex, AVPacket *pkt)
+{
+    while (av_read_frame(ic, pkt) >= 0) {
+        if (pkt->stream_index == streamIndex) {
+            return true;
+        }
+        av_packet_unref(pkt);
+    }
+    return false;
+}
+
+/* The audio-only version of wrapMain: the video stream is copied, packet for packet, from an
+ * earlier encode of the same movie, and only the audio is mixed and encoded. */
+void avcodecWrapper::remuxMain()
+{
+    OutputStream video_st, audio_st;
+    AVFormatContext *ic{nullptr};
+    AVFormatContext *oc{nullptr};
+    AVCodec *audio_codec{nullptr};
+    int ret;
+    int have_audio = 0;
+    AVDictionary *opt = nullptr;
+
+    /* Initialize libavcodec, and register all codecs and formats. */
+    InitializeLibraries();
+
+    ret = avformat_open_input(&ic, _videoSourceFilename.toUtf8().data(), nullptr, nullptr);
+    if (ret < 0) {
+        throw libavException("Could not open the previously encoded movie: " + avErrorToQString(ret));
+    }
+    ret = avformat_find_stream_info(ic, nullptr);
+    if (ret < 0) {
+        avformat_close_input(&ic);
+        throw libavException("Could not read the previously encoded movie: " + avErrorToQString(ret));
+    }
+    /* If we are replacing the file we are reading from, write next to it and swap at the end */
+    QString outputFilename = _outputFilename;
+    bool inPlace = (QFileInfo(_outputFilename) == QFileInfo(_videoSourceFilename));
+    QFileInfo info (_outputFilename);
+    if (inPlace) {
+        outputFilename = info.absolutePath() + "/" + info.completeBaseName() + ".remux." + info.suffix();
+    }
+
+    try {
+        int videoIndex = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (videoIndex < 0) {
+            throw libavException("The previously encoded movie has no video: " + avErrorToQString(videoIndex));
+        }
+        AVStream *inVideo = ic->streams[videoIndex];
+
+        avformat_alloc_output_context2(&oc, nullptr, nullptr, outputFilename.toUtf8().data());
+        if (!oc) {
+            throw libavException("Could not deduce file type from filename: " + _outputFilename);
+        }
+
+        /* The video stream is a straight copy of the old one */
+        video_st.st = avformat_new_stream(oc, nullptr);
+        if (!video_st.st) {
+            throw libavException("Could not allocate stream");
+        }
+        video_st.st->id = int(oc->nb_streams-1);
+        ret = avcodec_parameters_copy(video_st.st->codecpar, inVideo->codecpar);
+        if (ret < 0) {
+            throw libavException("Could not copy the video stream parameters: " + avErrorToQString(ret));
+        }
+        video_st.st->codecpar->codec_tag = 0;
+        video_st.st->time_base = inVideo->time_base;
+
+        if (oc->oformat->audio_codec != AV_CODEC_ID_NONE && !_soundEffects.empty()) {
+            add_stream(&audio_st, oc, &audio_codec, oc->oformat->audio_codec);
+            have_audio = 1;
+            start_audio_mix(&audio_st);
+            open_audio(oc, audio_codec, &audio_st, opt);
+        }
+
+        av_dump_format(oc, 0, outputFilename.toUtf8(), 1);
+
+        if (!(oc->oformat->flags & AVFMT_NOFILE)) {
+            ret = avio_open(&oc->pb, outputFilename.toUtf8().data(), AVIO_FLAG_WRITE);
+            if (ret < 0) {
+                throw libavException("Could not open file for writing: " + avErrorToQString(ret));
+            }
+        }
+
+        ret = avformat_write_header(oc, &opt);
+        if (ret < 0) {
+            throw libavException("Error occurred when opening output file: " + avErrorToQString(ret));
+        }
+
+        _packetWriter = std::unique_ptr<PacketWriter>(new PacketWriter(oc, &_statistics));
+        _packetWriter->start();
+
+        AVPacket *pkt = av_packet_alloc();
+        bool copy_video = readStreamPacket(ic, videoIndex, pkt);
+        while (copy_video) {
+            if (!have_audio || av_compare_ts(pkt->dts, inVideo->time_base,
+                                             audio_st.next_pts, audio_st.enc->time_base) <= 0) {
+                av_packet_rescale_ts(pkt, inVideo->time_base, video_st.st->time_base);
+                pkt->stream_index = video_st.st->index;
+                pkt->pos = -1;
+                _packetWriter->Enqueue(pkt);
+                pkt = av_packet_alloc();
+                copy_video = readStreamPacket(ic, videoIndex, pkt);
+            } else {
+                try {
+                    write_audio_frame(oc, &audio_st);
+                } catch (...) {
+                    av_packet_free(&pkt);
+                    throw;
+                }
+            }
+        }
+        av_packet_free(&pkt);
+
+        if (have_audio) {
+            encode_frame(&audio_st, nullptr);
+        }
+
+        _packetWriter->Finish();
+        _packetWriter.reset();
+
+        ret = av_write_trailer(oc);
+        if (ret < 0) {
+            throw libavException("Could not finish the movie file: " + avErrorToQString(ret));
+        }
+    } catch (...) {
+        /* The writer thread uses oc, so it has to be gone before oc is */
+        _packetWriter.reset();
+        if (oc) {
+            if (!(oc->oformat->flags & AVFMT_NOFILE))
+                avio_closep(&oc->pb);
+            avformat_free_context(oc);
+        }
+        avformat_close_input(&ic);
+        if (inPlace) {
+            QFile::remove(outputFilename);
+        }
+        throw;
+    }
+
+    if (have_audio)
+        close_stream(oc, &audio_st);
+
+    if (!(oc->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&oc->pb);
+
+    avformat_free_context(oc);
+    avformat_close_input(&ic);
+
+    if (inPlace) {
+        /* Move the original aside rather than deleting it, so that if the new file can't be put
+         * in its place the old one can: the movie is never left with neither. */
+        QString backupFilename = info.absolutePath() + "/" + info.completeBaseName() + ".backup." + info.suffix();
+        QFile::remove(backupFilename);
+        if (!QFile::rename(_outputFilename, backupFilename)) {
+            QFile::remove(outputFilename);
+            throw libavException("Could not replace " + _outputFilename);
+        }
+        if (!QFile::rename(outputFilename, _outputFilename)) {
+            QFile::rename(backupFilename, _outputFilename);
+            QFile::remove(outputFilename);
+            throw libavException("Could not replace " + _outputFilename);
+        }
+        QFile::remove(backupFilename);
+    }
+}
@@ -3,10 +3,15 @@
 
 #include <QObject>
 #include <QString>
+#include <QVector>
 #include <QException>
+#include <memory>
 
 #include "soundeffect.h"
 #include "audiojoiner.h"
+#include "packetwriter.h"
+#include "encodedsegment.h"
+#include "encodestatistics.h"
 
 extern "C" {
     #include <libavformat/avformat.h>
@@ -18,17 +23,64 @@ class avcodecWrapper : public QObject
 public:
     avcodecWrapper();
 
-    void AddVideoFrame (const QString &filename);
+    /**
+     * @brief InitializeLibraries registers FFmpeg's codecs, formats and filters, and (on FFmpeg
+     * versions that need one) a lock manager so codecs can be opened from several threads at once.
+     * Only the first call does anything; call it before starting threads that encode.
+     */
+    static void InitializeLibraries ();
+
+    /**
+     * @brief AddVideoFrame adds a frame that is shown for holdCount frames of the movie. The file is
+     * only read and decoded once however long it is held.
+     */
+    void AddVideoFrame (const QString &filename, int holdCount = 1);
+
+    /**
+     * @brief StartVideoSegment begins a new run of video frames: frames added after this call are
+     * encoded in their own encoder session. If a cache file is given, the encoded segment is saved
+     * there, and a later Encode with the same frame files and encoder settings reuses it instead of
+     * encoding those frames again.
+     */
+    void StartVideoSegment (const QString &cacheFilename = "");
 
     void AddAudioFile (const SoundEffect &soundEffect, double tOffset);
 
+    /**
+     * @brief SetVideoSource makes Encode copy the video stream from an earlier encode of the same
+     * movie instead of encoding any frames: only the audio is mixed and encoded again. filename may
+     * be the same as the file being encoded to.
+     */
+    void SetVideoSource (const QString &filename);
+
     void Encode (const QString &filename, int w, int h, int fps);
 
+    /**
+     * @brief GetStatistics gives the timing and counters for this encode. Callers may add their own
+     * stages (e.g. creating the title frames) before calling Encode.
+     */
+    EncodeStatistics &GetStatistics ();
+
 
 private:
 
     QStringList _videoFrames;
+    QVector<int> _outputFrameSources;   // The index in _videoFrames of each frame of the movie
     QList<SoundEffect> _soundEffects;
+    QString _videoSourceFilename;
+
+    struct VideoSegment {
+        int firstFrame;             // Both counted in frames of the movie, so including holds
+        int numberOfFrames;
+        QString cacheFilename;
+        QByteArray cacheKey;
+    };
+    QList<VideoSegment> _videoSegments;
+    int _currentSegment;
+    int _decodedSource;         // The index in _videoFrames of the frame in OutputStream::frame
+    bool _videoEncoderUsed;     // The current encoder session has been sent frames
+    bool _videoEncoderPending;  // ... some of which have not been flushed out yet
+    std::unique_ptr<EncodedSegment> _segmentCapture;
 
     QString _outputFilename;
     int _w;
@@ -68,10 +120,17 @@ private:
     // These are basically the wrapped functions from the libav* examples, slightly
     // modified to be member functions.
     void log_packet(const AVFormatContext *fmt_ctx, const AVPacket *pkt);
-    int write_frame(AVFormatContext *fmt_ctx, const AVRational *time_base, AVStream *st, AVPacket *pkt);
+    void encode_frame(OutputStream *ost, AVFrame *frame, EncodedSegment *capture = nullptr);
     void add_stream(OutputStream *ost, AVFormatContext *oc, AVCodec **codec, AVCodecID codec_id);
+    void configure_video_context(AVCodecContext *c, AVFormatContext *oc, AVCodecID codec_id);
+    QByteArray segment_cache_key(const VideoSegment &segment) const;
+    int segment_for_frame(int64_t frame) const;
+    bool use_cached_segment(OutputStream *ost);
+    void start_video_segment(AVFormatContext *oc, OutputStream *ost);
+    void finish_video_segment(OutputStream *ost);
     AVFrame *alloc_audio_frame(enum AVSampleFormat sample_fmt,uint64_t channel_layout,int sample_rate, int nb_samples);
     void open_audio(AVFormatContext *, AVCodec *codec, OutputStream *ost, AVDictionary *opt_arg);
+    void start_audio_mix(OutputStream *ost);
     int write_audio_frame(AVFormatContext *oc, OutputStream *ost);
     AVFrame *alloc_picture(AVPixelFormat pix_fmt);
     void open_video(AVFormatContext *oc, AVCodec *codec, OutputStream *ost, AVDictionary *opt_arg);
@@ -80,6 +139,7 @@ private:
     int write_video_frame(AVFormatContext *oc, OutputStream *ost);
     void close_stream(AVFormatContext *oc, OutputStream *ost);
     void wrapMain();
+    void remuxMain();
 
 private:
 
@@ -99,6 +159,10 @@ private:
     int       dst_samples_size;
 
     AudioJoiner _audioJoiner;
+    EncodeStatistics _statistics;
+
+    // All muxing happens on this thread, the encoders just queue their packets for it
+    std::unique_ptr<PacketWriter> _packetWriter;
 
     // Video output variables
     AVFrame *frame;
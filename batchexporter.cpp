@@ -0,0 +1,141 @@
+#include "batchexporter.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include "avcodecwrapper.h"
+#include "movie.h"
+#include "settings.h"
+
+BatchExporter::BatchExporter(int maxJobs, QObject *parent) :
+    QObject(parent),
+    _maxJobs (std::max(maxJobs, 1))
+{
+}
+
+void BatchExporter::AddProject (const QString &project)
+{
+    if (project.endsWith(".json", Qt::CaseInsensitive)) {
+        _projects.append(project);
+    } else {
+        Settings settings;
+        QString imageStorageLocation = settings.Get("settings/imageStorageLocation").toString();
+        QString name = QFileInfo(project).fileName();
+        _projects.append(QDir(imageStorageLocation).filePath(name + "/" + name + ".json"));
+    }
+}
+
+void BatchExporter::AddAllProjects ()
+{
+    // Same layout the add-to-previous dialog looks for: imageStorageLocation/name/name.json
+    Settings settings;
+    QString imageStorageLocation = settings.Get("settings/imageStorageLocation").toString();
+    QDir dir (imageStorageLocation);
+    dir.setSorting(QDir::Name);
+    auto entryList = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (auto entry : entryList) {
+        QString filename = dir.filePath(entry + "/" + entry + ".json");
+        if (QFileInfo(filename).isReadable()) {
+            _projects.append(filename);
+        }
+    }
+}
+
+int BatchExporter::GetNumberOfProjects () const
+{
+    return _projects.size();
+}
+
+int BatchExporter::Run ()
+{
+    QTextStream out (stdout);
+    QElapsedTimer total;
+    total.start();
+
+    // Make sure the settings are initialized on this thread before the workers start using them,
+    // and FFmpeg too: registering it isn't safe to do from several workers at once
+    Settings settings;
+    avcodecWrapper::InitializeLibraries();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(_maxJobs);
+    QList<QFuture<Result>> futures;
+    for (auto &&project: _projects) {
+        futures.append(QtConcurrent::run(&pool, &BatchExporter::ExportProject, project));
+    }
+
+    int failures = 0;
+    int totalFrames = 0;
+    for (auto &&future: futures) {
+        // The workers draw their titles and credits on this thread (see Movie::encodeToFile), so
+        // keep its event loop running while they work
+        if (!future.isFinished()) {
+            QFutureWatcher<Result> watcher;
+            QEventLoop loop;
+            QObject::connect(&watcher, &QFutureWatcher<Result>::finished, &loop, &QEventLoop::quit);
+            watcher.setFuture(future);
+            loop.exec();
+        }
+        Result result = future.result();
+        if (result.success) {
+            totalFrames += result.frames;
+            out << result.name << ": " << result.frames << " frames in "
+                << QString::number(result.seconds, 'f', 1) << " s ("
+                << QString::number(result.framesPerSecond, 'f', 1) << " frames/s) -> "
+                << result.filename << '\n';
+        } else {
+            failures++;
+            out << result.name << ": FAILED: " << result.message << '\n';
+        }
+        out.flush();
+    }
+
+    double seconds = double(total.elapsed()) / 1000.0;
+    out << "Exported " << (_projects.size() - failures) << " of " << _projects.size()
+        << " projects (" << totalFrames << " frames) in " << QString::number(seconds, 'f', 1)
+        << " s using " << _maxJobs << " jobs" << '\n';
+    return failures;
+}
+
+BatchExporter::Result BatchExporter::ExportProject (const QString &jsonFilename)
+{
+    Result result;
+    result.name = QFileInfo(jsonFilename).completeBaseName();
+    result.success = false;
+    result.frames = 0;
+    result.seconds = 0.0;
+    result.framesPerSecond = 0.0;
+
+    // Locked, so that nothing here can modify (or, on failure, delete) the project
+    Movie movie (result.name, false);
+    if (!movie.load(jsonFilename)) {
+        result.message = "Could not load " + jsonFilename;
+        return result;
+    }
+
+    result.filename = movie.getEncodingFilename();
+    result.frames = movie.getNumberOfFrames();
+    try {
+        movie.encodeToFile(result.filename, movie.getEncodingTitle(), movie.getEncodingCredits());
+    } catch (const Movie::EncodingFailedException &e) {
+        result.message = e.message();
+        return result;
+    } catch (...) {
+        result.message = "An unknown error occurred while encoding.";
+        return result;
+    }
+
+    QJsonObject report = movie.getLastEncodingReport();
+    result.seconds = report["totalMillis"].toDouble() / 1000.0;
+    result.framesPerSecond = report["videoFramesPerSecond"].toDouble();
+    result.success = true;
+    return result;
+}
@@ -0,0 +1,55 @@
+#ifndef BATCHEXPORTER_H
+#define BATCHEXPORTER_H
+
+#include <QObject>
+#include <QStringList>
+
+/**
+ * @brief The BatchExporter class exports saved projects to movie files without any user interface,
+ * several at a time. Each project is exported with the filename, title and credits it was last
+ * exported with (or the defaults, if it never was).
+ */
+class BatchExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchExporter(int maxJobs, QObject *parent = nullptr);
+
+    /**
+     * @brief AddProject queues a project, given either its JSON file or its name (the name of its
+     * directory in the image storage location).
+     */
+    void AddProject (const QString &project);
+
+    /**
+     * @brief AddAllProjects queues every project in the image storage location.
+     */
+    void AddAllProjects ();
+
+    int GetNumberOfProjects () const;
+
+    /**
+     * @brief Run exports all the queued projects, printing a line for each one as it finishes.
+     * Blocks until they are all done, and returns the number that failed.
+     */
+    int Run ();
+
+private:
+    struct Result {
+        QString name;
+        QString filename;
+        bool success;
+        QString message;
+        int frames;
+        double seconds;
+        double framesPerSecond;
+    };
+
+    static Result ExportProject (const QString &jsonFilename);
+
+    int _maxJobs;
+    QStringList _projects;
+};
+
+#endif // BATCHEXPORTER_H
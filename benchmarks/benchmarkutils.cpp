@@ -0,0 +1,178 @@
+#include "benchmarkutils.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QTextStream>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#ifdef Q_OS_WIN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace BenchmarkUtils
+{
+
+QImage SyntheticFrame (int frame, int numberOfFrames, int w, int h)
+{
+    QImage image (w, h, QImage::Format_RGB32);
+    QPainter painter (&image);
+
+    QLinearGradient background (0, 0, w, h);
+    background.setColorAt(0, QColor::fromHsv((frame / 10) % 360, 60, 220));
+    background.setColorAt(1, QColor::fromHsv((frame / 10 + 120) % 360, 120, 110));
+    painter.fillRect(image.rect(), background);
+
+    double t = double(frame) / double(std::max(numberOfFrames - 1, 1));
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(140, 30, 30));
+    painter.drawEllipse(QPointF(w * (0.1 + 0.8 * t), h * (0.6 + 0.1 * qSin(t * 6.0 * M_PI))),
+                        w * 0.08, h * 0.12);
+    painter.setPen(Qt::black);
+    painter.drawText(20, 40, QString::number(frame));
+    painter.end();
+
+    quint32 state = quint32(frame) * 2654435761u + 1;
+    for (int y = 0; y < h; ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < w; ++x) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            int noise = int(state % 9) - 4;
+            QRgb p = line[x];
+            line[x] = qRgb(qBound(0, qRed(p) + noise, 255),
+                           qBound(0, qGreen(p) + noise, 255),
+                           qBound(0, qBlue(p) + noise, 255));
+        }
+    }
+    return image;
+}
+
+bool WriteFrames (const QDir &project, const QString &name, int numberOfFrames, int w, int h)
+{
+    for (int frame = 0; frame < numberOfFrames; ++frame) {
+        std::stringstream ss;
+        ss << name.toStdString() << "_" << std::setfill('0') << std::setw(5) << frame << ".jpg";
+        QString filename = project.filePath(QString::fromStdString(ss.str()));
+        if (!SyntheticFrame(frame, numberOfFrames, w, h).save(filename, "JPG", 90)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+qint64 PeakResidentBytes ()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return qint64(counters.PeakWorkingSetSize);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef Q_OS_MACOS
+    return qint64(usage.ru_maxrss);         // Already in bytes
+#else
+    return qint64(usage.ru_maxrss) * 1024;  // In kilobytes
+#endif
+#endif
+}
+
+double Percentile (QVector<double> &samples, double p)
+{
+    if (samples.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    double rank = p / 100.0 * double(samples.size() - 1);
+    int below = int(std::floor(rank));
+    int above = std::min(below + 1, samples.size() - 1);
+    double fraction = rank - double(below);
+    return samples[below] + fraction * (samples[above] - samples[below]);
+}
+
+bool SaveJson (const QJsonObject &json, const QString &filename)
+{
+    QFile file (filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(json).toJson());
+    return true;
+}
+
+int CompareWithBaseline (const QJsonObject &results, const QString &baselineFilename,
+                         const QStringList &lowerIsBetter, double tolerance, bool updateBaseline)
+{
+    QTextStream out (stdout);
+
+    QFile baselineFile (baselineFilename);
+    if (updateBaseline || !baselineFile.exists()) {
+        if (SaveJson(results, baselineFilename)) {
+            out << "Saved baseline to " << QFileInfo(baselineFilename).absoluteFilePath() << '\n';
+        } else {
+            out << "Could not write the baseline to " << baselineFilename << '\n';
+        }
+        return 0;
+    }
+    if (!baselineFile.open(QIODevice::ReadOnly)) {
+        out << "Could not read the baseline " << baselineFilename << '\n';
+        return 0;
+    }
+    QJsonObject baseline = QJsonDocument::fromJson(baselineFile.readAll()).object();
+
+    int regressions = 0;
+    for (auto scenario = results.constBegin(); scenario != results.constEnd(); ++scenario) {
+        QJsonObject metrics = scenario.value().toObject();
+        QJsonObject baselineMetrics = baseline[scenario.key()].toObject();
+        out << scenario.key() << '\n';
+        for (auto metric = metrics.constBegin(); metric != metrics.constEnd(); ++metric) {
+            if (!metric.value().isDouble()) {
+                continue; // Breakdowns (e.g. per-stage timings) are recorded but not compared
+            }
+            double value = metric.value().toDouble();
+            out << "    " << metric.key() << ": " << QString::number(value, 'f', 2);
+            if (!baselineMetrics[metric.key()].isDouble()) {
+                out << " (no baseline)\n";
+                continue;
+            }
+            double reference = baselineMetrics[metric.key()].toDouble();
+            out << " (baseline " << QString::number(reference, 'f', 2);
+            bool lower = lowerIsBetter.contains(metric.key());
+            bool worse;
+            if (reference != 0.0) {
+                double change = (value - reference) / std::abs(reference);
+                worse = lower ? change > tolerance : change < -tolerance;
+                out << ", " << (change >= 0 ? "+" : "") << QString::number(change * 100.0, 'f', 1) << "%";
+            } else {
+                // No relative change from zero (e.g. skipped frames): any move the wrong way counts
+                worse = lower ? value > 0.0 : value < 0.0;
+            }
+            if (worse) {
+                out << ", REGRESSION";
+                regressions++;
+            }
+            out << ")\n";
+        }
+    }
+    out.flush();
+    return regressions;
+}
+
+}
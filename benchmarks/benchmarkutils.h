@@ -0,0 +1,59 @@
+#ifndef BENCHMARKUTILS_H
+#define BENCHMARKUTILS_H
+
+#include <QDir>
+#include <QImage>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief Helpers shared by the headless benchmarks.
+ *
+ * Every benchmark produces a JSON object of scenarios, each with a set of numeric metrics. The
+ * results are compared against a stored baseline of the same shape: a metric regresses when it
+ * is worse than the baseline by more than the tolerance (a fraction, e.g. 0.15 for 15%).
+ */
+namespace BenchmarkUtils
+{
+    /**
+     * @brief SyntheticFrame draws a frame that looks (to the encoder) roughly like a photograph of
+     * a set: a gradient background, a figure that moves a little each frame, and sensor noise.
+     */
+    QImage SyntheticFrame (int frame, int numberOfFrames, int w, int h);
+
+    /**
+     * @brief WriteFrames saves numberOfFrames synthetic JPEG frames into a project directory, named
+     * the way Movie names captured frames.
+     */
+    bool WriteFrames (const QDir &project, const QString &name, int numberOfFrames, int w, int h);
+
+    /**
+     * @brief PeakResidentBytes returns the largest resident set size this process has had so far.
+     */
+    qint64 PeakResidentBytes ();
+
+    /**
+     * @brief Percentile returns the p-th percentile (0-100) of the samples, which are sorted in place.
+     */
+    double Percentile (QVector<double> &samples, double p);
+
+    /**
+     * @brief CompareWithBaseline prints each scenario's metrics next to the baseline, and returns
+     * the number of regressions. If the baseline file doesn't exist (or updateBaseline is set) the
+     * results are written there instead and nothing is compared.
+     * @param lowerIsBetter The metrics where a smaller value is an improvement; any other metric
+     * in the results is treated as higher-is-better. A metric whose baseline is zero regresses as
+     * soon as it moves the wrong way at all.
+     */
+    int CompareWithBaseline (const QJsonObject &results, const QString &baselineFilename,
+                             const QStringList &lowerIsBetter, double tolerance, bool updateBaseline);
+
+    /**
+     * @brief SaveJson writes the object to a file, returning false if it couldn't be written.
+     */
+    bool SaveJson (const QJsonObject &json, const QString &filename);
+}
+
+#endif // BENCHMARKUTILS_H
@@ -0,0 +1,286 @@
+/*
+ * Headless export benchmark.
+ *
+ * Builds a synthetic project (generated JPEG frames, a background tone and a number of tone
+ * "sound effects"), then exports it the same way the application does, without a camera or any
+ * windows:
+ *
+ *   exportCold       nothing cached: every frame is decoded and encoded
+ *   exportNewTitle   only the title changed: the captured frames come from the segment cache
+ *   exportRemux      nothing about the video changed: only the audio is mixed and re-encoded
+ *   audioMix         the AudioJoiner mix on its own, for the length of the movie
+ *
+ * Each scenario records its wall time, throughput, the peak resident memory of the process so
+ * far, and the per-stage timings from EncodeStatistics. The results are compared against a
+ * stored baseline (written on the first run, or with --update-baseline).
+ *
+ * All settings and files are kept in a temporary working directory, so running this does not
+ * touch the real settings or projects.
+ */
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtMath>
+
+#include "benchmarkutils.h"
+#include "audiojoiner.h"
+#include "encodestatistics.h"
+#include "movie.h"
+#include "plsexception.h"
+#include "settings.h"
+#include "soundeffect.h"
+
+static const int SAMPLE_RATE = 44100;
+
+/**
+ * A 16-bit stereo PCM WAV file containing a sine tone.
+ */
+static bool WriteToneFile (const QString &filename, double frequency, double seconds)
+{
+    const int channels = 2;
+    int samples = int(seconds * SAMPLE_RATE);
+    QByteArray data (samples * channels * int(sizeof(qint16)), Qt::Uninitialized);
+    qint16 *pcm = reinterpret_cast<qint16 *>(data.data());
+    for (int i = 0; i < samples; ++i) {
+        qint16 value = qint16(0.3 * 32767.0 * qSin(2.0 * M_PI * frequency * double(i) / SAMPLE_RATE));
+        pcm[channels * i] = value;
+        pcm[channels * i + 1] = value;
+    }
+
+    QFile file (filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream stream (&file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.writeRawData("RIFF", 4);
+    stream << quint32(36 + data.size());
+    stream.writeRawData("WAVE", 4);
+    stream.writeRawData("fmt ", 4);
+    stream << quint32(16) << quint16(1) << quint16(channels) << quint32(SAMPLE_RATE)
+           << quint32(SAMPLE_RATE * channels * 2) << quint16(channels * 2) << quint16(16);
+    stream.writeRawData("data", 4);
+    stream << quint32(data.size());
+    stream.writeRawData(data.constData(), data.size());
+    return stream.status() == QDataStream::Ok;
+}
+
+/**
+ * Lays out a project on disk exactly the way Movie saves one, and returns its JSON filename.
+ */
+static QString CreateProject (const QString &name, int numberOfFrames, int numberOfSoundEffects,
+                              QList<SoundEffect> &sounds)
+{
+    Settings settings;
+    int w = settings.Get("settings/imageWidth").toInt();
+    int h = settings.Get("settings/imageHeight").toInt();
+    int fps = settings.Get("settings/framesPerSecond").toInt();
+    QDir storage (settings.Get("settings/imageStorageLocation").toString());
+    storage.mkpath(name);
+    QDir project (storage.filePath(name));
+
+    if (!BenchmarkUtils::WriteFrames(project, name, numberOfFrames, w, h)) {
+        throw PLSException ("Could not write the frames to " + project.absolutePath());
+    }
+
+    double movieSeconds = double(numberOfFrames) / double(fps);
+    QString musicFilename = project.filePath("music.wav");
+    if (!WriteToneFile(musicFilename, 220.0, movieSeconds + 10.0)) {
+        throw PLSException ("Could not write " + musicFilename);
+    }
+    SoundEffect music (musicFilename, 0, 0.0, movieSeconds + 10.0, 0.5);
+    sounds.append(music);
+
+    QJsonArray sfxArray;
+    for (int s = 0; s < numberOfSoundEffects; ++s) {
+        QString sfxFilename = project.filePath(QString("sfx%1.wav").arg(s));
+        if (!WriteToneFile(sfxFilename, 440.0 + 110.0 * s, 2.0)) {
+            throw PLSException ("Could not write " + sfxFilename);
+        }
+        int startFrame = numberOfFrames * s / std::max(numberOfSoundEffects, 1);
+        SoundEffect sfx (sfxFilename, startFrame, 0.25, 1.75, 1.0);
+        sounds.append(sfx);
+        QJsonObject sfxObject;
+        sfx.save(sfxObject);
+        sfxArray.append(sfxObject);
+    }
+
+    QJsonObject json;
+    json["name"] = name;
+    json["numberOfFrames"] = numberOfFrames;
+    json["framesPerSecond"] = fps;
+    json["sfx"] = sfxArray;
+    QJsonObject backgroundObject;
+    music.save(backgroundObject);
+    json["backgroundMusic"] = backgroundObject;
+
+    QString jsonFilename = project.filePath(name + ".json");
+    if (!BenchmarkUtils::SaveJson(json, jsonFilename)) {
+        throw PLSException ("Could not write " + jsonFilename);
+    }
+    return jsonFilename;
+}
+
+static QJsonObject TimeExport (Movie &movie, const QString &filename, const QString &title)
+{
+    QElapsedTimer timer;
+    timer.start();
+    movie.encodeToFile(filename, title, "Made by the encode benchmark");
+    double millis = double(timer.nsecsElapsed()) / 1.0e6;
+
+    QJsonObject report = movie.getLastEncodingReport();
+    QJsonObject counters = report["counters"].toObject();
+    double frames = counters["videoFramesEncoded"].toDouble() + counters["videoFramesReused"].toDouble();
+
+    QJsonObject result;
+    result["wallMillis"] = millis;
+    result["framesPerSecond"] = millis > 0 ? frames * 1000.0 / millis : 0.0;
+    result["peakRssMegabytes"] = double(BenchmarkUtils::PeakResidentBytes()) / (1024.0 * 1024.0);
+    result["stageMillis"] = report["stageMillis"];
+    return result;
+}
+
+static QJsonObject TimeAudioMix (const QList<SoundEffect> &sounds, double seconds)
+{
+    EncodeStatistics statistics;
+    QElapsedTimer timer;
+    timer.start();
+    {
+        AudioJoiner joiner;
+        for (auto &&sound: sounds) {
+            joiner.AddFile(sound.getFilename(), sound.getStartTime(), sound.getInPoint(),
+                           sound.getOutPoint(), sound.getVolume());
+        }
+        joiner.SetFormat(AV_SAMPLE_FMT_FLTP);
+        joiner.SetSampleRate(SAMPLE_RATE);
+        joiner.SetFrameSize(1024);
+        joiner.SetStatistics(&statistics);
+        joiner.StartStream();
+
+        // The mix is padded with silence forever, so just take as much as the movie needs
+        qint64 samples = 0;
+        qint64 samplesNeeded = qint64(seconds * SAMPLE_RATE);
+        while (samples < samplesNeeded) {
+            samples += joiner.GetNextFrame()->nb_samples;
+        }
+    }
+    statistics.Finish();
+    double millis = double(timer.nsecsElapsed()) / 1.0e6;
+
+    QJsonObject result;
+    result["wallMillis"] = millis;
+    result["realtimeFactor"] = millis > 0 ? seconds * 1000.0 / millis : 0.0;
+    result["peakRssMegabytes"] = double(BenchmarkUtils::PeakResidentBytes()) / (1024.0 * 1024.0);
+    result["stageMillis"] = statistics.ToJson()["stageMillis"];
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    // The title and credits are drawn with a QGraphicsScene, so this needs a QApplication, but
+    // nothing is ever shown.
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication a(argc, argv);
+    QCoreApplication::setApplicationName("encode_benchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Exports a synthetic project and compares the timings against a baseline.");
+    parser.addHelpOption();
+    QCommandLineOption framesOption ("frames", "Number of captured frames.", "N", "300");
+    QCommandLineOption widthOption ("width", "Frame width.", "pixels", "640");
+    QCommandLineOption heightOption ("height", "Frame height.", "pixels", "480");
+    QCommandLineOption fpsOption ("fps", "Frames per second.", "N", "15");
+    QCommandLineOption soundEffectsOption ("sound-effects", "Number of sound effects.", "N", "8");
+    QCommandLineOption baselineOption ("baseline", "Baseline to compare against.", "file", "encode_baseline.json");
+    QCommandLineOption updateBaselineOption ("update-baseline", "Replace the baseline with this run's results.");
+    QCommandLineOption toleranceOption ("tolerance", "Allowed slowdown before a metric counts as a regression.", "fraction", "0.15");
+    QCommandLineOption outputOption ("output", "Also write this run's results to a file.", "file");
+    QCommandLineOption keepOption ("keep", "Keep the generated project and movies.");
+    parser.addOptions({framesOption, widthOption, heightOption, fpsOption, soundEffectsOption,
+                       baselineOption, updateBaselineOption, toleranceOption, outputOption, keepOption});
+    parser.process(a);
+
+    int numberOfFrames = parser.value(framesOption).toInt();
+    int fps = parser.value(fpsOption).toInt();
+    if (numberOfFrames < 1 || fps < 1) {
+        qWarning() << "The number of frames and the frame rate must both be positive";
+        return 1;
+    }
+
+    // Resolve these before changing directory
+    QString baselineFilename = QFileInfo(parser.value(baselineOption)).absoluteFilePath();
+    QString outputFilename;
+    if (parser.isSet(outputOption)) {
+        outputFilename = QFileInfo(parser.value(outputOption)).absoluteFilePath();
+    }
+
+    // Settings are stored in the current directory: keep the real ones out of this
+    QTemporaryDir workDirectory;
+    workDirectory.setAutoRemove(!parser.isSet(keepOption));
+    if (!workDirectory.isValid() || !QDir::setCurrent(workDirectory.path())) {
+        qWarning() << "Could not create a working directory";
+        return 1;
+    }
+    QDir work (workDirectory.path());
+    QTextStream out (stdout);
+    out << "Working in " << work.absolutePath() << '\n';
+    out.flush();
+
+    Settings settings;
+    settings.Set("settings/imageStorageLocation", work.filePath("projects"));
+    settings.Set("settings/imageWidth", parser.value(widthOption).toInt());
+    settings.Set("settings/imageHeight", parser.value(heightOption).toInt());
+    settings.Set("settings/framesPerSecond", fps);
+    settings.Set("settings/preTitleScreenLocation", work.filePath("PreTitleScreen.jpg"));
+    BenchmarkUtils::SyntheticFrame(0, 1, parser.value(widthOption).toInt(), parser.value(heightOption).toInt())
+            .save(work.filePath("PreTitleScreen.jpg"), "JPG", 90);
+
+    QJsonObject results;
+    try {
+        QList<SoundEffect> sounds;
+        QString name = "benchmark";
+        QString jsonFilename = CreateProject(name, numberOfFrames, parser.value(soundEffectsOption).toInt(), sounds);
+        QString movieFilename = work.filePath(name + ".mp4");
+
+        Movie movie (name);
+        if (!movie.load(jsonFilename)) {
+            qWarning() << "Could not load the generated project" << jsonFilename;
+            return 1;
+        }
+        results["exportCold"] = TimeExport(movie, movieFilename, "Encode Benchmark");
+        results["exportNewTitle"] = TimeExport(movie, movieFilename, "Encode Benchmark, Take Two");
+        results["exportRemux"] = TimeExport(movie, movieFilename, "Encode Benchmark, Take Two");
+
+        double seconds = settings.Get("settings/preTitleScreenDuration").toDouble() +
+                         settings.Get("settings/titleScreenDuration").toDouble() +
+                         double(numberOfFrames) / double(fps) +
+                         settings.Get("settings/creditsDuration").toDouble();
+        results["audioMix"] = TimeAudioMix(sounds, seconds);
+    } catch (const Movie::EncodingFailedException &e) {
+        qWarning() << "Export failed:" << e.message();
+        return 1;
+    } catch (const PLSException &e) {
+        qWarning() << e.message();
+        return 1;
+    }
+
+    if (!outputFilename.isEmpty() && !BenchmarkUtils::SaveJson(results, outputFilename)) {
+        qWarning() << "Could not write" << outputFilename;
+    }
+
+    int regressions = BenchmarkUtils::CompareWithBaseline(results, baselineFilename,
+                                                          {"wallMillis", "peakRssMegabytes"},
+                                                          parser.value(toleranceOption).toDouble(),
+                                                          parser.isSet(updateBaselineOption));
+    return regressions == 0 ? 0 : 2;
+}
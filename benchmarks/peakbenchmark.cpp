@@ -0,0 +1,213 @@
+/*
+ * Peak extraction microbenchmark.
+ *
+ * Generates a few minutes of synthetic interleaved stereo audio and measures how many samples per
+ * second each way of finding the waveform's peaks gets through:
+ *
+ *   legacyLoop     the per-sample loop Waveform::addBuffer used to run: pcmToReal() and fabs() in
+ *                  double precision, with a floating-point pixel boundary check on every sample
+ *   s16<impl>      PeakKernel::Buckets on 16-bit samples, 256 frames per bucket
+ *   float<impl>    the same on float samples
+ *   pyramid        PeakPyramid::AddSamples fed in decoder-sized buffers, which is the whole cost
+ *                  of analysing a file once it's decoded
+ *
+ * where <impl> is each of Scalar, SSE2 and AVX2 that this CPU supports. Each scenario is run
+ * several times and the fastest run is kept. The results are compared against a stored baseline
+ * (written on the first run, or with --update-baseline).
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QVector>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include "benchmarkutils.h"
+#include "peakkernel.h"
+#include "peakpyramid.h"
+#include "utils.h"
+
+static const int SAMPLE_RATE = 48000;
+static const int CHANNELS = 2;
+static const int FRAMES_PER_BUCKET = 256;
+static const int FRAMES_PER_BUFFER = 4608; // What the MP3 decoder typically hands over at a time
+static const int WAVEFORM_WIDTH = 800;
+
+// Keeps the compiler from optimizing the measured work away
+static volatile double sink;
+
+static QVector<qint16> SyntheticAudio (int frames)
+{
+    QVector<qint16> samples (frames * CHANNELS);
+    quint32 state = 12345;
+    for (int frame = 0; frame < frames; ++frame) {
+        double t = double(frame) / SAMPLE_RATE;
+        double envelope = 0.5 + 0.5 * std::sin(2.0 * M_PI * 0.25 * t);
+        for (int channel = 0; channel < CHANNELS; ++channel) {
+            state = state * 1664525u + 1013904223u;
+            double noise = double(int(state >> 16) - 32768) / 32768.0;
+            double value = envelope * (0.7 * std::sin(2.0 * M_PI * (220.0 + 110.0 * channel) * t) + 0.1 * noise);
+            samples[frame * CHANNELS + channel] = realToPcm(value);
+        }
+    }
+    return samples;
+}
+
+/**
+ * What Waveform::addBuffer did with each decoded buffer, kept here to measure against
+ */
+static void LegacyLoop (const qint16 *data, int numberOfSamplesInThisBuffer, qreal microsecondsPerPixel,
+                        QVector<qreal> &maxValues)
+{
+    qreal microsecondsPerSample = 1000000.0 / SAMPLE_RATE;
+    quint64 pixel = 0;
+    qreal max = 0.0;
+    for (int sample = 0; sample < numberOfSamplesInThisBuffer; sample++) {
+        qreal v = fabs(pcmToReal(data[sample]));
+        max = std::max(max, v);
+        if ((sample+1) * microsecondsPerSample > (pixel+1)*microsecondsPerPixel) {
+            maxValues.append(max);
+            max = 0;
+            pixel++;
+        }
+    }
+    maxValues.append(max);
+}
+
+/**
+ * Runs the work repeats times, returning the samples per second of the fastest run
+ */
+static double Measure (qint64 numberOfSamples, int repeats, const std::function<void()> &work)
+{
+    qint64 fastest = std::numeric_limits<qint64>::max();
+    for (int run = 0; run < repeats; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        work();
+        fastest = std::min(fastest, timer.nsecsElapsed());
+    }
+    return fastest > 0 ? double(numberOfSamples) * 1.0e9 / double(fastest) : 0.0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("peak_benchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures waveform peak extraction throughput against a baseline.");
+    parser.addHelpOption();
+    QCommandLineOption secondsOption ("seconds", "Length of the synthetic audio.", "N", "300");
+    QCommandLineOption repeatsOption ("repeats", "Number of runs of each scenario (the fastest is kept).", "N", "5");
+    QCommandLineOption baselineOption ("baseline", "Baseline to compare against.", "file", "peak_baseline.json");
+    QCommandLineOption updateBaselineOption ("update-baseline", "Replace the baseline with this run's results.");
+    QCommandLineOption toleranceOption ("tolerance", "Allowed slowdown before a metric counts as a regression.", "fraction", "0.15");
+    QCommandLineOption outputOption ("output", "Also write this run's results to a file.", "file");
+    parser.addOptions({secondsOption, repeatsOption, baselineOption, updateBaselineOption,
+                       toleranceOption, outputOption});
+    parser.process(a);
+
+    int seconds = parser.value(secondsOption).toInt();
+    int repeats = parser.value(repeatsOption).toInt();
+    if (seconds < 1 || repeats < 1) {
+        qWarning() << "Need a positive length and number of repeats";
+        return 1;
+    }
+
+    QTextStream out (stdout);
+    out << "Generating " << seconds << " s of stereo audio\n";
+    out.flush();
+
+    const int frames = seconds * SAMPLE_RATE;
+    const qint64 numberOfSamples = qint64(frames) * CHANNELS;
+    QVector<qint16> audio = SyntheticAudio(frames);
+    QVector<float> floatAudio (audio.size());
+    for (int sample = 0; sample < audio.size(); ++sample) {
+        floatAudio[sample] = float(pcmToReal(audio[sample]));
+    }
+    const int numberOfBuckets = (frames + FRAMES_PER_BUCKET - 1) / FRAMES_PER_BUCKET;
+    QVector<qint16> s16Minimum (numberOfBuckets), s16Maximum (numberOfBuckets);
+    QVector<float> floatMinimum (numberOfBuckets), floatMaximum (numberOfBuckets);
+
+    QJsonObject results;
+    auto addResult = [&](const QString &name, double samplesPerSecond) {
+        QJsonObject result;
+        result["samplesPerSecond"] = samplesPerSecond;
+        results[name] = result;
+    };
+
+    // The old loop ran once per decoded buffer, so it does here too
+    qreal microsecondsPerPixel = 1000000.0 * seconds / WAVEFORM_WIDTH;
+    double legacy = Measure(numberOfSamples, repeats, [&]() {
+        QVector<qreal> maxValues;
+        for (int frame = 0; frame < frames; frame += FRAMES_PER_BUFFER) {
+            int count = std::min(FRAMES_PER_BUFFER, frames - frame) * CHANNELS;
+            LegacyLoop(audio.constData() + qint64(frame) * CHANNELS, count, microsecondsPerPixel, maxValues);
+        }
+        sink = maxValues.isEmpty() ? 0.0 : maxValues.last();
+    });
+    addResult("legacyLoop", legacy);
+
+    using PeakKernel::Implementation;
+    for (auto implementation: {Implementation::SCALAR, Implementation::SSE2, Implementation::AVX2}) {
+        if (!PeakKernel::IsAvailable(implementation)) {
+            continue;
+        }
+        QString name = PeakKernel::GetName(implementation);
+        name[0] = name[0].toUpper();
+
+        double s16 = Measure(numberOfSamples, repeats, [&]() {
+            PeakKernel::Buckets(implementation, audio.constData(), frames, CHANNELS, FRAMES_PER_BUCKET,
+                                s16Minimum.data(), s16Maximum.data());
+            sink = s16Maximum.last();
+        });
+        addResult("s16" + name, s16);
+
+        double floats = Measure(numberOfSamples, repeats, [&]() {
+            PeakKernel::Buckets(implementation, floatAudio.constData(), frames, CHANNELS, FRAMES_PER_BUCKET,
+                                floatMinimum.data(), floatMaximum.data());
+            sink = floatMaximum.last();
+        });
+        addResult("float" + name, floats);
+    }
+
+    double pyramid = Measure(numberOfSamples, repeats, [&]() {
+        PeakPyramid peaks (SAMPLE_RATE);
+        for (int frame = 0; frame < frames; frame += FRAMES_PER_BUFFER) {
+            int count = std::min(FRAMES_PER_BUFFER, frames - frame);
+            peaks.AddSamples(audio.constData() + qint64(frame) * CHANNELS, count, CHANNELS);
+        }
+        peaks.Finish();
+        sink = double(peaks.GetNumberOfSamples());
+    });
+    addResult("pyramid", pyramid);
+
+    out << "Fastest kernel on this CPU: " << PeakKernel::GetName(PeakKernel::Fastest()) << '\n';
+    for (auto result = results.constBegin(); result != results.constEnd(); ++result) {
+        double samplesPerSecond = result.value().toObject()["samplesPerSecond"].toDouble();
+        out << "    " << result.key() << ": " << QString::number(samplesPerSecond / 1.0e6, 'f', 1)
+            << " Msamples/s (" << QString::number(samplesPerSecond / legacy, 'f', 1) << "x the legacy loop)\n";
+    }
+    out.flush();
+
+    if (parser.isSet(outputOption)) {
+        QString outputFilename = QFileInfo(parser.value(outputOption)).absoluteFilePath();
+        if (!BenchmarkUtils::SaveJson(results, outputFilename)) {
+            qWarning() << "Could not write" << outputFilename;
+        }
+    }
+
+    int regressions = BenchmarkUtils::CompareWithBaseline(results, QFileInfo(parser.value(baselineOption)).absoluteFilePath(),
+                                                          QStringList(), parser.value(toleranceOption).toDouble(),
+                                                          parser.isSet(updateBaselineOption));
+    return regressions == 0 ? 0 : 2;
+}
@@ -0,0 +1,216 @@
+/*
+ * Headless playback and scrubbing benchmark.
+ *
+ * For each frame size (640x480, 1280x720 and 1920x1080) this builds a synthetic project and
+ * shows it in an offscreen QLabel the same size as the application's video label:
+ *
+ *   scrub      setStillFrame() on frames in a shuffled order, repainting each one, which is what
+ *              dragging the frame slider does. Records the latency percentiles.
+ *   playback   one pass of Movie::play(), recording how far each frame change lands from the
+ *              ideal interval (jitter percentiles), the achieved frame rate, and how many frames
+ *              Movie had to skip to keep up.
+ *
+ * The results are compared against a stored baseline (written on the first run, or with
+ * --update-baseline). All settings and files are kept in a temporary working directory.
+ */
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QJsonObject>
+#include <QLabel>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+
+#include "benchmarkutils.h"
+#include "movie.h"
+#include "settings.h"
+
+static const int LABEL_WIDTH = 640;
+static const int LABEL_HEIGHT = 480;
+
+static QString CreateProject (const QString &name, int numberOfFrames, int w, int h)
+{
+    Settings settings;
+    QDir storage (settings.Get("settings/imageStorageLocation").toString());
+    storage.mkpath(name);
+    QDir project (storage.filePath(name));
+    if (!BenchmarkUtils::WriteFrames(project, name, numberOfFrames, w, h)) {
+        return "";
+    }
+
+    QJsonObject json;
+    json["name"] = name;
+    json["numberOfFrames"] = numberOfFrames;
+    json["framesPerSecond"] = settings.Get("settings/framesPerSecond").toInt();
+    QString jsonFilename = project.filePath(name + ".json");
+    if (!BenchmarkUtils::SaveJson(json, jsonFilename)) {
+        return "";
+    }
+    return jsonFilename;
+}
+
+static void AddPercentiles (QJsonObject &result, const QString &prefix, QVector<double> &samples)
+{
+    result[prefix + "P50"] = BenchmarkUtils::Percentile(samples, 50);
+    result[prefix + "P95"] = BenchmarkUtils::Percentile(samples, 95);
+    result[prefix + "P99"] = BenchmarkUtils::Percentile(samples, 99);
+    result[prefix + "Max"] = BenchmarkUtils::Percentile(samples, 100);
+}
+
+static void MeasureScrubbing (Movie &movie, QLabel &label, int numberOfScrubs, QJsonObject &result)
+{
+    int numberOfFrames = movie.getNumberOfFrames();
+    QVector<double> latencies;
+    latencies.reserve(numberOfScrubs);
+    quint32 state = 12345;
+    for (int scrub = 0; scrub < numberOfScrubs; ++scrub) {
+        state = state * 1664525u + 1013904223u;
+        int frame = int((state >> 8) % quint32(numberOfFrames));
+
+        QElapsedTimer timer;
+        timer.start();
+        movie.setStillFrame(frame, &label);
+        label.repaint();
+        latencies.append(double(timer.nsecsElapsed()) / 1.0e6);
+    }
+    AddPercentiles(result, "scrubMillis", latencies);
+}
+
+static void MeasurePlayback (Movie &movie, QLabel &label, int fps, QJsonObject &result)
+{
+    int numberOfFrames = movie.getNumberOfFrames();
+    QVector<qint64> changeTimes;
+    QElapsedTimer clock;
+    QEventLoop loop;
+
+    // Stop just before the end: past the last frame Movie loops back to the start and resets its
+    // skipped-frame count.
+    auto connection = QObject::connect(&movie, &Movie::frameChanged, [&](int frame) {
+        changeTimes.append(clock.nsecsElapsed());
+        if (frame >= numberOfFrames - 2) {
+            movie.stop();
+            loop.quit();
+        }
+    });
+    QTimer::singleShot(numberOfFrames * 1000 / fps * 3 + 5000, &loop, &QEventLoop::quit);
+
+    clock.start();
+    movie.play(0, &label);
+    loop.exec();
+    qint64 elapsed = clock.nsecsElapsed();
+    movie.stop();
+    QObject::disconnect(connection);
+
+    double idealMillis = 1000.0 / double(fps);
+    QVector<double> jitter;
+    for (int change = 1; change < changeTimes.size(); ++change) {
+        double interval = double(changeTimes[change] - changeTimes[change - 1]) / 1.0e6;
+        jitter.append(std::abs(interval - idealMillis));
+    }
+    AddPercentiles(result, "playbackJitterMillis", jitter);
+    result["playbackFramesPerSecond"] = elapsed > 0 ? double(changeTimes.size()) * 1.0e9 / double(elapsed) : 0.0;
+    result["skippedFrames"] = movie.getSkippedFrameCount();
+}
+
+int main(int argc, char *argv[])
+{
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication a(argc, argv);
+    QCoreApplication::setApplicationName("playback_benchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures scrubbing latency and playback timing against a baseline.");
+    parser.addHelpOption();
+    QCommandLineOption framesOption ("frames", "Number of frames in each project.", "N", "150");
+    QCommandLineOption fpsOption ("fps", "Frames per second.", "N", "15");
+    QCommandLineOption scrubsOption ("scrubs", "Number of still frames to show when scrubbing.", "N", "200");
+    QCommandLineOption baselineOption ("baseline", "Baseline to compare against.", "file", "playback_baseline.json");
+    QCommandLineOption updateBaselineOption ("update-baseline", "Replace the baseline with this run's results.");
+    QCommandLineOption toleranceOption ("tolerance", "Allowed slowdown before a metric counts as a regression.", "fraction", "0.25");
+    QCommandLineOption outputOption ("output", "Also write this run's results to a file.", "file");
+    QCommandLineOption keepOption ("keep", "Keep the generated projects.");
+    parser.addOptions({framesOption, fpsOption, scrubsOption, baselineOption, updateBaselineOption,
+                       toleranceOption, outputOption, keepOption});
+    parser.process(a);
+
+    int numberOfFrames = parser.value(framesOption).toInt();
+    int fps = parser.value(fpsOption).toInt();
+    int numberOfScrubs = parser.value(scrubsOption).toInt();
+    if (numberOfFrames < 3 || fps < 1 || numberOfScrubs < 1) {
+        qWarning() << "Need at least three frames, and a positive frame rate and number of scrubs";
+        return 1;
+    }
+
+    QString baselineFilename = QFileInfo(parser.value(baselineOption)).absoluteFilePath();
+    QString outputFilename;
+    if (parser.isSet(outputOption)) {
+        outputFilename = QFileInfo(parser.value(outputOption)).absoluteFilePath();
+    }
+
+    // Settings are stored in the current directory: keep the real ones out of this
+    QTemporaryDir workDirectory;
+    workDirectory.setAutoRemove(!parser.isSet(keepOption));
+    if (!workDirectory.isValid() || !QDir::setCurrent(workDirectory.path())) {
+        qWarning() << "Could not create a working directory";
+        return 1;
+    }
+    QDir work (workDirectory.path());
+    QTextStream out (stdout);
+    out << "Working in " << work.absolutePath() << '\n';
+    out.flush();
+
+    Settings settings;
+    settings.Set("settings/imageStorageLocation", work.filePath("projects"));
+    settings.Set("settings/framesPerSecond", fps);
+
+    QLabel label;
+    label.setFixedSize(LABEL_WIDTH, LABEL_HEIGHT);
+    label.show();
+    a.processEvents();
+
+    const QList<QSize> frameSizes {QSize(640, 480), QSize(1280, 720), QSize(1920, 1080)};
+    QJsonObject results;
+    for (auto &&size: frameSizes) {
+        QString name = QString("playback_%1x%2").arg(size.width()).arg(size.height());
+        settings.Set("settings/imageWidth", size.width());
+        settings.Set("settings/imageHeight", size.height());
+        QString jsonFilename = CreateProject(name, numberOfFrames, size.width(), size.height());
+        if (jsonFilename.isEmpty()) {
+            qWarning() << "Could not create the project" << name;
+            return 1;
+        }
+
+        Movie movie (name);
+        if (!movie.load(jsonFilename)) {
+            qWarning() << "Could not load the generated project" << jsonFilename;
+            return 1;
+        }
+
+        QJsonObject result;
+        MeasureScrubbing(movie, label, numberOfScrubs, result);
+        MeasurePlayback(movie, label, fps, result);
+        result["peakRssMegabytes"] = double(BenchmarkUtils::PeakResidentBytes()) / (1024.0 * 1024.0);
+        results[name] = result;
+    }
+
+    if (!outputFilename.isEmpty() && !BenchmarkUtils::SaveJson(results, outputFilename)) {
+        qWarning() << "Could not write" << outputFilename;
+    }
+
+    QStringList lowerIsBetter {"peakRssMegabytes", "skippedFrames"};
+    for (auto &&prefix: {"scrubMillis", "playbackJitterMillis"}) {
+        for (auto &&suffix: {"P50", "P95", "P99", "Max"}) {
+            lowerIsBetter << QString(prefix) + suffix;
+        }
+    }
+    int regressions = BenchmarkUtils::CompareWithBaseline(results, baselineFilename, lowerIsBetter,
+                                                          parser.value(toleranceOption).toDouble(),
+                                                          parser.isSet(updateBaselineOption));
+    return regressions == 0 ? 0 : 2;
+}
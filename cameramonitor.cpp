@@ -1,34 +1,192 @@
 #include "cameramonitor.h"
 
-CameraMonitor::CameraMonitor(QObject *parent, QCameraInfo camera) :
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+static const int POLL_INTERVAL_MS = 1000;
+
+CameraMonitor::CameraMonitor(QObject *parent, QCameraInfo camera, const QString &deviceDirectory) :
     QThread (parent),
-    _camera (camera)
+    _camera (camera),
+    _deviceDirectory (deviceDirectory),
+    _wakeFd (-1)
 {
+#ifdef Q_OS_LINUX
+    _wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
 }
 
 
 CameraMonitor::~CameraMonitor()
 {
     quit();
-    requestInterruption();
+    Stop();
     wait();
+#ifdef Q_OS_LINUX
+    if (_wakeFd >= 0) {
+        close(_wakeFd);
+    }
+#endif
+}
+
+void CameraMonitor::Stop()
+{
+    requestInterruption();
+    _threadWait.release();
+#ifdef Q_OS_LINUX
+    if (_wakeFd >= 0) {
+        quint64 one = 1;
+        if (write(_wakeFd, &one, sizeof(one)) < 0) {
+            qDebug() << "Could not wake the camera monitor:" << strerror(errno);
+        }
+    }
+#endif
 }
 
 void CameraMonitor::run()
 {
     qDebug() << "Starting a new check thread";
+    if (WatchDeviceDirectory()) {
+        return;
+    }
+    qDebug() << "Not watching" << _deviceDirectory << "for cameras, checking every" << POLL_INTERVAL_MS << "ms instead";
+    PollAvailableCameras();
+}
+
+bool CameraMonitor::WatchDeviceDirectory()
+{
+#ifdef Q_OS_LINUX
+    QString cameraFile;
+    if (!_camera.isNull()) {
+        cameraFile = QFileInfo(_camera.deviceName()).fileName();
+        if (!IsVideoDevice(cameraFile)) {
+            return false;
+        }
+    }
+    if (_wakeFd < 0) {
+        return false;
+    }
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const uint32_t mask = IN_CREATE | IN_DELETE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO;
+    if (inotify_add_watch(fd, QFile::encodeName(_deviceDirectory).constData(), mask) < 0) {
+        close(fd);
+        return false;
+    }
+
+    // The watch is in place, so anything that happens from now on will be seen. Take stock of
+    // what is already there. A device is only "added" once it can be opened: udev creates the
+    // node first and fixes its permissions afterwards.
+    QDir directory (_deviceDirectory);
+    QSet<QString> usable;
+    for (auto &&name: directory.entryList(QDir::System | QDir::Files)) {
+        if (IsVideoDevice(name) && QFileInfo(directory.absoluteFilePath(name)).isReadable()) {
+            usable.insert(name);
+        }
+    }
+    if (!cameraFile.isEmpty() && !directory.exists(cameraFile)) {
+        close(fd);
+        emit cameraLost();
+        return true;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = {{fd, POLLIN, 0}, {_wakeFd, POLLIN, 0}};
+    bool lost (false);
+    while (!lost && !isInterruptionRequested()) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qDebug() << "Camera monitor poll failed:" << strerror(errno);
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            continue;
+        }
+        for (char *next = buffer; next < buffer + length; ) {
+            auto event = reinterpret_cast<const inotify_event *>(next);
+            next += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were dropped, so the only thing to do is look again
+                if (!cameraFile.isEmpty() && !directory.exists(cameraFile)) {
+                    lost = true;
+                }
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+            QString name = QFile::decodeName(event->name);
+            if (!IsVideoDevice(name)) {
+                continue;
+            }
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                usable.remove(name);
+                if (name == cameraFile) {
+                    lost = true;
+                }
+            } else if (!usable.contains(name) && QFileInfo(directory.absoluteFilePath(name)).isReadable()) {
+                usable.insert(name);
+                emit cameraAdded(directory.absoluteFilePath(name));
+            }
+        }
+    }
+    close(fd);
+    if (lost) {
+        emit cameraLost();
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CameraMonitor::PollAvailableCameras()
+{
+    QSet<QString> known;
+    bool firstPass (true);
     while (!isInterruptionRequested()) {
         auto cameras = QCameraInfo::availableCameras();
-        bool found (false);
+        bool found (_camera.isNull());
+        QSet<QString> present;
         for (auto camera: cameras) {
             if (camera == _camera) {
                 found = true;
             }
+            present.insert(camera.deviceName());
+            if (!firstPass && !known.contains(camera.deviceName())) {
+                emit cameraAdded(camera.deviceName());
+            }
         }
         if (!found) {
             emit cameraLost();
             return;
         }
-        _threadWait.tryAcquire(1, 1000);
+        known = present;
+        firstPass = false;
+        _threadWait.tryAcquire(1, POLL_INTERVAL_MS);
     }
 }
+
+bool CameraMonitor::IsVideoDevice (const QString &name)
+{
+    return name.startsWith("video");
+}
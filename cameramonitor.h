@@ -4,22 +4,51 @@
 #include <QThread>
 #include <QCameraInfo>
 #include <QSemaphore>
+#include <QSet>
+#include <QString>
 
+/**
+ * @brief The CameraMonitor class watches for the camera being unplugged, and for cameras being
+ * plugged in.
+ *
+ * On Linux it watches the device directory (normally /dev) with inotify, so it sleeps until a
+ * video device node is actually created or removed and costs nothing in between. Anywhere that
+ * isn't possible, or if the camera isn't a device node, it falls back to polling
+ * QCameraInfo::availableCameras() once a second. The device directory can be changed so that
+ * the monitor can be driven by creating and deleting files in a scratch directory.
+ *
+ * A monitor constructed with a null QCameraInfo only reports cameras being added.
+ */
 class CameraMonitor : public QThread
 {
     Q_OBJECT
 
 public:
-    CameraMonitor(QObject *parent, QCameraInfo camera);
+    CameraMonitor(QObject *parent, QCameraInfo camera, const QString &deviceDirectory = "/dev");
     ~CameraMonitor() override;
     void run() Q_DECL_OVERRIDE;
 
+    /**
+     * @brief Stop asks the thread to finish, waking it if it is waiting for a device event.
+     */
+    void Stop();
+
 signals:
     void cameraLost();
 
+    void cameraAdded(const QString &deviceName);
+
+private:
+    bool WatchDeviceDirectory();
+    void PollAvailableCameras();
+
+    static bool IsVideoDevice (const QString &name);
+
 private:
     QCameraInfo _camera;
+    QString _deviceDirectory;
     QSemaphore _threadWait;
+    int _wakeFd;
 };
 
 #endif // CAMERAMONITOR_H
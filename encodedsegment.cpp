@@ -0,0 +1,111 @@
+#include "encodedsegment.h"
+#include "plsexception.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+EncodedSegment::EncodedSegment(const QByteArray &key) :
+    _key (key)
+{
+}
+
+QByteArray EncodedSegment::GetKey () const
+{
+    return _key;
+}
+
+void EncodedSegment::SetExtradata (const uint8_t *data, int size)
+{
+    _extradata = QByteArray (reinterpret_cast<const char *>(data), size);
+}
+
+bool EncodedSegment::ExtradataMatches (const uint8_t *data, int size) const
+{
+    return _extradata == QByteArray::fromRawData (reinterpret_cast<const char *>(data), size);
+}
+
+void EncodedSegment::AddPacket (const AVPacket *packet, int64_t ptsOffset)
+{
+    Packet p;
+    p.pts = packet->pts == AV_NOPTS_VALUE ? AV_NOPTS_VALUE : packet->pts + ptsOffset;
+    p.dts = packet->dts == AV_NOPTS_VALUE ? AV_NOPTS_VALUE : packet->dts + ptsOffset;
+    p.duration = packet->duration;
+    p.flags = packet->flags;
+    p.data = QByteArray (reinterpret_cast<const char *>(packet->data), packet->size);
+    _packets.append(p);
+}
+
+int EncodedSegment::GetNumberOfPackets () const
+{
+    return _packets.size();
+}
+
+AVPacket *EncodedSegment::CreatePacket (int index, int64_t ptsOffset) const
+{
+    const Packet &p = _packets.at(index);
+    AVPacket *packet = av_packet_alloc();
+    if (!packet || av_new_packet(packet, p.data.size()) < 0) {
+        av_packet_free(&packet);
+        throw PLSException ("Ran out of memory copying a cached video packet");
+    }
+    memcpy (packet->data, p.data.constData(), size_t(p.data.size()));
+    packet->pts = p.pts == AV_NOPTS_VALUE ? AV_NOPTS_VALUE : p.pts + ptsOffset;
+    packet->dts = p.dts == AV_NOPTS_VALUE ? AV_NOPTS_VALUE : p.dts + ptsOffset;
+    packet->duration = p.duration;
+    packet->flags = p.flags;
+    return packet;
+}
+
+bool EncodedSegment::Load (const QString &filename)
+{
+    QFile file (filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in (&file);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != MAGIC || version != VERSION) {
+        return false;
+    }
+    QByteArray key;
+    in >> key;
+    if (key != _key) {
+        return false;
+    }
+
+    QByteArray extradata;
+    qint32 numberOfPackets;
+    in >> extradata >> numberOfPackets;
+    QList<Packet> packets;
+    for (qint32 i = 0; i < numberOfPackets && in.status() == QDataStream::Ok; i++) {
+        Packet p;
+        in >> p.pts >> p.dts >> p.duration >> p.flags >> p.data;
+        packets.append(p);
+    }
+    if (in.status() != QDataStream::Ok || packets.size() != numberOfPackets) {
+        return false;
+    }
+    _extradata = extradata;
+    _packets = packets;
+    return true;
+}
+
+void EncodedSegment::Save (const QString &filename) const
+{
+    // Written to a temporary file and renamed, so a crash mid-write can't leave a cache behind
+    // that looks valid
+    QSaveFile file (filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        throw PLSException ("Could not open the video cache file " + filename);
+    }
+    QDataStream out (&file);
+    out << MAGIC << VERSION << _key << _extradata << qint32(_packets.size());
+    for (auto &&p: _packets) {
+        out << p.pts << p.dts << p.duration << p.flags << p.data;
+    }
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        throw PLSException ("Could not write the video cache file " + filename);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef ENCODEDSEGMENT_H
+#define ENCODEDSEGMENT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+/**
+ * @brief The EncodedSegment class holds the compressed video packets for one run of frames that
+ * was encoded in its own encoder session, so it can be saved to disk and spliced back into a
+ * later encode without decoding or encoding any of those frames again. Timestamps are stored in
+ * frames, relative to the first frame of the segment.
+ */
+class EncodedSegment
+{
+public:
+    EncodedSegment (const QByteArray &key = QByteArray());
+
+    QByteArray GetKey () const;
+
+    void SetExtradata (const uint8_t *data, int size);
+
+    bool ExtradataMatches (const uint8_t *data, int size) const;
+
+    /**
+     * @brief AddPacket stores a copy of an encoded packet. ptsOffset is added to the packet's
+     * timestamps before they are stored.
+     */
+    void AddPacket (const AVPacket *packet, int64_t ptsOffset);
+
+    int GetNumberOfPackets () const;
+
+    /**
+     * @brief CreatePacket allocates a new packet holding a copy of stored packet "index", with
+     * ptsOffset added to its timestamps. The caller owns the returned packet.
+     */
+    AVPacket *CreatePacket (int index, int64_t ptsOffset) const;
+
+    /**
+     * @brief Load reads a segment saved by Save(). Returns false if the file is missing or
+     * unreadable, or if it was saved with a different key.
+     */
+    bool Load (const QString &filename);
+
+    /**
+     * @brief Save writes the segment to disk. Throws a PLSException if it could not be saved.
+     */
+    void Save (const QString &filename) const;
+
+private:
+    struct Packet {
+        qint64 pts;
+        qint64 dts;
+        qint64 duration;
+        qint32 flags;
+        QByteArray data;
+    };
+
+    QByteArray _key;
+    QByteArray _extradata;
+    QList<Packet> _packets;
+
+    static constexpr quint32 MAGIC = 0x504c5356; // "PLSV"
+    static constexpr quint32 VERSION = 1;
+};
+
+#endif // ENCODEDSEGMENT_H
@@ -0,0 +1,149 @@
+#include "encodestatistics.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QStringList>
+
+EncodeStatistics::EncodeStatistics() :
+    _totalNanoseconds (-1)
+{
+    for (auto &&t: _nanoseconds) {
+        t = 0;
+    }
+    for (auto &&c: _counts) {
+        c = 0;
+    }
+    _total.start();
+}
+
+void EncodeStatistics::Finish ()
+{
+    _totalNanoseconds = _total.nsecsElapsed();
+}
+
+void EncodeStatistics::AddTime (Stage stage, qint64 nanoseconds)
+{
+    _nanoseconds[stage] += nanoseconds;
+}
+
+void EncodeStatistics::Count (Counter counter, qint64 n)
+{
+    _counts[counter] += n;
+}
+
+qint64 EncodeStatistics::GetTime (Stage stage) const
+{
+    return _nanoseconds[stage];
+}
+
+qint64 EncodeStatistics::GetCount (Counter counter) const
+{
+    return _counts[counter];
+}
+
+qint64 EncodeStatistics::GetTotalTime () const
+{
+    if (_totalNanoseconds < 0) {
+        return _total.nsecsElapsed();
+    }
+    return _totalNanoseconds;
+}
+
+QJsonObject EncodeStatistics::ToJson () const
+{
+    QJsonObject stages;
+    for (int s = 0; s < NUMBER_OF_STAGES; s++) {
+        stages[StageName(Stage(s))] = double(_nanoseconds[s]) / 1.0e6;
+    }
+    QJsonObject counters;
+    for (int c = 0; c < NUMBER_OF_COUNTERS; c++) {
+        counters[CounterName(Counter(c))] = double(_counts[c]);
+    }
+
+    double totalSeconds = double(GetTotalTime()) / 1.0e9;
+    qint64 frames = _counts[VIDEO_FRAMES_ENCODED] + _counts[VIDEO_FRAMES_REUSED];
+
+    QJsonObject json;
+    json["totalMillis"] = totalSeconds * 1000.0;
+    json["videoFramesPerSecond"] = totalSeconds > 0 ? double(frames) / totalSeconds : 0.0;
+    double titleSeconds = double(_nanoseconds[TITLES]) / 1.0e9;
+    json["titleFramesPerSecond"] = titleSeconds > 0 ? double(_counts[TITLE_FRAMES_WRITTEN]) / titleSeconds : 0.0;
+    json["stageMillis"] = stages;
+    json["counters"] = counters;
+    return json;
+}
+
+QString EncodeStatistics::ToCsv () const
+{
+    QStringList lines;
+    lines << "kind,name,value";
+    lines << "total,totalMillis," + QString::number(double(GetTotalTime()) / 1.0e6);
+    for (int s = 0; s < NUMBER_OF_STAGES; s++) {
+        lines << "stage," + StageName(Stage(s)) + "," + QString::number(double(_nanoseconds[s]) / 1.0e6);
+    }
+    for (int c = 0; c < NUMBER_OF_COUNTERS; c++) {
+        lines << "counter," + CounterName(Counter(c)) + "," + QString::number(_counts[c].load());
+    }
+    return lines.join('\n') + '\n';
+}
+
+bool EncodeStatistics::SaveReport (const QString &filename) const
+{
+    QFile reportFile (filename);
+    if (!reportFile.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    if (filename.endsWith(".csv", Qt::CaseInsensitive)) {
+        reportFile.write(ToCsv().toUtf8());
+    } else {
+        reportFile.write(QJsonDocument(ToJson()).toJson());
+    }
+    return true;
+}
+
+QString EncodeStatistics::StageName (Stage stage)
+{
+    switch (stage) {
+    case TITLES:           return "titles";
+    case VIDEO_DECODE:     return "videoDecode";
+    case VIDEO_ENCODE:     return "videoEncode";
+    case CACHE_IO:         return "cacheIO";
+    case AUDIO_DECODE:     return "audioDecode";
+    case AUDIO_MIX:        return "audioMix";
+    case AUDIO_ENCODE:     return "audioEncode";
+    case MUX:              return "mux";
+    case NUMBER_OF_STAGES: break;
+    }
+    return "unknown";
+}
+
+QString EncodeStatistics::CounterName (Counter counter)
+{
+    switch (counter) {
+    case VIDEO_FRAMES_ENCODED: return "videoFramesEncoded";
+    case VIDEO_FRAMES_REUSED:  return "videoFramesReused";
+    case VIDEO_FRAMES_HELD:    return "videoFramesHeld";
+    case AUDIO_FRAMES:         return "audioFrames";
+    case PACKETS_WRITTEN:      return "packetsWritten";
+    case BYTES_WRITTEN:        return "bytesWritten";
+    case TITLE_FRAMES_WRITTEN: return "titleFramesWritten";
+    case NUMBER_OF_COUNTERS:   break;
+    }
+    return "unknown";
+}
+
+EncodeStatistics::ScopedTimer::ScopedTimer (EncodeStatistics *statistics, Stage stage) :
+    _statistics (statistics),
+    _stage (stage)
+{
+    if (_statistics) {
+        _timer.start();
+    }
+}
+
+EncodeStatistics::ScopedTimer::~ScopedTimer ()
+{
+    if (_statistics) {
+        _statistics->AddTime(_stage, _timer.nsecsElapsed());
+    }
+}
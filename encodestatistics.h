@@ -0,0 +1,94 @@
+#ifndef ENCODESTATISTICS_H
+#define ENCODESTATISTICS_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QString>
+#include <atomic>
+
+/**
+ * @brief The EncodeStatistics class collects where the time goes during one export: the time spent
+ * in each stage of the pipeline, plus a few counters. Stages may be timed from any thread. Time spent
+ * in a stage is summed across threads, so stages that overlap (e.g. muxing on the writer thread) can
+ * add up to more than the total.
+ */
+class EncodeStatistics
+{
+public:
+    enum Stage {
+        TITLES,         // Rendering and saving the title and credits frames
+        VIDEO_DECODE,   // Reading and decoding the frame image files
+        VIDEO_ENCODE,
+        CACHE_IO,       // Loading and saving the encoded segment cache
+        AUDIO_DECODE,
+        AUDIO_MIX,
+        AUDIO_ENCODE,
+        MUX,            // Writing packets to the output file (the disk I/O, on the writer thread)
+        NUMBER_OF_STAGES
+    };
+
+    enum Counter {
+        VIDEO_FRAMES_ENCODED,
+        VIDEO_FRAMES_REUSED,
+        VIDEO_FRAMES_HELD,      // Encoded again from a frame that was already decoded
+        AUDIO_FRAMES,
+        PACKETS_WRITTEN,
+        BYTES_WRITTEN,
+        TITLE_FRAMES_WRITTEN,
+        NUMBER_OF_COUNTERS
+    };
+
+    EncodeStatistics();
+
+    /**
+     * @brief Finish stops the overall clock, which starts when this object is created.
+     */
+    void Finish ();
+
+    void AddTime (Stage stage, qint64 nanoseconds);
+
+    void Count (Counter counter, qint64 n = 1);
+
+    qint64 GetTime (Stage stage) const;
+
+    qint64 GetCount (Counter counter) const;
+
+    qint64 GetTotalTime () const;
+
+    QJsonObject ToJson () const;
+
+    QString ToCsv () const;
+
+    /**
+     * @brief SaveReport writes the report as CSV if the filename ends in .csv, or as JSON otherwise.
+     * Returns false if the file could not be written.
+     */
+    bool SaveReport (const QString &filename) const;
+
+    /**
+     * @brief The ScopedTimer class adds the time until it goes out of scope to a stage. A null
+     * statistics pointer is allowed, and makes the timer do nothing.
+     */
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer (EncodeStatistics *statistics, Stage stage);
+        ~ScopedTimer ();
+
+    private:
+        EncodeStatistics *_statistics;
+        Stage _stage;
+        QElapsedTimer _timer;
+    };
+
+private:
+    static QString StageName (Stage stage);
+    static QString CounterName (Counter counter);
+
+    std::atomic<qint64> _nanoseconds[NUMBER_OF_STAGES];
+    std::atomic<qint64> _counts[NUMBER_OF_COUNTERS];
+    QElapsedTimer _total;
+    qint64 _totalNanoseconds;
+};
+
+#endif // ENCODESTATISTICS_H
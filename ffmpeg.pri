@@ -0,0 +1,34 @@
+# FFmpeg libraries, shared by the application and the benchmarks
+
+win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lavutil
+
+INCLUDEPATH += $$PWD/../ffmpeg/win64/include
+DEPENDPATH += $$PWD/../ffmpeg/win64/include
+
+win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/avutil.lib
+else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libavutil.a
+
+win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lavcodec
+
+win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/avcodec.lib
+else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libavcodec.a
+
+win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lavformat
+
+win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/avformat.lib
+else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libavformat.a
+
+win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lavfilter
+
+win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/avfilter.lib
+else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libavfilter.a
+
+win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lswscale
+
+win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/swscale.lib
+else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libswscale.a
+
+win32: LIBS += -L$$PWD/../ffmpeg/win64/lib/ -lswresample
+
+win32:!win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/swresample.lib
+else:win32-g++: PRE_TARGETDEPS += $$PWD/../ffmpeg/win64/lib/libswresample.a
@@ -0,0 +1,344 @@
+#include "frametable.h"
+
+#include <QDebug>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <cstring>
+#include <limits>
+
+#include "plsexception.h"
+
+FrameTable::FrameTable () :
+    _map (nullptr),
+    _mappedRecords (nullptr),
+    _mappedStrings (nullptr),
+    _mappedRecordSize (RECORD_SIZE),
+    _mappedStringsSize (0),
+    _detached (true),
+    _numberOfFrames (0),
+    _modified (false)
+{
+}
+
+FrameTable::~FrameTable ()
+{
+    Clear();
+}
+
+bool FrameTable::Open (const QString &filename)
+{
+    Clear();
+    _file.setFileName(filename);
+    if (!_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    qint64 size = _file.size();
+    const uchar *map = size >= HEADER_SIZE ? _file.map(0, size) : nullptr;
+    if (!map) {
+        _file.close();
+        return false;
+    }
+
+    quint32 magic = qFromLittleEndian<quint32>(map);
+    quint32 version = qFromLittleEndian<quint32>(map + 4);
+    quint32 recordSize = qFromLittleEndian<quint32>(map + 8);
+    quint32 numberOfFrames = qFromLittleEndian<quint32>(map + 12);
+    quint64 stringsOffset = qFromLittleEndian<quint64>(map + 16);
+    quint64 stringsSize = qFromLittleEndian<quint64>(map + 24);
+    bool valid = magic == MAGIC &&
+                 version == VERSION &&
+                 recordSize >= quint32(RECORD_SIZE) &&
+                 quint64(HEADER_SIZE) + quint64(numberOfFrames) * recordSize <= stringsOffset &&
+                 stringsOffset + stringsSize <= quint64(size) &&
+                 numberOfFrames <= quint32(std::numeric_limits<int>::max());
+    if (!valid) {
+        _file.unmap(const_cast<uchar *>(map));
+        _file.close();
+        return false;
+    }
+
+    _map = map;
+    _mappedRecords = map + HEADER_SIZE;
+    _mappedStrings = reinterpret_cast<const char *>(map + stringsOffset);
+    _mappedRecordSize = int(recordSize);
+    _mappedStringsSize = qint64(stringsSize);
+    _numberOfFrames = int(numberOfFrames);
+    _detached = false;
+    return true;
+}
+
+void FrameTable::Clear ()
+{
+    if (_map) {
+        _file.unmap(const_cast<uchar *>(_map));
+        _map = nullptr;
+    }
+    if (_file.isOpen()) {
+        _file.close();
+    }
+    _mappedRecords = nullptr;
+    _mappedStrings = nullptr;
+    _mappedStringsSize = 0;
+    _detached = true;
+    _records.clear();
+    _strings.clear();
+    _numberOfFrames = 0;
+    _modified = false;
+}
+
+int FrameTable::GetNumberOfFrames () const
+{
+    return _numberOfFrames;
+}
+
+const uchar *FrameTable::RecordData (int index) const
+{
+    Q_ASSERT(index >= 0 && index < _numberOfFrames);
+    if (_detached) {
+        return reinterpret_cast<const uchar *>(_records.constData()) + qint64(index) * RECORD_SIZE;
+    } else {
+        return _mappedRecords + qint64(index) * _mappedRecordSize;
+    }
+}
+
+FrameTable::Frame FrameTable::GetFrame (int index) const
+{
+    Frame frame;
+    frame.id = GetId(index);
+    frame.filename = GetFilename(index);
+    frame.captureTime = GetCaptureTime(index);
+    frame.rotated = IsRotated(index);
+    frame.holdCount = GetHoldCount(index);
+    frame.checksum = GetChecksum(index);
+    return frame;
+}
+
+quint32 FrameTable::GetId (int index) const
+{
+    return qFromLittleEndian<quint32>(RecordData(index));
+}
+
+QString FrameTable::GetFilename (int index) const
+{
+    const uchar *record = RecordData(index);
+    quint32 offset = qFromLittleEndian<quint32>(record + 24);
+    quint32 length = qFromLittleEndian<quint32>(record + 28);
+    const char *strings = _detached ? _strings.constData() : _mappedStrings;
+    qint64 stringsSize = _detached ? _strings.size() : _mappedStringsSize;
+    if (qint64(offset) + length > stringsSize) {
+        return QString();
+    }
+    return QString::fromUtf8(strings + offset, int(length));
+}
+
+QDateTime FrameTable::GetCaptureTime (int index) const
+{
+    qint64 msecs = qFromLittleEndian<qint64>(RecordData(index) + 8);
+    return msecs != 0 ? QDateTime::fromMSecsSinceEpoch(msecs) : QDateTime();
+}
+
+bool FrameTable::IsRotated (int index) const
+{
+    return qFromLittleEndian<quint32>(RecordData(index) + 4) & ROTATED;
+}
+
+quint32 FrameTable::GetHoldCount (int index) const
+{
+    return qMax(quint32(1), qFromLittleEndian<quint32>(RecordData(index) + 16));
+}
+
+quint32 FrameTable::GetChecksum (int index) const
+{
+    return qFromLittleEndian<quint32>(RecordData(index) + 20);
+}
+
+void FrameTable::Detach ()
+{
+    if (_detached) {
+        return;
+    }
+    // Copy the records out, dropping any fields a newer version added after ours
+    _records.resize(_numberOfFrames * RECORD_SIZE);
+    for (int index = 0; index < _numberOfFrames; ++index) {
+        memcpy(_records.data() + qint64(index) * RECORD_SIZE, RecordData(index), RECORD_SIZE);
+    }
+    _strings = QByteArray (_mappedStrings, int(_mappedStringsSize));
+
+    _file.unmap(const_cast<uchar *>(_map));
+    _file.close();
+    _map = nullptr;
+    _mappedRecords = nullptr;
+    _mappedStrings = nullptr;
+    _mappedStringsSize = 0;
+    _detached = true;
+}
+
+void FrameTable::WriteRecord (uchar *record, const Frame &frame, quint32 filenameOffset, quint32 filenameLength) const
+{
+    qToLittleEndian<quint32>(frame.id, record);
+    qToLittleEndian<quint32>(frame.rotated ? ROTATED : 0, record + 4);
+    qToLittleEndian<qint64>(frame.captureTime.isValid() ? frame.captureTime.toMSecsSinceEpoch() : 0, record + 8);
+    qToLittleEndian<quint32>(qMax(quint32(1), frame.holdCount), record + 16);
+    qToLittleEndian<quint32>(frame.checksum, record + 20);
+    qToLittleEndian<quint32>(filenameOffset, record + 24);
+    qToLittleEndian<quint32>(filenameLength, record + 28);
+}
+
+void FrameTable::AppendFrame (const Frame &frame)
+{
+    InsertFrame(_numberOfFrames, frame);
+}
+
+void FrameTable::InsertFrame (int index, const Frame &frame)
+{
+    Q_ASSERT(index >= 0 && index <= _numberOfFrames);
+    Detach();
+    QByteArray filename = frame.filename.toUtf8();
+    quint32 offset = quint32(_strings.size());
+    _strings.append(filename);
+
+    uchar record[RECORD_SIZE];
+    WriteRecord(record, frame, offset, quint32(filename.size()));
+    _records.insert(index * RECORD_SIZE, reinterpret_cast<const char *>(record), RECORD_SIZE);
+    _numberOfFrames++;
+    _modified = true;
+}
+
+void FrameTable::RemoveFrame (int index)
+{
+    Q_ASSERT(index >= 0 && index < _numberOfFrames);
+    Detach();
+    _records.remove(index * RECORD_SIZE, RECORD_SIZE);
+    _numberOfFrames--;
+    // The file name is left in the pool: it's dropped when nothing uses it any more (see Save())
+    _modified = true;
+}
+
+void FrameTable::MoveFrame (int from, int to)
+{
+    Q_ASSERT(from >= 0 && from < _numberOfFrames && to >= 0 && to < _numberOfFrames);
+    if (from == to) {
+        return;
+    }
+    Detach();
+    char record[RECORD_SIZE];
+    char *records = _records.data();
+    memcpy(record, records + from * RECORD_SIZE, RECORD_SIZE);
+    if (from < to) {
+        memmove(records + from * RECORD_SIZE, records + (from + 1) * RECORD_SIZE, size_t(to - from) * RECORD_SIZE);
+    } else {
+        memmove(records + (to + 1) * RECORD_SIZE, records + to * RECORD_SIZE, size_t(from - to) * RECORD_SIZE);
+    }
+    memcpy(records + to * RECORD_SIZE, record, RECORD_SIZE);
+    _modified = true;
+}
+
+bool FrameTable::IsFilenameUsed (const QString &filename) const
+{
+    for (int index = 0; index < _numberOfFrames; ++index) {
+        if (GetFilename(index) == filename) {
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 FrameTable::GetMaximumId () const
+{
+    qint64 maximum = -1;
+    for (int index = 0; index < _numberOfFrames; ++index) {
+        maximum = qMax(maximum, qint64(GetId(index)));
+    }
+    return maximum;
+}
+
+void FrameTable::SetChecksum (int index, quint32 checksum)
+{
+    Detach();
+    uchar *record = reinterpret_cast<uchar *>(_records.data()) + qint64(index) * RECORD_SIZE;
+    qToLittleEndian<quint32>(checksum, record + 20);
+    _modified = true;
+}
+
+void FrameTable::SetHoldCount (int index, quint32 holdCount)
+{
+    Detach();
+    uchar *record = reinterpret_cast<uchar *>(_records.data()) + qint64(index) * RECORD_SIZE;
+    qToLittleEndian<quint32>(qMax(quint32(1), holdCount), record + 16);
+    _modified = true;
+}
+
+bool FrameTable::IsModified () const
+{
+    return _modified;
+}
+
+void FrameTable::Save (const QString &filename)
+{
+    Detach();
+
+    // Rebuild the string pool as it's written, so names no record uses any more are dropped
+    QByteArray records (_records);
+    QByteArray strings;
+    for (int index = 0; index < _numberOfFrames; ++index) {
+        uchar *record = reinterpret_cast<uchar *>(records.data()) + qint64(index) * RECORD_SIZE;
+        quint32 offset = qFromLittleEndian<quint32>(record + 24);
+        quint32 length = qFromLittleEndian<quint32>(record + 28);
+        if (qint64(offset) + length > _strings.size()) {
+            // A damaged record: GetFilename() already reads it as having no name, so save it so
+            // rather than copying from outside the pool
+            qDebug() << "Frame" << index << "has a file name outside the string pool";
+            length = 0;
+            offset = 0;
+            qToLittleEndian<quint32>(0, record + 28);
+        }
+        qToLittleEndian<quint32>(quint32(strings.size()), record + 24);
+        strings.append(_strings.constData() + offset, int(length));
+    }
+
+    uchar header[HEADER_SIZE];
+    qToLittleEndian<quint32>(MAGIC, header);
+    qToLittleEndian<quint32>(VERSION, header + 4);
+    qToLittleEndian<quint32>(RECORD_SIZE, header + 8);
+    qToLittleEndian<quint32>(quint32(_numberOfFrames), header + 12);
+    qToLittleEndian<quint64>(quint64(HEADER_SIZE + records.size()), header + 16);
+    qToLittleEndian<quint64>(quint64(strings.size()), header + 24);
+
+    // Written to a temporary file and renamed, so a crash mid-write can't leave a broken table
+    QSaveFile file (filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        throw PLSException ("Could not open the frame table " + filename);
+    }
+    bool written = file.write(reinterpret_cast<const char *>(header), HEADER_SIZE) == HEADER_SIZE &&
+                   file.write(records) == records.size() &&
+                   file.write(strings) == strings.size();
+    if (!written || !file.commit()) {
+        throw PLSException ("Could not write the frame table " + filename);
+    }
+    _strings = strings;
+    _records = records;
+    _modified = false;
+}
+
+quint32 FrameTable::Crc32 (const QByteArray &data)
+{
+    static quint32 table[256];
+    static bool tableReady = [] () {
+        for (quint32 n = 0; n < 256; ++n) {
+            quint32 c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return true;
+    } ();
+    Q_UNUSED(tableReady);
+
+    quint32 crc = 0xffffffffu;
+    for (char byte: data) {
+        crc = table[(crc ^ quint8(byte)) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
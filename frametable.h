@@ -0,0 +1,149 @@
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+
+/**
+ * @brief The FrameTable class holds the per-frame metadata of a movie in a compact binary file
+ * saved next to the project's JSON file: one fixed-size record per frame, with the frame's file
+ * name kept in a string pool at the end of the file.
+ *
+ * The file is memory-mapped when it is opened, and records are read straight out of the mapping,
+ * so opening a project with thousands of frames and looking up any one of them takes constant
+ * time: nothing is parsed. The first change copies the table into memory, and Save() writes it
+ * back out in one go.
+ *
+ * Layout (all values little-endian):
+ *   header  magic, version, record size, number of frames (4 x quint32),
+ *           string pool offset, string pool size (2 x quint64)
+ *   records id, flags (2 x quint32), capture time in ms since the epoch (qint64),
+ *           hold count, checksum, file name offset, file name length (4 x quint32)
+ *   string pool  UTF-8 file names, relative to the project's directory
+ * Readers step through the records by the record size in the header, so fields can be added to
+ * the end of a record without breaking older files.
+ */
+class FrameTable
+{
+public:
+    struct Frame {
+        quint32 id = 0;
+        QString filename;           // Relative to the project's directory
+        QDateTime captureTime;      // Invalid if unknown
+        bool rotated = false;       // Rotated 180 degrees when it was captured
+        quint32 holdCount = 1;      // How many frames of the movie it's shown for
+        quint32 checksum = 0;       // CRC-32 of the image file, or 0 if it hasn't been computed
+    };
+
+    FrameTable ();
+    ~FrameTable ();
+
+    FrameTable (const FrameTable &) = delete;
+    FrameTable &operator= (const FrameTable &) = delete;
+
+    /**
+     * @brief Open maps a table saved by Save(). Returns false, leaving the table empty, if the file
+     * is missing or isn't a valid frame table.
+     */
+    bool Open (const QString &filename);
+
+    /**
+     * @brief Clear empties the table, unmapping any open file.
+     */
+    void Clear ();
+
+    int GetNumberOfFrames () const;
+
+    Frame GetFrame (int index) const;
+
+    quint32 GetId (int index) const;
+    QString GetFilename (int index) const;
+    QDateTime GetCaptureTime (int index) const;
+    bool IsRotated (int index) const;
+    quint32 GetHoldCount (int index) const;
+    quint32 GetChecksum (int index) const;
+
+    void AppendFrame (const Frame &frame);
+
+    /**
+     * @brief InsertFrame inserts a record so that it ends up at "index". Like RemoveFrame() and
+     * MoveFrame(), this only moves fixed-size records around in memory: no frame file is touched.
+     */
+    void InsertFrame (int index, const Frame &frame);
+
+    void RemoveFrame (int index);
+
+    /**
+     * @brief MoveFrame moves the record at "from" so that it ends up at "to", shifting the records
+     * in between by one.
+     */
+    void MoveFrame (int from, int to);
+
+    /**
+     * @brief IsFilenameUsed returns true if any record refers to the file, e.g. because frames
+     * duplicated from one another share it.
+     */
+    bool IsFilenameUsed (const QString &filename) const;
+
+    /**
+     * @brief GetMaximumId returns the largest frame id in the table, or -1 if it is empty.
+     */
+    qint64 GetMaximumId () const;
+
+    void SetChecksum (int index, quint32 checksum);
+
+    /**
+     * @brief SetHoldCount sets how many frames of the movie a frame is shown for. Counts below one
+     * are stored as one.
+     */
+    void SetHoldCount (int index, quint32 holdCount);
+
+    /**
+     * @brief IsModified returns true if the table has changed since it was opened or saved.
+     */
+    bool IsModified () const;
+
+    /**
+     * @brief Save writes the table to disk. Throws a PLSException if it could not be saved.
+     */
+    void Save (const QString &filename);
+
+    /**
+     * @brief Crc32 returns the CRC-32 (as used by zip and PNG) of some data, for Frame::checksum.
+     */
+    static quint32 Crc32 (const QByteArray &data);
+
+private:
+    const uchar *RecordData (int index) const;
+    void Detach ();
+    void WriteRecord (uchar *record, const Frame &frame, quint32 filenameOffset, quint32 filenameLength) const;
+
+    static constexpr quint32 MAGIC = 0x504c5346; // "PLSF"
+    static constexpr quint32 VERSION = 1;
+    static constexpr int HEADER_SIZE = 32;
+    static constexpr int RECORD_SIZE = 32;
+
+    enum Flags : quint32 {
+        ROTATED = 0x1
+    };
+
+    // Either the mapped file...
+    QFile _file;
+    const uchar *_map;
+    const uchar *_mappedRecords;
+    const char *_mappedStrings;
+    int _mappedRecordSize;
+    qint64 _mappedStringsSize;
+
+    // ...or, once the table has been changed, a copy in memory
+    bool _detached;
+    QByteArray _records;
+    QByteArray _strings;
+
+    int _numberOfFrames;
+    bool _modified;
+};
+
+#endif // FRAMETABLE_H
@@ -0,0 +1,98 @@
+#include "imagewriter.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrent>
+
+#include "settings.h"
+
+ImageWriter::Options ImageWriter::Options::FromSettings ()
+{
+    Settings settings;
+    Options options;
+    options.quality = settings.Get("settings/jpegQuality").toInt();
+    options.optimizedWrite = settings.Get("settings/jpegOptimizedWrite").toBool();
+    return options;
+}
+
+QJsonObject ImageWriter::Statistics::ToJson () const
+{
+    double seconds = double(nanoseconds) / 1.0e9;
+    QJsonObject json;
+    json["images"] = double(images);
+    json["bytes"] = double(bytes);
+    json["threadMillis"] = seconds * 1000.0;
+    json["imagesPerThreadSecond"] = seconds > 0 ? double(images) / seconds : 0.0;
+    return json;
+}
+
+ImageWriter &ImageWriter::Instance ()
+{
+    static ImageWriter writer;
+    return writer;
+}
+
+ImageWriter::ImageWriter () :
+    _images (0),
+    _bytes (0),
+    _nanoseconds (0)
+{
+    _pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+ImageWriter::~ImageWriter ()
+{
+    _pool.waitForDone();
+}
+
+QFuture<bool> ImageWriter::Write (const QImage &image, const QString &filename, const Options &options)
+{
+    return QtConcurrent::run(&_pool, [this, image, filename, options]() {
+        return WriteNow(image, filename, options);
+    });
+}
+
+bool ImageWriter::WriteNow (const QImage &image, const QString &filename, const Options &options)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QByteArray data;
+    QBuffer buffer (&data);
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer (&buffer, "jpg");
+    writer.setQuality(options.quality);
+    writer.setOptimizedWrite(options.optimizedWrite);
+    if (!writer.write(image)) {
+        qDebug() << "Could not encode" << filename << ":" << writer.errorString();
+        return false;
+    }
+
+    QSaveFile file (filename);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qDebug() << "Could not save" << filename << ":" << file.errorString();
+        return false;
+    }
+
+    _images++;
+    _bytes += data.size();
+    _nanoseconds += timer.nsecsElapsed();
+    return true;
+}
+
+QThreadPool *ImageWriter::GetThreadPool ()
+{
+    return &_pool;
+}
+
+ImageWriter::Statistics ImageWriter::GetStatistics () const
+{
+    Statistics statistics;
+    statistics.images = _images;
+    statistics.bytes = _bytes;
+    statistics.nanoseconds = _nanoseconds;
+    return statistics;
+}
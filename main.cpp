@@ -1,39 +1,115 @@
 #include "stopmotionanimation.h"
+#include "batchexporter.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
 #include <QCoreApplication>
+#include <QEventLoop>
 #include <QSplashScreen>
-#include <QTime>
+#include <QTimer>
 #include <QString>
 #include <QSettings>
 
-const double SPLASH_SECONDS = 2;
+#include "startuptimer.h"
+
+// The splash screen stays up until the camera is live, but never longer than this
+const double MAX_SPLASH_SECONDS = 15;
+
+const char *BATCH_EXPORT_OPTION = "batch-export";
+const char *STARTUP_TRACE_OPTION = "startup-trace"; // Read by StartupTimer::Start
 
 void ConfigureSettings ();
 
+int RunBatchExport (const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Exports saved projects to movie files without opening any windows.");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption(BATCH_EXPORT_OPTION,
+                                        "Export the listed projects, or every saved project if none are listed."));
+    QCommandLineOption jobsOption ({"j", "jobs"}, "Number of projects to export at the same time.", "N", "2");
+    parser.addOption(jobsOption);
+    // Already handled, but the parser would reject it as unknown
+    parser.addOption(QCommandLineOption(STARTUP_TRACE_OPTION, "Write the startup timings to a trace file.", "file"));
+    parser.addPositionalArgument("projects", "Project names or .json files to export.", "[projects...]");
+    parser.process(arguments);
+
+    bool ok = false;
+    int jobs = parser.value(jobsOption).toInt(&ok);
+    if (!ok || jobs < 1) {
+        qWarning() << "Invalid number of jobs:" << parser.value(jobsOption);
+        return 1;
+    }
+
+    BatchExporter exporter (jobs);
+    if (parser.positionalArguments().isEmpty()) {
+        exporter.AddAllProjects();
+    } else {
+        for (auto &&project: parser.positionalArguments()) {
+            exporter.AddProject(project);
+        }
+    }
+    if (exporter.GetNumberOfProjects() == 0) {
+        qWarning() << "No projects to export";
+        return 1;
+    }
+    return exporter.Run() == 0 ? 0 : 1;
+}
+
 int main(int argc, char *argv[])
 {
+    StartupTimer::Start(argc, argv);
+    bool batchExport = false;
+    for (int arg = 1; arg < argc; ++arg) {
+        if (QString(argv[arg]) == QString("--") + BATCH_EXPORT_OPTION) {
+            batchExport = true;
+        }
+    }
+    if (batchExport) {
+        // The title and credits are drawn with a QGraphicsScene, which still needs a QApplication,
+        // but no window is ever shown: the offscreen platform lets this run without a display.
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    StartupTimer::Begin("QApplication creation");
     QApplication a(argc, argv);
+    StartupTimer::End("QApplication creation");
 
     QCoreApplication::setOrganizationName("Pioneer Library System");
     QCoreApplication::setOrganizationDomain("pioneerlibrarysystem.org");
     QCoreApplication::setApplicationName("PLS Stop Motion Creator");
 
+    if (batchExport) {
+        return RunBatchExport(a.arguments());
+    }
+
     // Show the splashscreen:
+    StartupTimer::Begin("Splash screen");
     QPixmap pixmap(":/images/splashscreen.png");
     QSplashScreen splash(pixmap);
     splash.show();
     a.processEvents();
-    QTime now;
-    now.start();
+    StartupTimer::Mark("Splash screen shown");
+
     StopMotionAnimation w;
-    while (now.elapsed() < SPLASH_SECONDS*1000 &&
-           splash.isVisible()) {
-        // This is here to handle mouse clicks, which will dismiss the window
-        a.processEvents();
+    if (!w.hasFinishedStartup()) {
+        StartupTimer::Begin("Waiting for the camera");
+        QEventLoop waitForCamera;
+        QObject::connect (&w, &StopMotionAnimation::startupFinished, &waitForCamera, &QEventLoop::quit);
+        QTimer::singleShot(int(MAX_SPLASH_SECONDS*1000), &waitForCamera, &QEventLoop::quit);
+        waitForCamera.exec();
+        StartupTimer::End("Waiting for the camera");
     }
 
     w.show();
     splash.finish(&w);
+    StartupTimer::End("Splash screen");
+    StartupTimer::Mark("Main window shown");
+    StartupTimer::Save();
+
+    int result = a.exec();
 
-    return a.exec();
+    // Again, for anything that finished after the window was shown (e.g. a slow camera)
+    StartupTimer::Save();
+    return result;
 }
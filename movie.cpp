@@ -1,33 +1,48 @@
 #include "movie.h"
 
+#include <QCoreApplication>
 #include <QDir>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QCryptographicHash>
 #include <QImageWriter>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonDocument>
+#include <QSaveFile>
+#include <QSet>
 #include <QImageEncoderControl>
 #include <QGraphicsScene>
 #include <QGraphicsTextItem>
 #include <QPainter>
+#include <QThread>
 #include <QtConcurrent/QtConcurrent>
 #include <iomanip>
 #include <thread>
 #include <fstream>
 #include <sstream>
 #include <functional>
+#include <exception>
 
 #include "avcodecwrapper.h"
+#include "imagewriter.h"
 #include "plsexception.h"
+#include "projectcatalog.h"
 #include "settings.h"
 #include "utils.h"
 
 Movie::Movie(const QString &name, bool allowModifications) :
     _name (name),
     _numberOfFrames (0),
+    _nextFrameId (0),
+    _frameTableInStep (true),
+    _encodingFileModified (0),
+    _catalogNumberOfFrames (-1),
     _allowModifications (allowModifications),
     _currentlyPlaying (false),
     _currentFrame (-1),
     _skippedFrameCounter(0),
+    _holdRemaining (0),
     _computerSpeedAdjust (0),
     _mute (false)
 {
@@ -44,6 +59,20 @@ Movie::Movie(const QString &name, bool allowModifications) :
     //_encoderSettings.setCodec(format);
     _encoderSettings.setCodec("JPG"); // This at least lets us prepare for a future feature that DOES support other formats
 
+    // The camera only offers a few quality levels, so use the nearest one to the JPEG quality setting
+    int jpegQuality = settings.Get("settings/jpegQuality").toInt();
+    if (jpegQuality >= 90) {
+        _encoderSettings.setQuality(QMultimedia::VeryHighQuality);
+    } else if (jpegQuality >= 75) {
+        _encoderSettings.setQuality(QMultimedia::HighQuality);
+    } else if (jpegQuality >= 50) {
+        _encoderSettings.setQuality(QMultimedia::NormalQuality);
+    } else if (jpegQuality >= 25) {
+        _encoderSettings.setQuality(QMultimedia::LowQuality);
+    } else {
+        _encoderSettings.setQuality(QMultimedia::VeryLowQuality);
+    }
+
     qint32 framesPerSecond = settings.Get("settings/framesPerSecond").toInt();
     _framesPerSecond = framesPerSecond;
 
@@ -52,6 +81,37 @@ Movie::Movie(const QString &name, bool allowModifications) :
 
 Movie::~Movie ()
 {
+    // Captures still waiting for a frame are reported as failed, which removes their records
+    // before the files are tidied up. Nobody is listening for the movie's own signals by now.
+    blockSignals(true);
+    _streamCapture.reset();
+
+    // Checksums that came in since the last save
+    if (_numberOfFrames > 0 && _allowModifications && _frameTable.IsModified()) {
+        try {
+            save();
+        } catch (const FailedToSaveException &e) {
+            qDebug() << "Could not save the frame table:" << e.filename();
+        }
+    }
+
+    // Tidied up when the movie is closed rather than opened, so loading a project never has to
+    // list its directory. If the table and the project file were out of step (an older version
+    // added frames, say), files the table doesn't know about may still be wanted: leave them.
+    if (_numberOfFrames > 0 && _allowModifications && _frameTableInStep) {
+        removeOrphanedFrameFiles();
+    }
+
+    // Bring the catalog entry up to date as the movie is closed, so the next listing needn't
+    // re-read it
+    if (_numberOfFrames > 0 && _allowModifications && _numberOfFrames != _catalogNumberOfFrames) {
+        try {
+            updateCatalog();
+        } catch (...) {
+            qDebug() << "Could not update the project catalog for" << _name;
+        }
+    }
+
     // If we have no frames, delete anything we have saved, including the
     // directory we would have used to store those things.
     if (_numberOfFrames == 0 && _allowModifications) {
@@ -112,18 +172,39 @@ QString Movie::getEncodingCredits() const
 
 void Movie::setCamera (QCamera *camera)
 {
-    if (camera != _camera) {
-        _camera = camera;
-        _imageCapture = std::unique_ptr<QCameraImageCapture> (new QCameraImageCapture(camera));
-        _imageCapture->setEncodingSettings (_encoderSettings);
-        if (_imageCapture->error() != QCameraImageCapture::NoError) {
-            throw CaptureFailedException ("Image capture failed: " + _imageCapture->errorString());
-        }
-        connect (_imageCapture.get(), &QCameraImageCapture::readyForCaptureChanged,
-                 this, &Movie::readyForCaptureChanged);
-        connect (_imageCapture.get(), &QCameraImageCapture::imageSaved,
-                 this, &Movie::imageSaved);
+    // The camera outlives the movie (it's kept running from one movie to the next), so only the
+    // capture objects belong to the movie. They are rebuilt to pick up this movie's settings.
+    // Destroying the stream capture reports any frames it never got as failed, removing them.
+    _imageCapture.reset();
+    _streamCapture.reset();
+    _camera = camera;
+    if (!camera) {
+        return;
+    }
+
+    _imageCapture = std::unique_ptr<QCameraImageCapture> (new QCameraImageCapture(camera));
+    _imageCapture->setEncodingSettings (_encoderSettings);
+    if (_imageCapture->error() != QCameraImageCapture::NoError) {
+        throw CaptureFailedException ("Image capture failed: " + _imageCapture->errorString());
+    }
+    connect (_imageCapture.get(), &QCameraImageCapture::readyForCaptureChanged,
+             this, &Movie::readyForCaptureChanged);
+    connect (_imageCapture.get(), &QCameraImageCapture::imageSaved,
+             this, &Movie::imageSaved);
+
+    _streamCapture = std::unique_ptr<StreamCapture> (new StreamCapture);
+    _streamCapture->SetOptions(ImageWriter::Options::FromSettings());
+    _streamCapture->SetResolution(_encoderSettings.resolution());
+    if (!_streamCapture->SetCamera(camera)) {
+        qDebug() << "This camera's viewfinder can't be captured from, only still images will be taken";
+        _streamCapture.reset();
+        return;
     }
+    // Emitted on the capture's thread, so these are queued
+    connect (_streamCapture.get(), &StreamCapture::frameSaved,
+             this, &Movie::streamFrameSaved);
+    connect (_streamCapture.get(), &StreamCapture::saveFailed,
+             this, &Movie::streamFrameSaveFailed);
 }
 
 void Movie::readyForCaptureChanged(bool)
@@ -132,22 +213,91 @@ void Movie::readyForCaptureChanged(bool)
 
 void Movie::imageSaved (int, const QString &fileName)
 {
-    if (_fileForRotation.length() > 0 &&
-        _fileForRotation == fileName) {
-        // Fire off a process to rotate the image in the background.
-        QtConcurrent::run(&rotateImageFile,_fileForRotation);
+    bool rotate = _fileForRotation.length() > 0 && _fileForRotation == fileName;
+    if (rotate) {
         _fileForRotation = "";
     }
+    // The record was added when the frame was captured, before there was a file
+    finishFrameFile(fileName, rotate);
 }
 
+void Movie::streamFrameSaved (const QString &filename)
+{
+    // The record was added when the frame was requested, before there was a file to checksum
+    finishFrameFile(filename, false);
+    emit frameFileSaved(filename);
+}
+
+void Movie::finishFrameFile (const QString &filename, bool rotate)
+{
+    // Rotating and checksumming both read the whole file, so they happen on the image writer's
+    // threads rather than this one
+    auto watcher = new QFutureWatcher<quint32> (this);
+    connect (watcher, &QFutureWatcher<quint32>::finished, this, [this, watcher, filename]() {
+        setFrameChecksum(filename, watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(ImageWriter::Instance().GetThreadPool(), [filename, rotate]() {
+        if (rotate) {
+            rotateImageFile(filename);
+        }
+        QFile file (filename);
+        return file.open(QIODevice::ReadOnly) ? FrameTable::Crc32(file.readAll()) : quint32(0);
+    }));
+}
 
-void Movie::addFrame (bool rotate180)
+void Movie::setFrameChecksum (const QString &filename, quint32 checksum)
+{
+    if (!_allowModifications || checksum == 0) {
+        return;
+    }
+    // Every frame that shows the file, since it may have been duplicated already
+    QString name = QFileInfo(filename).fileName();
+    // Not saved here: the table goes out with the next save (the next capture, usually), or when
+    // the movie is closed
+    for (int frame = 0; frame < _numberOfFrames; ++frame) {
+        if (_frameTable.GetFilename(frame) == name) {
+            _frameTable.SetChecksum(frame, checksum);
+        }
+    }
+}
+
+void Movie::streamFrameSaveFailed (const QString &filename)
+{
+    // Otherwise the record would point at a missing file forever, and an export would stop there
+    QString name = QFileInfo(filename).fileName();
+    try {
+        for (int frame = _numberOfFrames - 1; frame >= 0; --frame) {
+            if (_frameTable.GetFilename(frame) == name) {
+                deleteFrame(frame);
+            }
+        }
+    } catch (const QException &) {
+        qDebug() << "Could not remove the record of" << name;
+    }
+    emit captureFailed("Image capture failed: could not save " + name);
+}
+
+void Movie::addFrame (bool rotate180, CaptureSource source, int position)
 {
     if (!_allowModifications) {
         throw NoChangesNowException ("Cannot add frame to movie when it is locked");
     }
-    QString filename = getImageFilename (_numberOfFrames);
-    if (_imageCapture->isReadyForCapture()) {
+    if (!_imageCapture) {
+        throw CaptureFailedException ("Image capture failed: there is no camera");
+    }
+    quint32 id = allocateFrameId();
+    QString filename = getFrameFilename (id);
+    bool fromViewfinder = _streamCapture &&
+            (source == CaptureSource::VIEWFINDER || !_imageCapture->isReadyForCapture());
+    if (fromViewfinder) {
+        // The stream capture rotates the frame itself before saving it
+        if (!_streamCapture->Capture (filename, rotate180)) {
+            throw CaptureFailedException ("Image capture failed: too many frames are waiting to be saved");
+        }
+        insertFrameRecord (position, id, rotate180);
+        save();
+    } else if (_imageCapture->isReadyForCapture()) {
         _imageCapture->capture (filename);
         if (rotate180) {
             _fileForRotation = filename;
@@ -157,7 +307,7 @@ void Movie::addFrame (bool rotate180)
         if (_imageCapture->error() != QCameraImageCapture::NoError) {
             throw CaptureFailedException ("Image capture failed: " + _imageCapture->errorString());
         }
-        _numberOfFrames++;
+        insertFrameRecord (position, id, rotate180);
         save();
     } else {
         // Not ready for capture?
@@ -165,36 +315,231 @@ void Movie::addFrame (bool rotate180)
     }
 }
 
-void Movie::importFrame (const QString &filename)
+void Movie::importFrame (const QString &filename, int position)
 {
     if (!_allowModifications) {
         throw NoChangesNowException ("Cannot add frame to movie when it is locked");
     }
-    QString newFilename = getImageFilename (_numberOfFrames);
+    quint32 id = allocateFrameId();
+    QString newFilename = getFrameFilename (id);
     bool success = QFile::copy (filename, newFilename);
     if (success) {
-        _numberOfFrames++;
+        // Unlike a capture, the file is already complete, so its checksum is known now
+        quint32 checksum = 0;
+        QFile newFile (newFilename);
+        if (newFile.open(QIODevice::ReadOnly)) {
+            checksum = FrameTable::Crc32(newFile.readAll());
+        }
+        insertFrameRecord (position, id, false, checksum);
         save();
     } else {
         throw Movie::ImportFailedException ();
     }
 }
 
-qint32 Movie::getNumberOfFrames () const
+void Movie::duplicateFrame (int position)
 {
-    return _numberOfFrames;
+    if (!_allowModifications) {
+        throw NoChangesNowException ("Cannot add frame to movie when it is locked");
+    }
+    if (position < 0 || position >= _numberOfFrames) {
+        return;
+    }
+    // The copy is a new frame that shares the original's image file
+    FrameTable::Frame frame = _frameTable.GetFrame(position);
+    frame.id = _nextFrameId++;
+    _frameTable.InsertFrame(position + 1, frame);
+    _numberOfFrames++;
+    remapSoundEffects([position](int start) {
+        return start > position ? start + 1 : start;
+    });
+    save();
 }
 
-void Movie::deleteLastFrame ()
+void Movie::moveFrame (int from, int to)
+{
+    if (!_allowModifications) {
+        throw NoChangesNowException ("Cannot move frames when the movie is locked");
+    }
+    if (from < 0 || from >= _numberOfFrames || to < 0 || to >= _numberOfFrames || from == to) {
+        return;
+    }
+    _frameTable.MoveFrame(from, to);
+    remapSoundEffects([from, to](int start) {
+        if (start == from) {
+            return to;
+        } else if (from < to && start > from && start <= to) {
+            return start - 1;
+        } else if (to < from && start >= to && start < from) {
+            return start + 1;
+        }
+        return start;
+    });
+    save();
+}
+
+void Movie::deleteFrame (int position)
 {
     if (!_allowModifications) {
         throw NoChangesNowException ("Cannot remove frame from movie when it is locked");
     }
+    if (position < 0 || position >= _numberOfFrames) {
+        return;
+    }
+    QString filename = _frameTable.GetFilename(position);
+    _frameTable.RemoveFrame(position);
+    _numberOfFrames--;
+    if (!_frameTable.IsFilenameUsed(filename)) {
+        QFile::remove (getProjectDirectory().filePath(filename));
+    }
+    // A sound on the deleted frame goes with it
+    remapSoundEffects([position](int start) {
+        return start == position ? -1 : (start > position ? start - 1 : start);
+    });
+    save();
+}
+
+void Movie::setFrameHold (int position, int holdCount)
+{
+    if (!_allowModifications) {
+        throw NoChangesNowException ("Cannot hold frames when the movie is locked");
+    }
+    if (position < 0 || position >= _numberOfFrames || holdCount < 1) {
+        return;
+    }
+    _frameTable.SetHoldCount(position, quint32(holdCount));
+    save();
+}
+
+int Movie::getFrameHold (int position) const
+{
+    if (position < 0 || position >= _numberOfFrames) {
+        return 1;
+    }
+    return int(_frameTable.GetHoldCount(position));
+}
+
+qint32 Movie::getNumberOfFrames () const
+{
+    return _numberOfFrames;
+}
+
+int Movie::getMovieFrame (int position) const
+{
+    int movieFrame = 0;
+    for (int frame = 0; frame < position && frame < _numberOfFrames; ++frame) {
+        movieFrame += getFrameHold(frame);
+    }
+    return movieFrame;
+}
+
+const FrameTable &Movie::getFrameTable () const
+{
+    return _frameTable;
+}
+
+void Movie::insertFrameRecord (int position, quint32 id, bool rotated, quint32 checksum)
+{
+    if (position < 0 || position > _numberOfFrames) {
+        position = _numberOfFrames;
+    }
+    FrameTable::Frame frame;
+    frame.id = id;
+    frame.filename = QFileInfo(getFrameFilename(id)).fileName();
+    frame.captureTime = QDateTime::currentDateTime();
+    frame.rotated = rotated;
+    frame.checksum = checksum;
+    _frameTable.InsertFrame(position, frame);
+    _numberOfFrames++;
+    _nextFrameId = qMax(_nextFrameId, id + 1);
+    remapSoundEffects([position](int start) {
+        return start >= position ? start + 1 : start;
+    });
+}
+
+void Movie::remapSoundEffects (const std::function<int(int)> &newPosition)
+{
+    QMap<int,SoundEffect> soundEffects;
+    for (auto &&sfx: _soundEffects) {
+        int start = newPosition(sfx.getStartFrame());
+        if (start >= 0) {
+            SoundEffect moved (sfx);
+            moved.setStartFrame(start);
+            soundEffects.insert(start, moved);
+        }
+    }
+    _soundEffects = soundEffects;
+    if (_allowModifications) {
+        for (auto &&sfx: _soundEffects) {
+            sfx.enablePlayback();
+        }
+    }
+}
+
+quint32 Movie::allocateFrameId ()
+{
+    while (QFile::exists(getFrameFilename(_nextFrameId))) {
+        _nextFrameId++;
+    }
+    return _nextFrameId;
+}
+
+void Movie::removeOrphanedFrameFiles () const
+{
+    // Frame files are only ever named after a frame id, so any that no frame refers to any more
+    // (left behind by a delete that happened while it was still being written, say) can go. Ids
+    // from nextFrameId on were never handed out by this table, so those files aren't ours to judge.
+    QSet<QString> used;
+    for (int frame = 0; frame < _frameTable.GetNumberOfFrames(); ++frame) {
+        used.insert(_frameTable.GetFilename(frame));
+    }
+    QDir directory (getProjectDirectory());
+    QString prefix = _name + "_";
+    QString suffix = "." + _encoderSettings.codec().toLower();
+    QString pattern = prefix + "[0-9][0-9][0-9][0-9][0-9]*" + suffix;
+    for (auto &&filename: directory.entryList(QStringList() << pattern, QDir::Files)) {
+        bool isId = false;
+        quint32 id = filename.mid(prefix.size(), filename.size() - prefix.size() - suffix.size()).toUInt(&isId);
+        if (isId && id < _nextFrameId && !used.contains(filename)) {
+            qDebug() << "Removing unused frame file" << filename;
+            directory.remove(filename);
+        }
+    }
+}
+
+bool Movie::loadFrameTable ()
+{
+    if (_frameTable.Open(getFrameTableFilename())) {
+        // The table is saved before the project file, so if the two disagree the table is right
+        if (_frameTable.GetNumberOfFrames() != _numberOfFrames) {
+            qDebug() << "The project file lists" << _numberOfFrames << "frames, but its frame table has"
+                     << _frameTable.GetNumberOfFrames() << ": using the table";
+            _numberOfFrames = _frameTable.GetNumberOfFrames();
+        }
+        return true;
+    }
+
+    // A project saved before there was a frame table: rebuild it from the frames' file names.
+    // Nothing else about them is known.
+    _frameTable.Clear();
+    for (int frame = 0; frame < _numberOfFrames; ++frame) {
+        FrameTable::Frame record;
+        record.id = quint32(frame);
+        record.filename = QFileInfo(getFrameFilename(quint32(frame))).fileName();
+        _frameTable.AppendFrame(record);
+    }
+    return false;
+}
+
+QJsonObject Movie::getLastEncodingReport () const
+{
+    return _lastEncodingReport;
+}
+
+void Movie::deleteLastFrame ()
+{
     if (_numberOfFrames > 0) {
-        QString filename = getImageFilename (_numberOfFrames-1) + "." + _encoderSettings.codec().toLower();
-        QFile::remove (filename);
-        _numberOfFrames--;
-        save();
+        deleteFrame (_numberOfFrames-1);
     }
 }
 
@@ -212,9 +557,11 @@ void Movie::playSoundEffect(const SoundEffect &sfx, QLabel *video)
     }
     auto startFrame = memberSFX->getStartFrame();
     auto duration = sfx.getOutPoint()-sfx.getInPoint();
-    if (duration*_framesPerSecond + startFrame > _numberOfFrames) {
+    int movieStart = getMovieFrame(startFrame);
+    int movieLength = getMovieFrame(_numberOfFrames);
+    if (duration*_framesPerSecond + movieStart > movieLength) {
         // Correct for durations that extend past the end of the current movie.
-        duration = double(_numberOfFrames-startFrame-1)/_framesPerSecond;
+        duration = double(movieLength-movieStart-1)/_framesPerSecond;
         qDebug() << "Playing SFX for " << duration << " seconds";
     }
     play (startFrame, video);
@@ -245,11 +592,12 @@ void Movie::play (qint32 startFrame, QLabel *video)
     _skippedFrameCounter = 0;
     _playStartTime.start();
     setStillFrame (startFrame, video);
+    _holdRemaining = getFrameHold (startFrame);
     if (_backgroundMusic && !_mute) {
         Settings settings;
         double tOffset = settings.Get("settings/preTitleScreenDuration").toDouble() +
                          settings.Get("settings/titleScreenDuration").toDouble();
-        double startTime = tOffset + double(startFrame) / double(_framesPerSecond);
+        double startTime = tOffset + double(getMovieFrame(startFrame)) / double(_framesPerSecond);
         _backgroundMusic.playFrom(startTime);
     }
     int interval = (1000 / _framesPerSecond) - _computerSpeedAdjust;
@@ -276,24 +624,27 @@ void Movie::nextFrame ()
             frameAdjust = 1;
         }
 
-        qint32 targetFrame = _currentFrame + 1 + frameAdjust;
-        if (targetFrame >= _numberOfFrames) {
-            stop();
-            play(0, _frameDestination);
-            return;
-        } else {
+        // Each tick is one frame of the movie, so a held frame stays up for several of them
+        _holdRemaining -= 1 + frameAdjust;
+        qint32 previousFrame = _currentFrame;
+        qint32 targetFrame = _currentFrame;
+        while (_holdRemaining <= 0) {
+            targetFrame++;
+            if (targetFrame >= _numberOfFrames) {
+                stop();
+                play(0, _frameDestination);
+                return;
+            }
+            _holdRemaining += getFrameHold (targetFrame);
+        }
+        if (targetFrame != previousFrame) {
             setStillFrame (targetFrame, _frameDestination);
-            if (frameAdjust > 0) {
-                for (int adjustment = frameAdjust; adjustment >= 1; adjustment--) {
-                    if (!_mute && _soundEffects.contains(targetFrame-adjustment)) {
-                        _soundEffects[targetFrame-adjustment].play();
-                    }
+            // Including the sounds of any frame that was skipped over
+            for (qint32 frame = previousFrame + 1; frame <= targetFrame; frame++) {
+                if (!_mute && _soundEffects.contains(frame)) {
+                    _soundEffects[frame].play();
                 }
             }
-            if (!_mute && _soundEffects.contains(targetFrame)) {
-                _soundEffects[targetFrame].play();
-            }
-
         }
     }
 }
@@ -324,6 +675,11 @@ void Movie::stop ()
 
 }
 
+int Movie::getSkippedFrameCount () const
+{
+    return _skippedFrameCounter;
+}
+
 void Movie::addBackgroundMusic (const SoundEffect &backgroundMusic)
 {
     if (!_allowModifications) {
@@ -406,6 +762,7 @@ void Movie::save () const
         QJsonObject json;
         json["name"] = _name;
         json["numberOfFrames"] = _numberOfFrames;
+        json["nextFrameId"] = double(_nextFrameId);
         json["framesPerSecond"] = _framesPerSecond;
 
         QJsonArray sfxArray;
@@ -425,18 +782,44 @@ void Movie::save () const
         json["encodingFilename"] = _encodingFilename;
         json["encodingTitle"] = _encodingTitle;
         json["encodingCredits"] = _encodingCredits;
+        json["encodingVideoSignature"] = _encodingVideoSignature;
+        json["encodingFileModified"] = QString::number(_encodingFileModified);
+
+        // The frame table first: it's what load() trusts if the two ever get out of step
+        if (_frameTable.IsModified()) {
+            try {
+                _frameTable.Save(getFrameTableFilename());
+            } catch (const PLSException &) {
+                throw Movie::FailedToSaveException(getFrameTableFilename());
+            }
+        }
 
         QJsonDocument jsonDocument (json);
-        QFile saveFile (filename);
-        bool isOpen = saveFile.open(QIODevice::WriteOnly);
-        if (!isOpen) {
+        QSaveFile saveFile (filename);
+        if (!saveFile.open(QIODevice::WriteOnly) ||
+            saveFile.write(jsonDocument.toJson()) < 0 ||
+            !saveFile.commit()) {
             throw Movie::FailedToSaveException(filename);
         }
-        saveFile.write(jsonDocument.toJson());
-        saveFile.close();
+
+        // The catalog is only told when the project is created or renamed or its thumbnail changes.
+        // Other saves (every capture among them) just leave its entry stale, and a stale entry is
+        // re-read from this file the next time the catalog is listed.
+        if (_name != _catalogName || getImageFilename(0) != _catalogThumbnail) {
+            updateCatalog();
+        }
     }
 }
 
+void Movie::updateCatalog () const
+{
+    ProjectCatalog catalog;
+    _catalogName = _name;
+    _catalogNumberOfFrames = _numberOfFrames;
+    _catalogThumbnail = getImageFilename(0);
+    catalog.Update(_name, _numberOfFrames, getSaveFilename(), _catalogThumbnail);
+}
+
 bool Movie::load (const QString &filename)
 {
     QFile loadFile (filename);
@@ -465,6 +848,15 @@ bool Movie::load (const QString &filename)
     } else {
         return false;
     }
+    int savedNumberOfFrames = _numberOfFrames;
+    bool tableLoaded = loadFrameTable();
+    _frameTableInStep = tableLoaded && savedNumberOfFrames == _numberOfFrames;
+    if (_frameTableInStep && json.contains("nextFrameId")) {
+        _nextFrameId = quint32(json["nextFrameId"].toDouble());
+    } else {
+        // Saved before ids were kept, or the table has moved on since: only then look through it
+        _nextFrameId = quint32(qMax(qint64(json["nextFrameId"].toDouble()), _frameTable.GetMaximumId() + 1));
+    }
 
     // Sound effects are optional:
     if (json.contains("sfx")) {
@@ -476,14 +868,16 @@ bool Movie::load (const QString &filename)
             sfx.load (sfxObject);
             if (sfx) {
                 _soundEffects.insert(sfx.getStartFrame(), sfx);
-                _soundEffects[sfx.getStartFrame()].enablePlayback();
+                if (_allowModifications) {
+                    _soundEffects[sfx.getStartFrame()].enablePlayback();
+                }
             }
         }
     }
     if (json.contains("backgroundMusic")) {
         QJsonObject backgroundObject (json["backgroundMusic"].toObject());
         _backgroundMusic.load (backgroundObject);
-        if (_backgroundMusic) {
+        if (_backgroundMusic && _allowModifications) {
             _backgroundMusic.enablePlayback();
         }
     }
@@ -491,17 +885,57 @@ bool Movie::load (const QString &filename)
     _encodingFilename = json["encodingFilename"].toString();
     _encodingTitle = json["encodingTitle"].toString();
     _encodingCredits = json["encodingCredits"].toString();
+    _encodingVideoSignature = json["encodingVideoSignature"].toString();
+    _encodingFileModified = json["encodingFileModified"].toString().toLongLong();
+
+    // Whatever the catalog has for this project is either current or stale enough to be re-read
+    _catalogName = _name;
+    _catalogNumberOfFrames = _numberOfFrames;
+    _catalogThumbnail = getImageFilename(0);
     return true;
 }
 
+/* QGraphicsScene, which draws the title and credits, may only be used on the GUI thread, but batch
+ * exports encode on worker threads: they hand the drawing over to the GUI thread and wait for it. */
+static void RunOnGuiThread (const std::function<void()> &work)
+{
+    QCoreApplication *app = QCoreApplication::instance();
+    if (!app || QThread::currentThread() == app->thread()) {
+        work();
+        return;
+    }
+    std::exception_ptr error;
+    QMetaObject::invokeMethod(app, [&work, &error]() {
+        try {
+            work();
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }, Qt::BlockingQueuedConnection);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
 void Movie::encodeToFile (const QString &filename, const QString &title, const QString &credits)
 {
     Settings settings;
     avcodecWrapper encoder;
 
+    // If nothing that affects the picture has changed since the last export, and that export is
+    // still where we left it, only the sound needs to be redone: its video can be copied as-is.
+    QString videoSignature = getVideoSignature(title, credits);
+    QFileInfo previousEncoding (_encodingFilename);
+    bool videoUnchanged = !_encodingVideoSignature.isEmpty() &&
+                          _encodingVideoSignature == videoSignature &&
+                          previousEncoding.exists() &&
+                          previousEncoding.lastModified().toMSecsSinceEpoch() == _encodingFileModified;
+    QString previousFilename = _encodingFilename;
+
     _encodingFilename = filename;
     _encodingTitle = title;
     _encodingCredits = credits;
+    _encodingVideoSignature.clear(); // Until this export succeeds
 
     save();
 
@@ -511,13 +945,21 @@ void Movie::encodeToFile (const QString &filename, const QString &title, const Q
     }
     _encodingTempFiles.clear();
 
-    // Video frames first:
-    CreatePreTitle(encoder);
-    CreateTitle(encoder, title);
-    for (int frame = 0; frame < _numberOfFrames; frame++) {
-        encoder.AddVideoFrame(getImageFilename(frame));
+    // Video frames first. The captured frames are their own segment, cached next to the
+    // project, so changing only the title, credits or sound doesn't re-encode them:
+    if (videoUnchanged) {
+        encoder.SetVideoSource(previousFilename);
+    } else {
+        EncodeStatistics::ScopedTimer timer (&encoder.GetStatistics(), EncodeStatistics::TITLES);
+        CreatePreTitle(encoder);
+        RunOnGuiThread([&]() { CreateTitle(encoder, title); });
+        encoder.StartVideoSegment(getVideoCacheFilename());
+        for (int frame = 0; frame < _numberOfFrames; frame++) {
+            encoder.AddVideoFrame(getImageFilename(frame), getFrameHold(frame));
+        }
+        encoder.StartVideoSegment();
+        RunOnGuiThread([&]() { CreateCredits(encoder, credits); });
     }
-    CreateCredits(encoder, credits);
 
     // Audio second:
     if (_backgroundMusic) {
@@ -532,7 +974,10 @@ void Movie::encodeToFile (const QString &filename, const QString &title, const Q
             qDebug() << "Empty SFX found!";
             continue;
         }
-        encoder.AddAudioFile(sfx, ptsDuration+tsDuration);
+        // The sound's start time is counted in frames without their holds
+        int startFrame = sfx.getStartFrame();
+        double holdOffset = double(getMovieFrame(startFrame) - startFrame) / double(_framesPerSecond);
+        encoder.AddAudioFile(sfx, ptsDuration+tsDuration+holdOffset);
     }
     int w = settings.Get("settings/imageWidth").toInt();
     int h = settings.Get("settings/imageHeight").toInt();
@@ -548,6 +993,51 @@ void Movie::encodeToFile (const QString &filename, const QString &title, const Q
     } catch (...) {
         throw EncodingFailedException ("The encoding failed with an unrecognized error");
     }
+
+    _encodingVideoSignature = videoSignature;
+    _encodingFileModified = QFileInfo(filename).lastModified().toMSecsSinceEpoch();
+    save();
+
+    // Keep a record of where the time went, next to the project
+    const EncodeStatistics &statistics = encoder.GetStatistics();
+    _lastEncodingReport = statistics.ToJson();
+    qDebug() << "Encoded" << filename << "in" << statistics.GetTotalTime() / 1000000 << "ms";
+    statistics.SaveReport(getBaseFilename() + "_encodingReport.json");
+}
+
+QString Movie::getVideoSignature (const QString &title, const QString &credits) const
+{
+    Settings settings;
+    QCryptographicHash hash (QCryptographicHash::Sha1);
+    QStringList videoSettings;
+    videoSettings << title << credits
+                  << QString::number(_numberOfFrames)
+                  << QString::number(_framesPerSecond)
+                  << settings.Get("settings/imageWidth").toString()
+                  << settings.Get("settings/imageHeight").toString()
+                  << settings.Get("settings/preTitleScreenLocation").toString()
+                  << settings.Get("settings/preTitleScreenDuration").toString()
+                  << settings.Get("settings/titleScreenDuration").toString()
+                  << settings.Get("settings/creditsDuration").toString()
+                  << settings.Get("settings/jpegQuality").toString()
+                  << settings.Get("settings/jpegOptimizedWrite").toString();
+    hash.addData(videoSettings.join('\n').toUtf8());
+
+    QStringList files;
+    files << settings.Get("settings/preTitleScreenLocation").toString();
+    QStringList holds;
+    for (int frame = 0; frame < _numberOfFrames; frame++) {
+        files << getImageFilename(frame);
+        holds << QString::number(getFrameHold(frame));
+    }
+    hash.addData(holds.join(',').toUtf8());
+    for (auto &&file: files) {
+        QFileInfo info (file);
+        hash.addData(file.toUtf8());
+        hash.addData(QByteArray::number(info.size()));
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    }
+    return QString::fromLatin1(hash.result().toHex());
 }
 
 
@@ -561,11 +1051,11 @@ void Movie::CreatePreTitle(avcodecWrapper &encoder) const
         if (!preTitleScreenCheck.exists()) {
             throw EncodingFailedException ("Pre-Title screen could not be opened: " + filename);
         }
+        // Held for the whole duration, so it's only decoded once. TODO: Someday consider checking
+        // it for validity first.
         int numberOfFrames = int(std::round(_framesPerSecond * duration));
-        for (int frame = 0; frame < numberOfFrames; frame++) {
-            // Just blindly add the file over and over again. TODO: Someday consider checking it for
-            // validity first.
-            encoder.AddVideoFrame(filename);
+        if (numberOfFrames > 0) {
+            encoder.AddVideoFrame(filename, numberOfFrames);
         }
     }
 }
@@ -600,11 +1090,14 @@ void Movie::CreateTitle(avcodecWrapper &encoder, const QString &title) const
         painter.end();
 
         QString titleScreenFilename = getBaseFilename() + "_titleScreen.jpg";
-        img.save(titleScreenFilename);
         _encodingTempFiles.append(titleScreenFilename);
+        if (!ImageWriter::Instance().WriteNow(img, titleScreenFilename, ImageWriter::Options::FromSettings())) {
+            throw EncodingFailedException ("Could not save the title screen: " + titleScreenFilename);
+        }
+        encoder.GetStatistics().Count(EncodeStatistics::TITLE_FRAMES_WRITTEN);
         int numberOfFrames = int(std::round(_framesPerSecond * duration));
-        for (int frame = 0; frame < numberOfFrames; frame++) {
-            encoder.AddVideoFrame(titleScreenFilename);
+        if (numberOfFrames > 0) {
+            encoder.AddVideoFrame(titleScreenFilename, numberOfFrames);
         }
     }
 }
@@ -646,6 +1139,14 @@ void Movie::CreateCredits(avcodecWrapper &encoder, const QString &credits) const
             distancePerFrame = qreal(textSize.height() - h) / qreal(numberOfFrames-(2*numberOfStillFrames));
         }
 
+        // Each frame is rendered here, but encoded and saved on the image writer's pool. Rendering
+        // is much quicker than encoding, so only let it get a little ahead: every frame waiting
+        // to be encoded is a full-size image in memory.
+        ImageWriter::Options options = ImageWriter::Options::FromSettings();
+        const int maxFramesInFlight = 2 * ImageWriter::Instance().GetThreadPool()->maxThreadCount();
+        QList<QFuture<bool>> writes;
+        QStringList writeFilenames;
+
         qreal verticalPosition = 0;
         for (int frame = 0; frame < numberOfFrames; frame++) {
             if (frame > numberOfStillFrames && frame < numberOfFrames-numberOfStillFrames) {
@@ -662,9 +1163,21 @@ void Movie::CreateCredits(avcodecWrapper &encoder, const QString &credits) const
 
             QString titleScreenFilename = getBaseFilename() + "_credits_" + QString::number(frame) + ".jpg";
             _encodingTempFiles.append (titleScreenFilename);
-            img.save(titleScreenFilename);
+            if (frame >= maxFramesInFlight) {
+                writes[frame - maxFramesInFlight].waitForFinished();
+            }
+            writes.append(ImageWriter::Instance().Write(img, titleScreenFilename, options));
+            writeFilenames.append(titleScreenFilename);
             encoder.AddVideoFrame(titleScreenFilename);
         }
+
+        // The encoder only reads the files once it starts, so they just have to be there by then
+        for (int frame = 0; frame < writes.size(); frame++) {
+            if (!writes[frame].result()) {
+                throw EncodingFailedException ("Could not save the credits: " + writeFilenames[frame]);
+            }
+        }
+        encoder.GetStatistics().Count(EncodeStatistics::TITLE_FRAMES_WRITTEN, writes.size());
     }
 }
 
@@ -691,9 +1204,32 @@ QString Movie::getSaveFilename () const
     return base + ".json";
 }
 
+QString Movie::getFrameTableFilename () const
+{
+    return getBaseFilename() + "_frames.table";
+}
+
+QString Movie::getVideoCacheFilename () const
+{
+    return getBaseFilename() + "_frames.videocache";
+}
+
 QString Movie::getImageFilename (qint32 frame) const
+{
+    if (frame < 0 || frame >= _frameTable.GetNumberOfFrames()) {
+        return QString();
+    }
+    return getProjectDirectory().filePath(_frameTable.GetFilename(frame));
+}
+
+QString Movie::getFrameFilename (quint32 id) const
 {
     std::stringstream ss;
-    ss << getBaseFilename().toStdString() << "_" << std::setfill('0') << std::setw(5) << frame << "." << _encoderSettings.codec().toLower().toStdString();
+    ss << getBaseFilename().toStdString() << "_" << std::setfill('0') << std::setw(5) << id << "." << _encoderSettings.codec().toLower().toStdString();
     return QString::fromStdString(ss.str());
 }
+
+QDir Movie::getProjectDirectory () const
+{
+    return QFileInfo(getBaseFilename()).absoluteDir();
+}
@@ -2,8 +2,12 @@
 #define MOVIE_H
 
 #include <QObject>
+#include <QDir>
+#include <QPointer>
+#include <QJsonObject>
 #include <QException>
 #include <memory>
+#include <functional>
 
 #include <string>
 #include <soundeffect.h>
@@ -15,6 +19,8 @@
 #include <QProcess>
 
 #include "avcodecwrapper.h"
+#include "frametable.h"
+#include "streamcapture.h"
 
 
 class Movie : public QObject
@@ -38,14 +44,76 @@ public:
 
     QString getSaveFilename () const;
 
+    /**
+     * @brief getImageFilename returns the image file shown at a position in the movie, or an empty
+     * string if there is no such frame.
+     */
+    QString getImageFilename (int frame) const;
+
+    /**
+     * @brief setCamera binds this movie's captures to a camera that is already running, replacing
+     * any earlier binding. The camera is not owned by the movie; pass nullptr before deleting it.
+     */
     void setCamera (QCamera *camera);
 
-    void addFrame (bool rotate180 = false);
+    /**
+     * @brief Where addFrame() takes its picture from: the camera's still image capture, or the
+     * next frame of the viewfinder stream. A still image is taken from the viewfinder anyway if
+     * the camera isn't ready for another one yet, so a capture is never lost.
+     */
+    enum class CaptureSource {STILL_IMAGE, VIEWFINDER};
+
+    /**
+     * @brief addFrame captures a frame and inserts it at "position", or after the last frame if
+     * position is -1.
+     */
+    void addFrame (bool rotate180 = false, CaptureSource source = CaptureSource::STILL_IMAGE, int position = -1);
 
-    void importFrame (const QString &filename);
+    void importFrame (const QString &filename, int position = -1);
+
+    /*
+     * Frames are kept in the frame table as a list of ids, each naming an image file that never
+     * changes once it's written. So inserting, deleting, duplicating and moving frames only
+     * rearranges the table: no file is renamed. The sound effects move along with their frames.
+     */
+
+    /**
+     * @brief duplicateFrame inserts a copy of a frame right after it. The copy shares the image
+     * file, so it takes no more space on disk.
+     */
+    void duplicateFrame (int position);
+
+    void moveFrame (int from, int to);
+
+    /**
+     * @brief deleteFrame removes a frame, and its image file if no other frame shares it. A sound
+     * effect that starts on the frame is removed too.
+     */
+    void deleteFrame (int position);
+
+    /**
+     * @brief setFrameHold makes a frame stay on screen for holdCount frames of the movie, which is
+     * how a pose is held without capturing the same shot again. Playback and the exported movie
+     * both repeat the one image file.
+     */
+    void setFrameHold (int position, int holdCount);
+
+    int getFrameHold (int position) const;
 
     int getNumberOfFrames () const;
 
+    /**
+     * @brief getMovieFrame returns the frame of the movie, counting holds, on which a frame first
+     * appears. getMovieFrame(getNumberOfFrames()) is the length of the movie in frames.
+     */
+    int getMovieFrame (int position) const;
+
+    /**
+     * @brief getFrameTable returns the per-frame metadata: capture time, rotation, hold count and
+     * checksum.
+     */
+    const FrameTable &getFrameTable () const;
+
     void deleteLastFrame ();
 
     QString getMostRecentFrame () const;
@@ -58,6 +126,12 @@ public:
 
     void stop ();
 
+    /**
+     * @brief getSkippedFrameCount returns the number of frames dropped to keep up since playback
+     * last (re)started.
+     */
+    int getSkippedFrameCount () const;
+
     void addBackgroundMusic (const SoundEffect &backgroundMusic);
 
     SoundEffect getBackgroundMusic () const;
@@ -86,10 +160,27 @@ public:
 
     void encodeToFile (const QString &filename, const QString &title, const QString &credits);
 
+    /**
+     * @brief getLastEncodingReport returns the timing report (see EncodeStatistics::ToJson) of the
+     * most recent successful encodeToFile() call, or an empty object if there hasn't been one.
+     */
+    QJsonObject getLastEncodingReport () const;
+
 signals:
 
     void frameChanged (int newFrame);
 
+    /**
+     * @brief frameFileSaved is emitted once a frame captured from the viewfinder has been written
+     * to disk: until then its record points at a file that doesn't exist yet.
+     */
+    void frameFileSaved (const QString &filename);
+
+    /**
+     * @brief captureFailed is emitted if a captured frame couldn't be saved after all. Its record
+     * has already been removed from the movie.
+     */
+    void captureFailed (const QString &message);
 
 protected slots:
 
@@ -99,11 +190,67 @@ protected slots:
 
     void imageSaved (int id, const QString &fileName);
 
+    void streamFrameSaved (const QString &filename);
+
+    void streamFrameSaveFailed (const QString &filename);
+
 protected:
 
     QString getBaseFilename () const;
 
-    QString getImageFilename (int frame) const;
+    QString getFrameTableFilename () const;
+
+    QString getFrameFilename (quint32 id) const;
+
+    QDir getProjectDirectory () const;
+
+    QString getVideoCacheFilename () const;
+
+    void insertFrameRecord (int position, quint32 id, bool rotated, quint32 checksum = 0);
+
+    /**
+     * @brief finishFrameFile rotates (if asked to) and checksums a captured file that has just been
+     * written, in the background, then records the checksum with setFrameChecksum().
+     */
+    void finishFrameFile (const QString &filename, bool rotate);
+
+    /**
+     * @brief setFrameChecksum fills in the checksum of every frame showing a captured file, once
+     * it has been written. The table is saved with the movie's next save.
+     */
+    void setFrameChecksum (const QString &filename, quint32 checksum);
+
+    /**
+     * @brief remapSoundEffects moves every sound effect to newPosition(its start frame), or drops
+     * it if that returns -1.
+     */
+    void remapSoundEffects (const std::function<int(int)> &newPosition);
+
+    /**
+     * @brief allocateFrameId returns the next unused frame id, skipping any whose file already
+     * exists (e.g. written by an older version that didn't keep track of ids).
+     */
+    quint32 allocateFrameId ();
+
+    /**
+     * @brief removeOrphanedFrameFiles deletes frame files whose ids were handed out but that no
+     * frame refers to any more. Only safe with a table that was loaded, never a rebuilt one.
+     */
+    void removeOrphanedFrameFiles () const;
+
+    /**
+     * @brief loadFrameTable returns false if there was no table to load, and it had to be rebuilt
+     * from the naming convention.
+     */
+    bool loadFrameTable ();
+
+    /**
+     * @brief updateCatalog records this project's current name, length and thumbnail in the
+     * project catalog.
+     */
+    void updateCatalog () const;
+
+    QString getVideoSignature (const QString &title, const QString &credits) const;
 
     void CreatePreTitle(avcodecWrapper &encoder) const;
     void CreateTitle(avcodecWrapper &encoder, const QString &title) const;
@@ -113,17 +260,27 @@ private:
 
     QString _name;
     qint32 _numberOfFrames;
+    mutable FrameTable _frameTable; // Written out by save()
+    quint32 _nextFrameId;           // Ids are never reused, so neither are frame file names
+    bool _frameTableInStep;         // False if load() found the table and project file disagreeing
     qint32 _framesPerSecond;
     QMap<int,SoundEffect> _soundEffects;
     SoundEffect _backgroundMusic;
     QString _encodingFilename;
     QString _encodingTitle;
     QString _encodingCredits;
+    QString _encodingVideoSignature;
+    qint64 _encodingFileModified;
+    QJsonObject _lastEncodingReport;
+    mutable QString _catalogName;           // What the project catalog was last told, so save()
+    mutable qint32 _catalogNumberOfFrames;  // only rewrites it when the entry really changes
+    mutable QString _catalogThumbnail;
     bool _allowModifications;
 
-    QCamera *_camera;
+    QPointer<QCamera> _camera; // Cleared if the camera is unplugged and deleted
     QImageEncoderSettings _encoderSettings;
     std::unique_ptr<QCameraImageCapture> _imageCapture;
+    std::unique_ptr<StreamCapture> _streamCapture; // Null if the camera's viewfinder can't be probed
     mutable QStringList _encodingTempFiles;
     QString _fileForRotation;
 
@@ -134,6 +291,7 @@ private:
     QLabel *_frameDestination;
     qint32 _playFrameCounter;
     qint32 _skippedFrameCounter;
+    qint32 _holdRemaining;      // Timer ticks left before the current frame has been held long enough
     qint32 _computerSpeedAdjust;
     QTime _playStartTime;
     bool _mute;
@@ -1,6 +1,7 @@
 #include "multiregionwaveform.h"
 
 #include "utils.h"
+#include <cmath>
 #include <iostream>
 #include <QMouseEvent>
 #include "settings.h"
@@ -23,15 +24,13 @@ void MultiRegionWaveform::AddRegion (QString name, qint64 startMillis, qint64 en
     auto &&r = _regions.back();
     r.startMillis = startMillis;
     r.endMillis = endMillis;
-    if (_totalLength > 0) {
-        r.pixelWidth = int(_scene.width() * (double(endMillis-startMillis)/_totalLength));
-        r.pixelStart = int(_scene.width() * (double(startMillis)/_totalLength));
-    }
+    r.pixelStart = millisToPixels(startMillis);
+    r.pixelWidth = millisToPixels(endMillis - startMillis);
     r.penColor = color;
     r.brushColor = QColor (color.red(), color.green(), color.blue(), int(0.3 * color.alpha()));
     r.pen = QPen (r.penColor);
     r.brush = QBrush (r.brushColor);
-    r.rect = _scene.addRect(r.pixelStart,0,r.pixelWidth,this->height(),r.pen, r.brush);
+    r.rect = _scene.addRect(r.pixelStart,0,r.pixelWidth,_scene.height(),r.pen, r.brush);
     r.text = _scene.addText(name);
     r.text->setDefaultTextColor (r.penColor);
     r.text->setX(r.pixelStart);
@@ -73,7 +72,7 @@ void MultiRegionWaveform::DoneAddingRegions ()
         selectionMillis = std::max (selectionMillis, region.endMillis);
     }
     this->setSelectionLength(selectionMillis);
-    _group->setX(_selectionStart);
+    _group->setX(millisToPixels(_selectionStart));
     _locked = true;
 }
 
@@ -97,12 +96,26 @@ void MultiRegionWaveform::reset()
     Waveform::reset();
 }
 
+void MultiRegionWaveform::layoutItems ()
+{
+    Waveform::layoutItems();
+    for (auto &&r: _regions) {
+        r.pixelStart = millisToPixels(r.startMillis);
+        r.pixelWidth = millisToPixels(r.endMillis - r.startMillis);
+        r.rect->setRect(r.pixelStart, 0, r.pixelWidth, _scene.height());
+        r.text->setX(r.pixelStart);
+    }
+    if (_group) {
+        _group->setX(millisToPixels(_selectionStart));
+    }
+}
+
 void MultiRegionWaveform::mousePressEvent(QMouseEvent *event)
 {
     _dragStartTime.restart();
-    _dragStartX = event->pos().x();
-    if (event->x() >= _selectionStart &&
-        event->x() <= _selectionStart + _selectionLength) {
+    _dragStartX = sceneX(event);
+    if (_dragStartX >= millisToPixels(_selectionStart) &&
+        _dragStartX <= millisToPixels(_selectionStart + _selectionLength)) {
         // The mouse was pressed within the selection region
         _currentlyDraggingSelection = true;
         _cursorLine->hide();
@@ -115,17 +128,16 @@ void MultiRegionWaveform::mousePressEvent(QMouseEvent *event)
 
 void MultiRegionWaveform::mouseReleaseEvent(QMouseEvent *event)
 {
-    if (abs(_dragStartX - event->x()) <= 1) {
+    double x = sceneX(event);
+    if (std::abs(_dragStartX - x) <= 1) {
         // Maybe this was really a click... how long was the button down?
         if (_dragStartTime.elapsed() < 500) {
             // Let our parent handle it if it wants to
             Waveform::mouseReleaseEvent(event);
         }
     } else if (_currentlyDraggingSelection) {
-        int actualX = event->pos().x();
-        int dragDistance = actualX - _dragStartX;
-        _selectionStart += dragDistance;
-        _group->setX(_selectionStart);
+        _selectionStart += pixelsToMillis(x - _dragStartX);
+        _group->setX(millisToPixels(_selectionStart));
         QGraphicsView::mouseReleaseEvent (event);
     } else {
         Waveform::mouseReleaseEvent(event);
@@ -136,12 +148,11 @@ void MultiRegionWaveform::mouseReleaseEvent(QMouseEvent *event)
 
 void MultiRegionWaveform::mouseMoveEvent(QMouseEvent *event)
 {
-    _cursorLine->setX (event->x());
+    double x = sceneX(event);
+    _cursorLine->setX (x);
     QGraphicsView::mouseMoveEvent (event);
     if (_currentlyDraggingSelection) {
-        int actualX = event->pos().x();
-        int dragDistance = actualX - _dragStartX;
-        _group->setX(_selectionStart + dragDistance);
+        _group->setX(millisToPixels(_selectionStart) + x - _dragStartX);
     } else {
         _cursorLine->show();
     }
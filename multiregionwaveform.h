@@ -21,11 +21,15 @@ public:
     virtual void mouseReleaseEvent(QMouseEvent *event);
     virtual void mouseMoveEvent(QMouseEvent *event);
 
+protected:
+    virtual void layoutItems ();
+
+public:
     struct Region {
         qint64 startMillis;
         qint64 endMillis;
-        int pixelStart;
-        int pixelWidth;
+        double pixelStart;
+        double pixelWidth;
         QColor penColor;
         QColor brushColor;
         QPen pen;
@@ -42,7 +46,7 @@ private:
     // We are going to manually manage dragging for now:
     const int SNAP_DISTANCE = 10; // pixels
     bool _currentlyDraggingSelection;
-    int _dragStartX;
+    double _dragStartX;
     QTime _dragStartTime;
     bool _locked;
 };
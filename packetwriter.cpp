@@ -0,0 +1,112 @@
+#include "packetwriter.h"
+#include "avexception.h"
+
+#include <QMutexLocker>
+
+PacketWriter::PacketWriter(AVFormatContext *formatContext, EncodeStatistics *statistics, int maxQueuedPackets) :
+    QThread (nullptr),
+    _formatContext (formatContext),
+    _statistics (statistics),
+    _maxQueuedPackets (maxQueuedPackets),
+    _finishing (false),
+    _aborted (false),
+    _error (0)
+{
+}
+
+PacketWriter::~PacketWriter()
+{
+    Abort();
+}
+
+void PacketWriter::Enqueue (AVPacket *packet)
+{
+    QMutexLocker lock (&_mutex);
+    while (_queue.size() >= _maxQueuedPackets && _error == 0 && !_finishing && !_aborted) {
+        _spaceAvailable.wait(&_mutex);
+    }
+    if (_error < 0 || _finishing || _aborted) {
+        av_packet_free(&packet);
+        lock.unlock();
+        CheckAndThrow();
+        return;
+    }
+    _queue.enqueue(packet);
+    _packetAvailable.wakeOne();
+}
+
+void PacketWriter::Finish ()
+{
+    {
+        QMutexLocker lock (&_mutex);
+        _finishing = true;
+        _packetAvailable.wakeAll();
+    }
+    wait();
+    CheckAndThrow();
+}
+
+void PacketWriter::Abort ()
+{
+    {
+        QMutexLocker lock (&_mutex);
+        _aborted = true;
+        _packetAvailable.wakeAll();
+        _spaceAvailable.wakeAll();
+    }
+    wait();
+
+    // If we are being stopped early (e.g. the encoder threw) there may still be packets waiting:
+    // they will never be written, so just free them.
+    for (auto packet: _queue) {
+        av_packet_free(&packet);
+    }
+    _queue.clear();
+}
+
+void PacketWriter::run()
+{
+    while (true) {
+        AVPacket *packet = nullptr;
+        {
+            QMutexLocker lock (&_mutex);
+            while (_queue.isEmpty() && !_finishing && !_aborted) {
+                _packetAvailable.wait(&_mutex);
+            }
+            if (_aborted || _queue.isEmpty()) {
+                // Abandoned, or finishing and nothing left to write
+                return;
+            }
+            packet = _queue.dequeue();
+            _spaceAvailable.wakeOne();
+        }
+
+        // The actual disk I/O happens outside the lock, so the encoders can keep queueing
+        int size = packet->size;
+        int ret;
+        {
+            EncodeStatistics::ScopedTimer timer (_statistics, EncodeStatistics::MUX);
+            ret = av_interleaved_write_frame(_formatContext, packet);
+        }
+        av_packet_free(&packet);
+        if (_statistics) {
+            _statistics->Count(EncodeStatistics::PACKETS_WRITTEN);
+            _statistics->Count(EncodeStatistics::BYTES_WRITTEN, size);
+        }
+
+        if (ret < 0) {
+            QMutexLocker lock (&_mutex);
+            _error = ret;
+            _spaceAvailable.wakeAll();
+            return;
+        }
+    }
+}
+
+void PacketWriter::CheckAndThrow ()
+{
+    QMutexLocker lock (&_mutex);
+    if (_error < 0) {
+        throw AVException ("av_interleaved_write_frame", _error);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef PACKETWRITER_H
+#define PACKETWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+
+#include "encodestatistics.h"
+
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+/**
+ * @brief The PacketWriter class owns all muxing for a single output file. Encoded packets are
+ * handed to it with Enqueue() and written to disk with av_interleaved_write_frame() on its own
+ * thread, so the encoders never wait on disk I/O. The stream header must already be written
+ * before the thread is started, and the trailer may only be written after Finish() returns.
+ */
+class PacketWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    PacketWriter(AVFormatContext *formatContext, EncodeStatistics *statistics = nullptr, int maxQueuedPackets = 64);
+
+    /**
+     * Unless Finish() has already been called, packets still in the queue are discarded rather
+     * than written: the output is being abandoned, and the format context may be about to go.
+     */
+    ~PacketWriter() override;
+
+    /**
+     * @brief Enqueue hands a packet (already rescaled to its stream's timebase) to the writer.
+     * The writer takes ownership of the packet and frees it once it has been written. Blocks
+     * only if the queue is full.
+     */
+    void Enqueue (AVPacket *packet);
+
+    /**
+     * @brief Finish writes everything still in the queue and stops the thread. Throws an
+     * AVException if any of the writes failed.
+     */
+    void Finish ();
+
+    /**
+     * @brief Abort stops the thread as soon as the packet being written (if any) is done, and
+     * discards everything still queued. Packets enqueued afterwards are freed straight away.
+     */
+    void Abort ();
+
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    void CheckAndThrow ();
+
+    AVFormatContext *_formatContext;
+    EncodeStatistics *_statistics;
+    int _maxQueuedPackets;
+
+    QMutex _mutex;
+    QWaitCondition _packetAvailable;
+    QWaitCondition _spaceAvailable;
+    QQueue<AVPacket *> _queue;
+    bool _finishing;
+    bool _aborted;
+    int _error;
+};
+
+#endif // PACKETWRITER_H
@@ -0,0 +1,303 @@
+#include "peakkernel.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PEAK_KERNEL_SSE2
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// The AVX2 functions are compiled for AVX2 on their own, so the rest of the program (and the
+// choice between them) still runs on any x86-64 CPU. MSVC needs no flag to emit AVX2 intrinsics.
+#ifdef PEAK_KERNEL_SSE2
+#if defined(__GNUC__) || defined(__clang__)
+#define PEAK_KERNEL_AVX2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER)
+#define PEAK_KERNEL_AVX2
+#define TARGET_AVX2
+#endif
+#endif
+
+namespace PeakKernel
+{
+
+template <typename T>
+static void MinMaxScalar (const T *samples, int count, T &minimum, T &maximum)
+{
+    T mn = samples[0];
+    T mx = samples[0];
+    for (int i = 1; i < count; ++i) {
+        mn = std::min(mn, samples[i]);
+        mx = std::max(mx, samples[i]);
+    }
+    minimum = mn;
+    maximum = mx;
+}
+
+#ifdef PEAK_KERNEL_SSE2
+
+static inline qint16 HorizontalMin (__m128i v)
+{
+    v = _mm_min_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_min_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_min_epi16(v, _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return qint16(_mm_cvtsi128_si32(v));
+}
+
+static inline qint16 HorizontalMax (__m128i v)
+{
+    v = _mm_max_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_max_epi16(v, _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return qint16(_mm_cvtsi128_si32(v));
+}
+
+static inline float HorizontalMin (__m128 v)
+{
+    v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_min_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+static inline float HorizontalMax (__m128 v)
+{
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+static void MinMaxSSE2 (const qint16 *samples, int count, qint16 &minimum, qint16 &maximum)
+{
+    if (count < 8) {
+        MinMaxScalar(samples, count, minimum, maximum);
+        return;
+    }
+    __m128i mn = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples));
+    __m128i mx = mn;
+    int i = 8;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        mn = _mm_min_epi16(mn, v);
+        mx = _mm_max_epi16(mx, v);
+    }
+    minimum = HorizontalMin(mn);
+    maximum = HorizontalMax(mx);
+    for (; i < count; ++i) {
+        minimum = std::min(minimum, samples[i]);
+        maximum = std::max(maximum, samples[i]);
+    }
+}
+
+static void MinMaxSSE2 (const float *samples, int count, float &minimum, float &maximum)
+{
+    if (count < 4) {
+        MinMaxScalar(samples, count, minimum, maximum);
+        return;
+    }
+    __m128 mn = _mm_loadu_ps(samples);
+    __m128 mx = mn;
+    int i = 4;
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_loadu_ps(samples + i);
+        mn = _mm_min_ps(mn, v);
+        mx = _mm_max_ps(mx, v);
+    }
+    minimum = HorizontalMin(mn);
+    maximum = HorizontalMax(mx);
+    for (; i < count; ++i) {
+        minimum = std::min(minimum, samples[i]);
+        maximum = std::max(maximum, samples[i]);
+    }
+}
+
+#endif // PEAK_KERNEL_SSE2
+
+#ifdef PEAK_KERNEL_AVX2
+
+TARGET_AVX2 static void MinMaxAVX2 (const qint16 *samples, int count, qint16 &minimum, qint16 &maximum)
+{
+    if (count < 16) {
+        MinMaxScalar(samples, count, minimum, maximum);
+        return;
+    }
+    __m256i mn = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples));
+    __m256i mx = mn;
+    int i = 16;
+    for (; i + 16 <= count; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+        mn = _mm256_min_epi16(mn, v);
+        mx = _mm256_max_epi16(mx, v);
+    }
+    minimum = HorizontalMin(_mm_min_epi16(_mm256_castsi256_si128(mn), _mm256_extracti128_si256(mn, 1)));
+    maximum = HorizontalMax(_mm_max_epi16(_mm256_castsi256_si128(mx), _mm256_extracti128_si256(mx, 1)));
+    for (; i < count; ++i) {
+        minimum = std::min(minimum, samples[i]);
+        maximum = std::max(maximum, samples[i]);
+    }
+}
+
+TARGET_AVX2 static void MinMaxAVX2 (const float *samples, int count, float &minimum, float &maximum)
+{
+    if (count < 8) {
+        MinMaxScalar(samples, count, minimum, maximum);
+        return;
+    }
+    __m256 mn = _mm256_loadu_ps(samples);
+    __m256 mx = mn;
+    int i = 8;
+    for (; i + 8 <= count; i += 8) {
+        __m256 v = _mm256_loadu_ps(samples + i);
+        mn = _mm256_min_ps(mn, v);
+        mx = _mm256_max_ps(mx, v);
+    }
+    minimum = HorizontalMin(_mm_min_ps(_mm256_castps256_ps128(mn), _mm256_extractf128_ps(mn, 1)));
+    maximum = HorizontalMax(_mm_max_ps(_mm256_castps256_ps128(mx), _mm256_extractf128_ps(mx, 1)));
+    for (; i < count; ++i) {
+        minimum = std::min(minimum, samples[i]);
+        maximum = std::max(maximum, samples[i]);
+    }
+}
+
+static bool CpuHasAVX2 ()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // PEAK_KERNEL_AVX2
+
+bool IsAvailable (Implementation implementation)
+{
+    switch (implementation) {
+    case Implementation::SCALAR:
+        return true;
+    case Implementation::SSE2:
+#ifdef PEAK_KERNEL_SSE2
+        return true;
+#else
+        return false;
+#endif
+    case Implementation::AVX2:
+#ifdef PEAK_KERNEL_AVX2
+    {
+        static const bool hasAVX2 = CpuHasAVX2();
+        return hasAVX2;
+    }
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+Implementation Fastest ()
+{
+    static const Implementation fastest = IsAvailable(Implementation::AVX2) ? Implementation::AVX2 :
+                                          IsAvailable(Implementation::SSE2) ? Implementation::SSE2 :
+                                                                              Implementation::SCALAR;
+    return fastest;
+}
+
+QString GetName (Implementation implementation)
+{
+    switch (implementation) {
+    case Implementation::SCALAR: return "scalar";
+    case Implementation::SSE2: return "SSE2";
+    case Implementation::AVX2: return "AVX2";
+    }
+    return QString();
+}
+
+template <typename T>
+static void Dispatch (Implementation implementation, const T *samples, int count, T &minimum, T &maximum)
+{
+    switch (implementation) {
+#ifdef PEAK_KERNEL_AVX2
+    case Implementation::AVX2:
+        MinMaxAVX2(samples, count, minimum, maximum);
+        return;
+#endif
+#ifdef PEAK_KERNEL_SSE2
+    case Implementation::SSE2:
+        MinMaxSSE2(samples, count, minimum, maximum);
+        return;
+#endif
+    default:
+        MinMaxScalar(samples, count, minimum, maximum);
+    }
+}
+
+template <typename T>
+static int BucketsImpl (Implementation implementation, const T *interleaved, int frames, int channels,
+                        int framesPerBucket, T *minimum, T *maximum)
+{
+    int bucket = 0;
+    for (int frame = 0; frame < frames; frame += framesPerBucket, ++bucket) {
+        int count = std::min(framesPerBucket, frames - frame) * channels;
+        Dispatch(implementation, interleaved + qint64(frame) * channels, count, minimum[bucket], maximum[bucket]);
+    }
+    return bucket;
+}
+
+void MinMax (const qint16 *samples, int count, qint16 &minimum, qint16 &maximum)
+{
+    Dispatch(Fastest(), samples, count, minimum, maximum);
+}
+
+void MinMax (const float *samples, int count, float &minimum, float &maximum)
+{
+    Dispatch(Fastest(), samples, count, minimum, maximum);
+}
+
+void MinMax (Implementation implementation, const qint16 *samples, int count, qint16 &minimum, qint16 &maximum)
+{
+    Dispatch(implementation, samples, count, minimum, maximum);
+}
+
+void MinMax (Implementation implementation, const float *samples, int count, float &minimum, float &maximum)
+{
+    Dispatch(implementation, samples, count, minimum, maximum);
+}
+
+int Buckets (const qint16 *interleaved, int frames, int channels, int framesPerBucket,
+             qint16 *minimum, qint16 *maximum)
+{
+    return BucketsImpl(Fastest(), interleaved, frames, channels, framesPerBucket, minimum, maximum);
+}
+
+int Buckets (const float *interleaved, int frames, int channels, int framesPerBucket,
+             float *minimum, float *maximum)
+{
+    return BucketsImpl(Fastest(), interleaved, frames, channels, framesPerBucket, minimum, maximum);
+}
+
+int Buckets (Implementation implementation, const qint16 *interleaved, int frames, int channels,
+             int framesPerBucket, qint16 *minimum, qint16 *maximum)
+{
+    return BucketsImpl(implementation, interleaved, frames, channels, framesPerBucket, minimum, maximum);
+}
+
+int Buckets (Implementation implementation, const float *interleaved, int frames, int channels,
+             int framesPerBucket, float *minimum, float *maximum)
+{
+    return BucketsImpl(implementation, interleaved, frames, channels, framesPerBucket, minimum, maximum);
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef PEAKKERNEL_H
+#define PEAKKERNEL_H
+
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * @brief The minimum/maximum reductions behind the waveform's peak pyramid.
+ *
+ * Each function comes in a scalar, SSE2 and AVX2 version. The default overloads use the fastest
+ * one the CPU supports (checked once, at run time); the ones that take an Implementation are for
+ * benchmarking and comparing the versions. Interleaved audio needs no special handling: the
+ * waveform shows all channels merged, so a bucket of N frames is simply N * channels samples.
+ */
+namespace PeakKernel
+{
+    enum class Implementation {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    /**
+     * @brief Fastest returns the fastest implementation available on this CPU.
+     */
+    Implementation Fastest ();
+
+    /**
+     * @brief IsAvailable returns whether this build and CPU can run an implementation.
+     */
+    bool IsAvailable (Implementation implementation);
+
+    QString GetName (Implementation implementation);
+
+    /**
+     * @brief MinMax finds the smallest and largest of count (> 0) samples.
+     */
+    void MinMax (const qint16 *samples, int count, qint16 &minimum, qint16 &maximum);
+    void MinMax (const float *samples, int count, float &minimum, float &maximum);
+    void MinMax (Implementation implementation, const qint16 *samples, int count, qint16 &minimum, qint16 &maximum);
+    void MinMax (Implementation implementation, const float *samples, int count, float &minimum, float &maximum);
+
+    /**
+     * @brief Buckets finds the minimum and maximum of each run of framesPerBucket interleaved
+     * frames, writing one value per bucket to minimum and maximum. The last bucket is shorter
+     * if frames isn't a multiple of framesPerBucket.
+     * @return The number of buckets written
+     */
+    int Buckets (const qint16 *interleaved, int frames, int channels, int framesPerBucket,
+                 qint16 *minimum, qint16 *maximum);
+    int Buckets (const float *interleaved, int frames, int channels, int framesPerBucket,
+                 float *minimum, float *maximum);
+    int Buckets (Implementation implementation, const qint16 *interleaved, int frames, int channels,
+                 int framesPerBucket, qint16 *minimum, qint16 *maximum);
+    int Buckets (Implementation implementation, const float *interleaved, int frames, int channels,
+                 int framesPerBucket, float *minimum, float *maximum);
+}
+
+#endif // PEAKKERNEL_H
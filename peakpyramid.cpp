@@ -0,0 +1,279 @@
+#include "peakpyramid.h"
+#include "peakkernel.h"
+#include "plsexception.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <cmath>
+
+static const int SAMPLES_PER_BUCKET[PeakPyramid::NUMBER_OF_LEVELS] = {256, 1024, 4096};
+
+PeakPyramid::PeakPyramid (int sampleRate) :
+    _sampleRate (sampleRate),
+    _numberOfSamples (0)
+{
+    for (int level = 0; level < NUMBER_OF_LEVELS; ++level) {
+        _levels[level].samplesPerBucket = SAMPLES_PER_BUCKET[level];
+        _levels[level].pendingMinimum = 0;
+        _levels[level].pendingMaximum = 0;
+        _levels[level].pendingCount = 0;
+    }
+}
+
+int PeakPyramid::GetSampleRate () const
+{
+    return _sampleRate;
+}
+
+qint64 PeakPyramid::GetNumberOfSamples () const
+{
+    return _numberOfSamples;
+}
+
+qint64 PeakPyramid::GetDurationMillis () const
+{
+    if (_sampleRate <= 0) {
+        return 0;
+    }
+    return _numberOfSamples * 1000 / _sampleRate;
+}
+
+bool PeakPyramid::IsEmpty () const
+{
+    return _levels[0].minimum.isEmpty();
+}
+
+static inline qint16 ToPcm (qint16 sample)
+{
+    return sample;
+}
+
+static inline qint16 ToPcm (float sample)
+{
+    return qint16(std::max(-32768.0f, std::min(32767.0f, sample * 32768.0f)));
+}
+
+void PeakPyramid::AddSamples (const qint16 *interleaved, int frames, int channels)
+{
+    AddPlanes(&interleaved, 1, channels, frames);
+}
+
+void PeakPyramid::AddSamples (const float *interleaved, int frames, int channels)
+{
+    AddPlanes(&interleaved, 1, channels, frames);
+}
+
+void PeakPyramid::AddPlanarSamples (const qint16 *const *planes, int frames, int channels)
+{
+    AddPlanes(planes, channels, 1, frames);
+}
+
+void PeakPyramid::AddPlanarSamples (const float *const *planes, int frames, int channels)
+{
+    AddPlanes(planes, channels, 1, frames);
+}
+
+/**
+ * Interleaved audio is a single plane with a sample per channel in each frame, planar audio is a
+ * plane per channel with one sample per frame: either way each bucket is the extremes of all of
+ * the planes' buckets.
+ */
+template <typename T>
+void PeakPyramid::AddPlanes (const T *const *planes, int numberOfPlanes, int samplesPerFrame, int frames)
+{
+    Level &finest = _levels[0];
+    const int bucketSize = finest.samplesPerBucket;
+    int offset = 0;
+
+    // Top up a partly-filled bucket left over from the last call
+    if (finest.pendingCount > 0 && frames > 0) {
+        int chunk = std::min(bucketSize - finest.pendingCount, frames);
+        T minimum, maximum;
+        PeakKernel::MinMax(planes[0], chunk * samplesPerFrame, minimum, maximum);
+        for (int plane = 1; plane < numberOfPlanes; ++plane) {
+            T planeMinimum, planeMaximum;
+            PeakKernel::MinMax(planes[plane], chunk * samplesPerFrame, planeMinimum, planeMaximum);
+            minimum = std::min(minimum, planeMinimum);
+            maximum = std::max(maximum, planeMaximum);
+        }
+        AddBucket(0, ToPcm(minimum), ToPcm(maximum), chunk);
+        offset = chunk;
+    }
+
+    // Then whole buckets (and any remainder) in one pass of the kernel per plane
+    if (offset < frames) {
+        int remaining = frames - offset;
+        int numberOfBuckets = (remaining + bucketSize - 1) / bucketSize;
+        QVarLengthArray<T, 64> minimum (numberOfBuckets), maximum (numberOfBuckets);
+        QVarLengthArray<T, 64> planeMinimum (numberOfBuckets), planeMaximum (numberOfBuckets);
+        for (int plane = 0; plane < numberOfPlanes; ++plane) {
+            const T *first = planes[plane] + qint64(offset) * samplesPerFrame;
+            if (plane == 0) {
+                PeakKernel::Buckets(first, remaining, samplesPerFrame, bucketSize, minimum.data(), maximum.data());
+                continue;
+            }
+            PeakKernel::Buckets(first, remaining, samplesPerFrame, bucketSize, planeMinimum.data(), planeMaximum.data());
+            for (int bucket = 0; bucket < numberOfBuckets; ++bucket) {
+                minimum[bucket] = std::min(minimum[bucket], planeMinimum[bucket]);
+                maximum[bucket] = std::max(maximum[bucket], planeMaximum[bucket]);
+            }
+        }
+        for (int bucket = 0; bucket < numberOfBuckets; ++bucket) {
+            int count = std::min(bucketSize, remaining - bucket * bucketSize);
+            AddBucket(0, ToPcm(minimum[bucket]), ToPcm(maximum[bucket]), count);
+        }
+    }
+    _numberOfSamples += frames;
+}
+
+void PeakPyramid::Finish ()
+{
+    // Flushing a level hands its partial bucket up to the next one, which is flushed next
+    for (int level = 0; level < NUMBER_OF_LEVELS; ++level) {
+        FlushPending(level);
+    }
+}
+
+void PeakPyramid::AddBucket (int level, qint16 minimum, qint16 maximum, int count)
+{
+    Level &l = _levels[level];
+    if (l.pendingCount == 0) {
+        l.pendingMinimum = minimum;
+        l.pendingMaximum = maximum;
+    } else {
+        l.pendingMinimum = std::min(l.pendingMinimum, minimum);
+        l.pendingMaximum = std::max(l.pendingMaximum, maximum);
+    }
+    l.pendingCount += count;
+    if (l.pendingCount >= l.samplesPerBucket) {
+        FlushPending(level);
+    }
+}
+
+void PeakPyramid::FlushPending (int level)
+{
+    Level &l = _levels[level];
+    if (l.pendingCount == 0) {
+        return;
+    }
+    l.minimum.append(l.pendingMinimum);
+    l.maximum.append(l.pendingMaximum);
+    int count = l.pendingCount;
+    l.pendingCount = 0;
+    if (level + 1 < NUMBER_OF_LEVELS) {
+        AddBucket(level + 1, l.pendingMinimum, l.pendingMaximum, count);
+    }
+}
+
+void PeakPyramid::GetPeaks (double firstSample, double samplesPerPixel, int pixels,
+                            QVector<float> &minimum, QVector<float> &maximum) const
+{
+    minimum.fill(0.0f, pixels);
+    maximum.fill(0.0f, pixels);
+
+    // The coarsest level whose buckets are no wider than a pixel: each pixel then covers at
+    // most a handful of buckets (below the finest level, a bucket covers several pixels)
+    int level = 0;
+    for (int l = NUMBER_OF_LEVELS - 1; l >= 0; --l) {
+        if (_levels[l].samplesPerBucket <= samplesPerPixel) {
+            level = l;
+            break;
+        }
+    }
+    const Level &l = _levels[level];
+    const qint64 numberOfBuckets = l.minimum.size();
+    const double bucketsPerPixel = samplesPerPixel / l.samplesPerBucket;
+    const double firstBucket = firstSample / l.samplesPerBucket;
+
+    for (int pixel = 0; pixel < pixels; ++pixel) {
+        double start = firstBucket + pixel * bucketsPerPixel;
+        qint64 from = std::max(qint64(0), qint64(std::floor(start)));
+        qint64 to = std::min(numberOfBuckets, std::max(from + 1, qint64(std::ceil(start + bucketsPerPixel))));
+        if (from >= to) {
+            continue;
+        }
+        qint16 mn = l.minimum[int(from)];
+        qint16 mx = l.maximum[int(from)];
+        for (qint64 bucket = from + 1; bucket < to; ++bucket) {
+            mn = std::min(mn, l.minimum[int(bucket)]);
+            mx = std::max(mx, l.maximum[int(bucket)]);
+        }
+        minimum[pixel] = float(mn) / 32768.0f;
+        maximum[pixel] = float(mx) / 32768.0f;
+    }
+}
+
+bool PeakPyramid::Load (const QString &filename)
+{
+    QFile file (filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in (&file);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != MAGIC || version != VERSION) {
+        return false;
+    }
+    qint32 sampleRate;
+    qint64 numberOfSamples;
+    in >> sampleRate >> numberOfSamples;
+    Level levels[NUMBER_OF_LEVELS];
+    for (int level = 0; level < NUMBER_OF_LEVELS; ++level) {
+        qint32 samplesPerBucket;
+        in >> samplesPerBucket >> levels[level].minimum >> levels[level].maximum;
+        if (samplesPerBucket != SAMPLES_PER_BUCKET[level] ||
+            levels[level].minimum.size() != levels[level].maximum.size()) {
+            return false;
+        }
+    }
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    _sampleRate = sampleRate;
+    _numberOfSamples = numberOfSamples;
+    for (int level = 0; level < NUMBER_OF_LEVELS; ++level) {
+        _levels[level].minimum = levels[level].minimum;
+        _levels[level].maximum = levels[level].maximum;
+        _levels[level].pendingCount = 0;
+    }
+    return true;
+}
+
+void PeakPyramid::Save (const QString &filename) const
+{
+    QDir().mkpath(QFileInfo(filename).absolutePath());
+    QSaveFile file (filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        throw PLSException ("Could not open the waveform cache file " + filename);
+    }
+    QDataStream out (&file);
+    out << MAGIC << VERSION << qint32(_sampleRate) << _numberOfSamples;
+    for (int level = 0; level < NUMBER_OF_LEVELS; ++level) {
+        out << qint32(_levels[level].samplesPerBucket) << _levels[level].minimum << _levels[level].maximum;
+    }
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        throw PLSException ("Could not write the waveform cache file " + filename);
+    }
+}
+
+QString PeakPyramid::GetCacheFilename (const QString &audioFilename)
+{
+    QFileInfo info (audioFilename);
+    QCryptographicHash hash (QCryptographicHash::Sha1);
+    hash.addData(info.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    QString cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return QDir(cacheDirectory).filePath("waveforms/" + QString::fromLatin1(hash.result().toHex()) + ".peaks");
+}
@@ -0,0 +1,107 @@
+#ifndef PEAKPYRAMID_H
+#define PEAKPYRAMID_H
+
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+/**
+ * @brief The PeakPyramid class holds the minimum and maximum sample values of an audio file at
+ * several resolutions (256, 1024 and 4096 samples per bucket), with all channels merged. Any
+ * part of the file can be drawn at any width from whichever level is closest, in time
+ * proportional to the number of pixels rather than the number of samples.
+ *
+ * It is built incrementally with AddSamples() and Finish(), and can be saved to and loaded
+ * from a cache file so that each audio file only ever has to be decoded once.
+ */
+class PeakPyramid
+{
+public:
+    static const int NUMBER_OF_LEVELS = 3;
+
+    PeakPyramid (int sampleRate = 0);
+
+    int GetSampleRate () const;
+
+    /**
+     * @brief GetNumberOfSamples returns the number of samples per channel added so far.
+     */
+    qint64 GetNumberOfSamples () const;
+
+    qint64 GetDurationMillis () const;
+
+    bool IsEmpty () const;
+
+    /**
+     * @brief AddSamples adds interleaved signed 16-bit or float (-1...1) samples.
+     * @param frames The number of samples per channel
+     */
+    void AddSamples (const qint16 *interleaved, int frames, int channels);
+    void AddSamples (const float *interleaved, int frames, int channels);
+
+    /**
+     * @brief AddPlanarSamples adds samples with each channel in its own plane, the way most
+     * decoders produce them.
+     */
+    void AddPlanarSamples (const qint16 *const *planes, int frames, int channels);
+    void AddPlanarSamples (const float *const *planes, int frames, int channels);
+
+    /**
+     * @brief Finish adds any partly-filled buckets at the end of the file.
+     */
+    void Finish ();
+
+    /**
+     * @brief GetPeaks fills minimum and maximum (scaled to -1...1) for a run of pixel columns.
+     * @param firstSample The sample at the left edge of the first column
+     * @param samplesPerPixel The number of samples each column covers
+     */
+    void GetPeaks (double firstSample, double samplesPerPixel, int pixels,
+                   QVector<float> &minimum, QVector<float> &maximum) const;
+
+    /**
+     * @brief Load reads a previously saved pyramid, returning false if the file doesn't exist or
+     * isn't a pyramid this version can read.
+     */
+    bool Load (const QString &filename);
+
+    /**
+     * @brief Save writes the pyramid to a file, throwing a PLSException on failure.
+     */
+    void Save (const QString &filename) const;
+
+    /**
+     * @brief GetCacheFilename returns where the pyramid for an audio file is cached. The name
+     * depends on the file's path, size and modification time, so an edited file gets a new one.
+     */
+    static QString GetCacheFilename (const QString &audioFilename);
+
+private:
+    struct Level {
+        int samplesPerBucket;
+        QVector<qint16> minimum;
+        QVector<qint16> maximum;
+
+        // The bucket currently being filled
+        qint16 pendingMinimum;
+        qint16 pendingMaximum;
+        int pendingCount;
+    };
+
+    template <typename T>
+    void AddPlanes (const T *const *planes, int numberOfPlanes, int samplesPerFrame, int frames);
+    void AddBucket (int level, qint16 minimum, qint16 maximum, int count);
+    void FlushPending (int level);
+
+    static constexpr quint32 MAGIC = 0x504c5750; // "PLWP"
+    static constexpr quint32 VERSION = 1;
+
+    int _sampleRate;
+    qint64 _numberOfSamples;
+    Level _levels[NUMBER_OF_LEVELS];
+};
+
+typedef std::shared_ptr<const PeakPyramid> PeakPyramidPointer;
+
+#endif // PEAKPYRAMID_H
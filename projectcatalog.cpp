@@ -0,0 +1,189 @@
+#include "projectcatalog.h"
+#include "settings.h"
+#include "frametable.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
+
+#include <algorithm>
+
+static const char *CATALOG_FILENAME = "projectCatalog.json";
+static const int CATALOG_VERSION = 1;
+
+QMutex ProjectCatalog::_mutex;
+
+ProjectCatalog::ProjectCatalog ()
+{
+    Settings settings;
+    _storageLocation = settings.Get("settings/imageStorageLocation").toString();
+    _filenameFormat = settings.Get("settings/imageFilenameFormat").toString();
+    _catalogFilename = QDir(_storageLocation).filePath(CATALOG_FILENAME);
+}
+
+QList<ProjectCatalog::Entry> ProjectCatalog::GetProjects ()
+{
+    QMutexLocker lock (&_mutex);
+    QMap<QString, Entry> entries = Load();
+    bool changed = false;
+
+    QDir dir (_storageLocation);
+    QSet<QString> names;
+    if (dir.isReadable()) {
+        auto entryList = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (auto name : entryList) {
+            QFileInfo saveFile (GetSaveFilename(name));
+            if (!saveFile.exists()) {
+                continue;
+            }
+            names.insert(name);
+            auto existing = entries.find(name);
+            if (existing == entries.end() ||
+                existing->modified != saveFile.lastModified().toMSecsSinceEpoch()) {
+                Entry entry;
+                if (ReadProject(name, entry)) {
+                    entries[name] = entry;
+                } else {
+                    entries.remove(name);
+                    names.remove(name);
+                }
+                changed = true;
+            }
+        }
+    }
+
+    for (auto entry = entries.begin(); entry != entries.end(); ) {
+        if (!names.contains(entry.key())) {
+            entry = entries.erase(entry);
+            changed = true;
+        } else {
+            ++entry;
+        }
+    }
+
+    if (changed) {
+        Save(entries);
+    }
+
+    // The names are timestamps, so this is newest first
+    QList<Entry> projects = entries.values();
+    std::reverse(projects.begin(), projects.end());
+    return projects;
+}
+
+void ProjectCatalog::Update (const QString &name, int numberOfFrames, const QString &saveFilename,
+                             const QString &thumbnailFilename)
+{
+    QMutexLocker lock (&_mutex);
+    QMap<QString, Entry> entries = Load();
+    Entry entry;
+    entry.name = name;
+    entry.date = QDateTime::fromString(name, _filenameFormat);
+    entry.numberOfFrames = numberOfFrames;
+    entry.saveFilename = saveFilename;
+    entry.thumbnailFilename = thumbnailFilename;
+    entry.modified = QFileInfo(saveFilename).lastModified().toMSecsSinceEpoch();
+    entries[name] = entry;
+    Save(entries);
+}
+
+QMap<QString, ProjectCatalog::Entry> ProjectCatalog::Load () const
+{
+    QMap<QString, Entry> entries;
+    QFile catalogFile (_catalogFilename);
+    if (!catalogFile.open(QIODevice::ReadOnly)) {
+        return entries;
+    }
+    QJsonObject json = QJsonDocument::fromJson(catalogFile.readAll()).object();
+    if (json["version"].toInt() != CATALOG_VERSION) {
+        // Anything else is rebuilt from the projects themselves
+        return entries;
+    }
+    QJsonArray projects = json["projects"].toArray();
+    for (auto &&p: projects) {
+        QJsonObject project = p.toObject();
+        Entry entry;
+        entry.name = project["name"].toString();
+        entry.date = QDateTime::fromString(project["date"].toString(), Qt::ISODate);
+        entry.numberOfFrames = project["numberOfFrames"].toInt();
+        entry.saveFilename = project["saveFilename"].toString();
+        entry.thumbnailFilename = project["thumbnailFilename"].toString();
+        entry.modified = project["modified"].toString().toLongLong();
+        if (!entry.name.isEmpty()) {
+            entries[entry.name] = entry;
+        }
+    }
+    return entries;
+}
+
+void ProjectCatalog::Save (const QMap<QString, Entry> &entries) const
+{
+    QJsonArray projects;
+    for (auto &&entry: entries) {
+        QJsonObject project;
+        project["name"] = entry.name;
+        project["date"] = entry.date.toString(Qt::ISODate);
+        project["numberOfFrames"] = entry.numberOfFrames;
+        project["saveFilename"] = entry.saveFilename;
+        project["thumbnailFilename"] = entry.thumbnailFilename;
+        project["modified"] = QString::number(entry.modified);
+        projects.append(project);
+    }
+    QJsonObject json;
+    json["version"] = CATALOG_VERSION;
+    json["projects"] = projects;
+
+    // The catalog is only an index: if it can't be written, it gets rebuilt next time
+    QSaveFile catalogFile (_catalogFilename);
+    if (!catalogFile.open(QIODevice::WriteOnly)) {
+        qDebug() << "Could not write the project catalog" << _catalogFilename;
+        return;
+    }
+    catalogFile.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+    if (!catalogFile.commit()) {
+        qDebug() << "Could not write the project catalog" << _catalogFilename;
+    }
+}
+
+bool ProjectCatalog::ReadProject (const QString &name, Entry &entry) const
+{
+    QString saveFilename = GetSaveFilename(name);
+    QFile saveFile (saveFilename);
+    if (!saveFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QJsonObject json = QJsonDocument::fromJson(saveFile.readAll()).object();
+
+    // The same minimum Movie::load() requires
+    if (!json.contains("name") || !json.contains("numberOfFrames") || !json.contains("framesPerSecond")) {
+        return false;
+    }
+
+    entry.name = name;
+    entry.date = QDateTime::fromString(name, _filenameFormat);
+    entry.numberOfFrames = json["numberOfFrames"].toInt();
+    entry.saveFilename = QFileInfo(saveFilename).absoluteFilePath();
+    // The first frame is whichever the frame table lists first. Projects from before there was a
+    // frame table have their frames in JPEGs named <name>_00000.jpg, <name>_00001.jpg, ...
+    QDir directory = QFileInfo(saveFilename).absoluteDir();
+    QString thumbnail = name + "_00000.jpg";
+    FrameTable frames;
+    if (frames.Open(directory.filePath(name + "_frames.table")) && frames.GetNumberOfFrames() > 0) {
+        thumbnail = frames.GetFilename(0);
+    }
+    entry.thumbnailFilename = directory.filePath(thumbnail);
+    entry.modified = QFileInfo(saveFilename).lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+QString ProjectCatalog::GetSaveFilename (const QString &name) const
+{
+    return QDir(_storageLocation).filePath(name + "/" + name + ".json");
+}
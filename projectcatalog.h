@@ -0,0 +1,57 @@
+#ifndef PROJECTCATALOG_H
+#define PROJECTCATALOG_H
+
+#include <QDateTime>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief The ProjectCatalog class keeps an index of the saved projects in the image storage
+ * location, so that listing them doesn't mean loading every one. The index lives in that
+ * directory and is updated when a project is created, renamed or closed, or its thumbnail changes.
+ * When the catalog is read, an entry is only re-read from its project file if that file's
+ * modification time no longer matches, which is how frame counts changed in between are picked up.
+ */
+class ProjectCatalog
+{
+public:
+    struct Entry {
+        QString name;
+        QDateTime date;
+        int numberOfFrames = 0;
+        QString saveFilename;
+        QString thumbnailFilename;
+        qint64 modified = 0; // Of the save file when this entry was made, in ms since the epoch
+    };
+
+    ProjectCatalog ();
+
+    /**
+     * @brief GetProjects returns every saved project, newest first. New or changed projects are
+     * read from disk, deleted ones are dropped, and the index is rewritten if anything changed.
+     */
+    QList<Entry> GetProjects ();
+
+    /**
+     * @brief Update records a project that has just been saved.
+     */
+    void Update (const QString &name, int numberOfFrames, const QString &saveFilename,
+                 const QString &thumbnailFilename);
+
+private:
+    QMap<QString, Entry> Load () const;
+    void Save (const QMap<QString, Entry> &entries) const;
+    bool ReadProject (const QString &name, Entry &entry) const;
+    QString GetSaveFilename (const QString &name) const;
+
+    QString _storageLocation;
+    QString _catalogFilename;
+    QString _filenameFormat;
+
+    // Saving a movie and opening the dialog both rewrite the index
+    static QMutex _mutex;
+};
+
+#endif // PROJECTCATALOG_H
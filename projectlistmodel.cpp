@@ -0,0 +1,179 @@
+#include "projectlistmodel.h"
+
+#include <QDate>
+
+static const QSize THUMBNAIL_SIZE (64, 48);
+static const int THUMBNAIL_CACHE_KILOBYTES = 8 * 1024;
+
+// Top-level (group) indices have an internal id of 0, projects have their group's row + 1
+static const quintptr GROUP_ID = 0;
+
+ProjectListModel::ProjectListModel(QObject *parent) :
+    QAbstractItemModel (parent),
+    _thumbnails (THUMBNAIL_SIZE, THUMBNAIL_CACHE_KILOBYTES),
+    _placeholder (THUMBNAIL_SIZE, QImage::Format_RGB32)
+{
+    _placeholder.fill(Qt::lightGray);
+    connect (&_thumbnails, &ThumbnailLoader::thumbnailReady, this, &ProjectListModel::thumbnailReady);
+}
+
+void ProjectListModel::setProjects (const QList<ProjectCatalog::Entry> &projects)
+{
+    beginResetModel();
+    _thumbnails.CancelPending();
+    _thumbnailIndex.clear();
+
+    // 0 - Today
+    // 1 - Yesterday
+    // 2 - This week (assume the week started on Monday)
+    // 3 - Last week (really, to the previous Monday)
+    // 4 - Earlier
+    QList<Group> groups {{tr("Today"), {}}, {tr("Yesterday"), {}}, {tr("This week"), {}},
+                         {tr("Last week"), {}}, {tr("Earlier"), {}}};
+    for (auto &&project: projects) {
+        QDateTime timestamp (project.date);
+        if (!timestamp.isValid()) {
+            continue;
+        }
+        int insertionItem;
+        int daysToToday = int(abs(timestamp.daysTo(QDateTime::currentDateTime())));
+        int daysToMonday = QDate::currentDate().dayOfWeek() - 1;
+        if (daysToToday <= 0) {
+            insertionItem = 0;
+        } else if (daysToToday == 1) {
+            insertionItem = 1;
+        } else if (daysToToday <= daysToMonday) {
+            insertionItem = 2;
+        } else if (daysToToday < daysToMonday+7) {
+            insertionItem = 3;
+        } else {
+            insertionItem = 4;
+        }
+        groups[insertionItem].projects.append(project);
+    }
+
+    _groups.clear();
+    for (auto &&group: groups) {
+        if (!group.projects.isEmpty()) {
+            _groups.append(group);
+        }
+    }
+    endResetModel();
+
+    for (int g = 0; g < _groups.size(); ++g) {
+        for (int p = 0; p < _groups[g].projects.size(); ++p) {
+            _thumbnailIndex.insert(_groups[g].projects[p].thumbnailFilename, createIndex(p, 0, quintptr(g + 1)));
+        }
+    }
+}
+
+bool ProjectListModel::isProject (const QModelIndex &index) const
+{
+    return index.isValid() && index.internalId() != GROUP_ID;
+}
+
+ProjectCatalog::Entry ProjectListModel::getProject (const QModelIndex &index) const
+{
+    if (!isProject(index)) {
+        return ProjectCatalog::Entry();
+    }
+    return _groups[int(index.internalId() - 1)].projects[index.row()];
+}
+
+QModelIndex ProjectListModel::firstProject () const
+{
+    if (_groups.isEmpty()) {
+        return QModelIndex();
+    }
+    return createIndex(0, 0, quintptr(1));
+}
+
+QModelIndex ProjectListModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+    if (!parent.isValid()) {
+        return createIndex(row, column, GROUP_ID);
+    }
+    return createIndex(row, column, quintptr(parent.row() + 1));
+}
+
+QModelIndex ProjectListModel::parent(const QModelIndex &child) const
+{
+    if (!isProject(child)) {
+        return QModelIndex();
+    }
+    return createIndex(int(child.internalId() - 1), 0, GROUP_ID);
+}
+
+int ProjectListModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return _groups.size();
+    }
+    if (parent.internalId() == GROUP_ID && parent.column() == 0) {
+        return _groups[parent.row()].projects.size();
+    }
+    return 0;
+}
+
+int ProjectListModel::columnCount(const QModelIndex &) const
+{
+    return 3;
+}
+
+QVariant ProjectListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+    if (!isProject(index)) {
+        if (role == Qt::DisplayRole && index.column() == 0) {
+            return _groups[index.row()].title;
+        }
+        return QVariant();
+    }
+
+    const ProjectCatalog::Entry &project = _groups[int(index.internalId() - 1)].projects[index.row()];
+    if (role == Qt::DisplayRole) {
+        QDateTime timestamp (project.date);
+        switch (index.column()) {
+        case 0:
+            if (timestamp.daysTo(QDateTime::currentDateTime()) > 365) {
+                return timestamp.date().toString(Qt::SystemLocaleLongDate);
+            }
+            return timestamp.toString("MMMM d");
+        case 1:
+            return timestamp.toLocalTime().time().toString(Qt::SystemLocaleShortDate);
+        case 2:
+            return QString::number(project.numberOfFrames);
+        }
+    } else if (role == Qt::DecorationRole && index.column() == 0) {
+        // Only called for rows the view is about to draw
+        QImage thumbnail = _thumbnails.Get(project.thumbnailFilename);
+        return thumbnail.isNull() ? _placeholder : thumbnail;
+    }
+    return QVariant();
+}
+
+QVariant ProjectListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+    case 0: return tr("Date");
+    case 1: return tr("Time");
+    case 2: return tr("Frames");
+    }
+    return QVariant();
+}
+
+void ProjectListModel::thumbnailReady (const QString &filename)
+{
+    auto index = _thumbnailIndex.find(filename);
+    if (index != _thumbnailIndex.end() && index->isValid()) {
+        emit dataChanged(*index, *index, {Qt::DecorationRole});
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef PROJECTLISTMODEL_H
+#define PROJECTLISTMODEL_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QImage>
+
+#include "projectcatalog.h"
+#include "thumbnailloader.h"
+
+/**
+ * @brief The ProjectListModel class presents the saved projects grouped by when they were made
+ * (Today, Yesterday, This week, Last week, Earlier), with a date, time and frame count column.
+ * Only groups that have projects in them are shown. The first column is decorated with a
+ * thumbnail of the project's first frame, which is decoded in the background the first time the
+ * view asks for it, so only the rows that are actually on screen ever get decoded.
+ */
+class ProjectListModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit ProjectListModel(QObject *parent = nullptr);
+
+    void setProjects (const QList<ProjectCatalog::Entry> &projects);
+
+    bool isProject (const QModelIndex &index) const;
+
+    ProjectCatalog::Entry getProject (const QModelIndex &index) const;
+
+    /**
+     * @brief firstProject returns the index of the newest project, or an invalid index if there are none.
+     */
+    QModelIndex firstProject () const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private slots:
+
+    void thumbnailReady (const QString &filename);
+
+private:
+    struct Group {
+        QString title;
+        QList<ProjectCatalog::Entry> projects;
+    };
+
+    QList<Group> _groups;
+    QHash<QString, QPersistentModelIndex> _thumbnailIndex;
+    mutable ThumbnailLoader _thumbnails;
+    QImage _placeholder;
+};
+
+#endif // PROJECTLISTMODEL_H
@@ -25,6 +25,9 @@ Settings::Settings(QObject *parent) : QObject(parent)
         SETTING_DEFAULTS.insert("settings/preTitleScreenDuration",2.0);
         SETTING_DEFAULTS.insert("settings/titleScreenDuration",2.0);
         SETTING_DEFAULTS.insert("settings/creditsDuration",5.0);
+        SETTING_DEFAULTS.insert("settings/jpegQuality",90);
+        SETTING_DEFAULTS.insert("settings/jpegOptimizedWrite",false);
+        SETTING_DEFAULTS.insert("settings/timeLapseInterval",5.0);
 
         JSONFormat = QSettings::registerFormat("json", Settings::readJSONFile, Settings::writeJSONFile);
         _settingsFile = "./StopMotionCreatorSettings.json";
@@ -37,7 +40,8 @@ Settings::Settings(QObject *parent) : QObject(parent)
 QVariant Settings::Get(const QString &key)
 {
     QSettings s(_settingsFile, JSONFormat);
-    return s.value (key, SETTING_DEFAULTS[key]);
+    // value() rather than operator[], which would insert into the map shared by every thread
+    return s.value (key, SETTING_DEFAULTS.value(key));
 }
 
 void Settings::Set(const QString &key, QVariant value)
@@ -34,13 +34,7 @@ SettingsDialog::SettingsDialog(QWidget *parent) :
     ui->fpsCombo->addItem(QString("25"), QVariant(25));
     ui->fpsCombo->addItem(QString("30"), QVariant(30));
 
-    // Camera
-    QList<QCameraInfo> cameras = QCameraInfo::availableCameras();
-    ui->cameraCombo->addItem ("Always use default");
-    ui->cameraCombo->insertSeparator(1);
-    for (auto camera: cameras) {
-        ui->cameraCombo->addItem (camera.description());
-    }
+    // Cameras are listed in load(): enumerating them is slow, and they may have changed by then
 
     // Resolution
     ui->resolutionCombo->addItem(QString("640 x 480 (Default)"), QVariant(QSize(640,480)));
@@ -85,12 +79,18 @@ void SettingsDialog::load ()
     ui->filenameFormatLineEdit->setText(imageFilenameFormat);
 
     // Camera (what is stored is the description string from the QCamera object)
+    ui->cameraCombo->clear();
+    ui->cameraCombo->addItem ("Always use default");
+    ui->cameraCombo->insertSeparator(1);
+    for (auto camera: QCameraInfo::availableCameras()) {
+        ui->cameraCombo->addItem (camera.description());
+    }
     QString cameraString = settings.Get("settings/camera").toString();
-    int cameraIndex = ui->fileTypeCombo->findText(cameraString.toUpper());
+    int cameraIndex = ui->cameraCombo->findText(cameraString);
     if (cameraIndex != -1) {
-        ui->fileTypeCombo->setCurrentIndex (cameraIndex);
+        ui->cameraCombo->setCurrentIndex (cameraIndex);
     } else {
-        ui->fileTypeCombo->setCurrentText("Always use default");
+        ui->cameraCombo->setCurrentIndex (0);
     }
 
     // Resolution
@@ -119,6 +119,16 @@ void SettingsDialog::load ()
     // Credits duration
     double creditsDuration = settings.Get("settings/creditsDuration").toDouble();
     ui->creditsDurationSpinbox->setValue(creditsDuration);
+
+    // JPEG quality
+    int jpegQuality = settings.Get("settings/jpegQuality").toInt();
+    ui->jpegQualitySpinbox->setValue(jpegQuality);
+    bool jpegOptimizedWrite = settings.Get("settings/jpegOptimizedWrite").toBool();
+    ui->jpegOptimizedWriteCheckbox->setChecked(jpegOptimizedWrite);
+
+    // Time-lapse interval
+    double timeLapseInterval = settings.Get("settings/timeLapseInterval").toDouble();
+    ui->timeLapseIntervalSpinbox->setValue(timeLapseInterval);
 }
 
 void SettingsDialog::store ()
@@ -173,6 +183,16 @@ void SettingsDialog::store ()
     // Credits duration
     double creditsDuration = ui->creditsDurationSpinbox->value();
     settings.Set("settings/creditsDuration", creditsDuration);
+
+    // JPEG quality
+    int jpegQuality = ui->jpegQualitySpinbox->value();
+    settings.Set("settings/jpegQuality", jpegQuality);
+    bool jpegOptimizedWrite = ui->jpegOptimizedWriteCheckbox->isChecked();
+    settings.Set("settings/jpegOptimizedWrite", jpegOptimizedWrite);
+
+    // Time-lapse interval
+    double timeLapseInterval = ui->timeLapseIntervalSpinbox->value();
+    settings.Set("settings/timeLapseInterval", timeLapseInterval);
 }
 
 void SettingsDialog::on_imageLocationBrowseButton_clicked()
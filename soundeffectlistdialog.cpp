@@ -9,6 +9,12 @@ SoundEffectListDialog::SoundEffectListDialog(QWidget *parent) :
     ui->playButton->setEnabled(false);
     ui->removeButton->setEnabled(false);
     ui->editButton->setEnabled(false);
+
+    _timeline = new SoundEffectTimeline(this);
+    ui->mainLayout->insertWidget(0, _timeline);
+    connect (_timeline, &SoundEffectTimeline::frameClicked, this, &SoundEffectListDialog::frameSelected);
+    connect (_timeline, &SoundEffectTimeline::soundEffectClicked, this, &SoundEffectListDialog::timelineSoundEffectClicked);
+    connect (_timeline, &SoundEffectTimeline::soundEffectDoubleClicked, this, &SoundEffectListDialog::edit);
 }
 
 SoundEffectListDialog::~SoundEffectListDialog()
@@ -16,6 +22,16 @@ SoundEffectListDialog::~SoundEffectListDialog()
     delete ui;
 }
 
+void SoundEffectListDialog::SetFrames(const QStringList &filenames, const QVector<int> &holdCounts, double framesPerSecond)
+{
+    _timeline->setFrames(filenames, holdCounts, framesPerSecond);
+}
+
+void SoundEffectListDialog::SetCurrentFrame(int frame)
+{
+    _timeline->setCurrentFrame(frame);
+}
+
 void SoundEffectListDialog::AddSoundEffect(const SoundEffect &sfx)
 {
     _sfx.append(sfx);
@@ -36,14 +52,15 @@ void SoundEffectListDialog::AddSoundEffect(const SoundEffect &sfx)
     QTableWidgetItem *newItemDuration   = new QTableWidgetItem(QString::number(duration)); // Duration
     QTableWidgetItem *newItemVolume   = new QTableWidgetItem(QString::number(ceil(logVolume*100))); // Volume
 
-    auto row = ui->tableWidget->rowCount();
-    ui->tableWidget->insertRow(ui->tableWidget->rowCount());
+    auto row = RowForFrame(startFrame);
+    ui->tableWidget->insertRow(row);
     ui->tableWidget->setItem(row, 0, newItemFrame);
     ui->tableWidget->setItem(row, 1, newItemStart);
     ui->tableWidget->setItem(row, 2, newItemEnd);
     ui->tableWidget->setItem(row, 3, newItemDuration);
     ui->tableWidget->setItem(row, 4, newItemVolume);
     ui->tableWidget->setItem(row, 5, newItemFilename);
+    _timeline->setSoundEffect(startFrame, sfx);
 }
 
 void SoundEffectListDialog::AddSoundEffects(const QList<SoundEffect> &sfx)
@@ -65,6 +82,7 @@ void SoundEffectListDialog::RemoveSoundEffect(const SoundEffect &sfx)
             break;
         }
     }
+    _timeline->removeSoundEffect(sfx);
 }
 
 void SoundEffectListDialog::RemoveAllSoundEffects()
@@ -73,17 +91,48 @@ void SoundEffectListDialog::RemoveAllSoundEffects()
     while (ui->tableWidget->rowCount() > 0) {
         ui->tableWidget->removeRow(0);
     }
+    _timeline->setSoundEffects(QList<SoundEffect>());
     ui->playButton->setEnabled(false);
     ui->removeButton->setEnabled(false);
     ui->editButton->setEnabled(false);
 }
 
+void SoundEffectListDialog::SetSoundEffect(int frame, const SoundEffect &sfx)
+{
+    auto row = RowForFrame(frame);
+    if (row < ui->tableWidget->rowCount() && ui->tableWidget->item(row, 0)->text().toInt() == frame) {
+        if (ui->tableWidget->currentRow() == row) {
+            ui->playButton->setEnabled(false);
+            ui->removeButton->setEnabled(false);
+            ui->editButton->setEnabled(false);
+        }
+        _sfx.removeAll(SFXFromRow(row));
+        ui->tableWidget->removeRow(row);
+    }
+    if (sfx) {
+        AddSoundEffect(sfx);
+    } else {
+        _timeline->setSoundEffect(frame, sfx);
+    }
+}
+
 void SoundEffectListDialog::on_tableWidget_cellClicked(int row, int)
 {
     ui->playButton->setEnabled(true);
     ui->removeButton->setEnabled(true);
     ui->editButton->setEnabled(true);
-    emit selected (SFXFromRow(row));
+    SoundEffect sfx = SFXFromRow(row);
+    _timeline->setSelectedSoundEffect(sfx);
+    emit selected (sfx);
+}
+
+void SoundEffectListDialog::timelineSoundEffectClicked(const SoundEffect &sfx)
+{
+    ui->tableWidget->setCurrentCell(RowForFrame(sfx.getStartFrame()), 0);
+    ui->playButton->setEnabled(true);
+    ui->removeButton->setEnabled(true);
+    ui->editButton->setEnabled(true);
+    emit selected (sfx);
 }
 
 void SoundEffectListDialog::on_tableWidget_cellDoubleClicked(int row, int)
@@ -125,3 +174,13 @@ SoundEffect SoundEffectListDialog::SFXFromRow(int row) const
     SoundEffect sfx (filename, startFrame, inPoint, outPoint, linearVolume*100);
     return sfx;
 }
+
+int SoundEffectListDialog::RowForFrame(int frame) const
+{
+    // The rows are kept in frame order
+    int row = 0;
+    while (row < ui->tableWidget->rowCount() && ui->tableWidget->item(row, 0)->text().toInt() < frame) {
+        ++row;
+    }
+    return row;
+}
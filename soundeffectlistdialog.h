@@ -4,6 +4,7 @@
 #include <QDialog>
 #include <QList>
 #include "soundeffect.h"
+#include "soundeffecttimeline.h"
 
 
 namespace Ui {
@@ -18,6 +19,10 @@ public:
     explicit SoundEffectListDialog( QWidget *parent = 0);
     ~SoundEffectListDialog();
 
+    void SetFrames(const QStringList &filenames, const QVector<int> &holdCounts, double framesPerSecond);
+
+    void SetCurrentFrame(int frame);
+
     void AddSoundEffect(const SoundEffect &sfx);
 
     void AddSoundEffects(const QList<SoundEffect> &sfx);
@@ -26,11 +31,18 @@ public:
 
     void RemoveAllSoundEffects ();
 
+    /**
+     * @brief SetSoundEffect updates just the sound effect on one frame (an empty sound removes it),
+     * rather than reloading the whole list.
+     */
+    void SetSoundEffect(int frame, const SoundEffect &sfx);
+
 signals:
     void remove(const SoundEffect &sfx);
     void edit(const SoundEffect &sfx);
     void play(const SoundEffect &sfx);
     void selected (const SoundEffect &sfx);
+    void frameSelected (int frame);
 
 private slots:
     void on_tableWidget_cellClicked(int row, int column);
@@ -43,13 +55,18 @@ private slots:
 
     void on_playButton_clicked();
 
+    void timelineSoundEffectClicked(const SoundEffect &sfx);
+
 private:
 
     SoundEffect SFXFromRow(int row) const;
 
+    int RowForFrame(int frame) const;
+
 private:
     Ui::SoundEffectListDialog *ui;
     QList<SoundEffect> _sfx;
+    SoundEffectTimeline *_timeline;
 };
 
 #endif // SOUNDEFFECTLISTDIALOG_H
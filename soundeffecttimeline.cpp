@@ -0,0 +1,365 @@
+#include "soundeffecttimeline.h"
+
+#include <QFileInfo>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QWheelEvent>
+
+#include <algorithm>
+#include <cmath>
+
+static const QSize THUMBNAIL_SIZE (64, 48);
+static const int THUMBNAIL_CACHE_KILOBYTES = 32 * 1024;
+static const int FRAME_WIDTH = 68;
+static const int RULER_HEIGHT = 18;
+static const int THUMBNAIL_TOP = RULER_HEIGHT + 2;
+static const int LANES_TOP = THUMBNAIL_TOP + 48 + 6;
+static const int LANE_HEIGHT = 20;
+static const int FRAMES_PER_WHEEL_NOTCH = 3;
+
+SoundEffectTimeline::SoundEffectTimeline(QWidget *parent) :
+    QAbstractScrollArea (parent),
+    _movieFrames (1, 0),
+    _framesPerSecond (0.0),
+    _numberOfLanes (1),
+    _selectedRegion (-1),
+    _currentFrame (-1),
+    _thumbnails (THUMBNAIL_SIZE, THUMBNAIL_CACHE_KILOBYTES)
+{
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    connect (&_thumbnails, &ThumbnailLoader::thumbnailReady, this, &SoundEffectTimeline::thumbnailReady);
+}
+
+void SoundEffectTimeline::setFrames (const QStringList &filenames, const QVector<int> &holdCounts, double framesPerSecond)
+{
+    _thumbnails.CancelPending();
+    _frames = filenames;
+    _framesPerSecond = framesPerSecond;
+    _frameForFilename.clear();
+    _movieFrames.resize(_frames.size() + 1);
+    _movieFrames[0] = 0;
+    for (int frame = 0; frame < _frames.size(); ++frame) {
+        _frameForFilename.insert(_frames[frame], frame);
+        int hold = frame < holdCounts.size() ? std::max(1, holdCounts[frame]) : 1;
+        _movieFrames[frame + 1] = _movieFrames[frame] + hold;
+    }
+    layoutRegions(QHash<int, QRect>());
+    updateScrollBars();
+    viewport()->update();
+}
+
+void SoundEffectTimeline::setSoundEffects (const QList<SoundEffect> &sfx)
+{
+    _regions.clear();
+    _selectedRegion = -1;
+    for (auto &&effect: sfx) {
+        Region region;
+        region.sfx = effect;
+        _regions.insert(effect.getStartFrame(), region);
+    }
+    layoutRegions(QHash<int, QRect>());
+    viewport()->update();
+}
+
+void SoundEffectTimeline::setSoundEffect (int frame, const SoundEffect &sfx)
+{
+    auto before = regionRects();
+    if (sfx) {
+        Region region;
+        region.sfx = sfx;
+        _regions.insert(frame, region);
+    } else {
+        _regions.remove(frame);
+        if (_selectedRegion == frame) {
+            _selectedRegion = -1;
+        }
+    }
+    layoutRegions(before, frame);
+}
+
+void SoundEffectTimeline::removeSoundEffect (const SoundEffect &sfx)
+{
+    for (auto region = _regions.constBegin(); region != _regions.constEnd(); ++region) {
+        if (region->sfx == sfx) {
+            setSoundEffect(region.key(), SoundEffect());
+            return;
+        }
+    }
+}
+
+void SoundEffectTimeline::setSelectedSoundEffect (const SoundEffect &sfx)
+{
+    int previous = _selectedRegion;
+    _selectedRegion = -1;
+    for (auto region = _regions.constBegin(); region != _regions.constEnd(); ++region) {
+        if (region->sfx == sfx) {
+            _selectedRegion = region.key();
+        }
+    }
+    for (int frame: {previous, _selectedRegion}) {
+        if (_regions.contains(frame)) {
+            viewport()->update(regionRect(_regions[frame], frame).translated(-offset()));
+        }
+    }
+}
+
+void SoundEffectTimeline::setCurrentFrame (int frame)
+{
+    if (frame == _currentFrame) {
+        return;
+    }
+    int previous = _currentFrame;
+    _currentFrame = frame;
+    if (previous >= 0) {
+        viewport()->update(frameRect(previous).translated(-offset()));
+    }
+    if (frame < 0) {
+        return;
+    }
+    QRect r = frameRect(frame);
+    int left = horizontalScrollBar()->value();
+    if (r.left() < left || r.right() >= left + viewport()->width()) {
+        horizontalScrollBar()->setValue(r.center().x() - viewport()->width() / 2);
+    }
+    viewport()->update(r.translated(-offset()));
+}
+
+QSize SoundEffectTimeline::sizeHint () const
+{
+    int height = LANES_TOP + std::max(1, _numberOfLanes) * LANE_HEIGHT + 4;
+    return QSize(FRAME_WIDTH * 8, height + horizontalScrollBar()->sizeHint().height() + 2 * frameWidth());
+}
+
+void SoundEffectTimeline::paintEvent (QPaintEvent *event)
+{
+    QPainter painter (viewport());
+    QPoint o = offset();
+    QRect dirty = event->rect().translated(o);
+    painter.translate(-o);
+    painter.fillRect(dirty, palette().base());
+
+    // Only the columns that need repainting
+    int first = std::max(0, dirty.left() / FRAME_WIDTH);
+    int last = std::min(_frames.size() - 1, dirty.right() / FRAME_WIDTH);
+    for (int frame = first; frame <= last; ++frame) {
+        QRect column = frameRect(frame);
+        if (frame == _currentFrame) {
+            painter.fillRect(column, palette().highlight());
+        }
+        painter.setPen(frame == _currentFrame ? palette().highlightedText().color() : palette().text().color());
+        int hold = _movieFrames[frame + 1] - _movieFrames[frame];
+        QString label = hold > 1 ? QString("%1 (x%2)").arg(frame + 1).arg(hold) : QString::number(frame + 1);
+        painter.drawText(QRect(column.left(), 0, FRAME_WIDTH, RULER_HEIGHT), Qt::AlignCenter, label);
+        painter.setPen(palette().mid().color());
+        painter.drawLine(column.topRight(), column.bottomRight());
+
+        QRect thumbnailRect (column.left() + (FRAME_WIDTH - THUMBNAIL_SIZE.width()) / 2, THUMBNAIL_TOP,
+                             THUMBNAIL_SIZE.width(), THUMBNAIL_SIZE.height());
+        QImage thumbnail = _thumbnails.Get(_frames[frame]);
+        if (thumbnail.isNull()) {
+            painter.fillRect(thumbnailRect, Qt::lightGray);
+        } else {
+            QRect target (QPoint(0, 0), thumbnail.size());
+            target.moveCenter(thumbnailRect.center());
+            painter.drawImage(target, thumbnail);
+        }
+    }
+
+    for (auto region = _regions.constBegin(); region != _regions.constEnd(); ++region) {
+        QRect r = regionRect(*region, region.key());
+        if (!r.intersects(dirty)) {
+            continue;
+        }
+        QString filename = region->sfx.getFilename();
+        QColor color = QColor::fromHsv(int(qHash(filename) % 360), 90, 230);
+        bool selected = region.key() == _selectedRegion;
+        painter.setPen(QPen(selected ? color.darker(200) : color.darker(140), selected ? 2 : 1));
+        painter.setBrush(selected ? color.darker(115) : color);
+        painter.drawRect(r.adjusted(0, 0, -1, -1));
+        painter.setPen(palette().text().color());
+        QRect textRect = r.adjusted(4, 0, -4, 0);
+        painter.drawText(textRect, Qt::AlignVCenter | Qt::AlignLeft,
+                         painter.fontMetrics().elidedText(QFileInfo(filename).completeBaseName(), Qt::ElideRight, textRect.width()));
+    }
+}
+
+void SoundEffectTimeline::resizeEvent (QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void SoundEffectTimeline::scrollContentsBy (int dx, int dy)
+{
+    viewport()->scroll(dx, dy);
+
+    // Frames that have scrolled out of view before they were decoded aren't needed any more
+    _thumbnails.CancelPending();
+    requestVisibleThumbnails();
+}
+
+void SoundEffectTimeline::mousePressEvent (QMouseEvent *event)
+{
+    int region = regionAt(event->pos());
+    if (region >= 0) {
+        SoundEffect sfx = _regions[region].sfx;
+        setSelectedSoundEffect(sfx);
+        emit soundEffectClicked(sfx);
+        return;
+    }
+    int frame = frameAt(event->pos());
+    if (frame >= 0) {
+        setCurrentFrame(frame);
+        emit frameClicked(frame);
+    }
+}
+
+void SoundEffectTimeline::mouseDoubleClickEvent (QMouseEvent *event)
+{
+    int region = regionAt(event->pos());
+    if (region >= 0) {
+        emit soundEffectDoubleClicked(_regions[region].sfx);
+    }
+}
+
+void SoundEffectTimeline::wheelEvent (QWheelEvent *event)
+{
+    int delta = event->angleDelta().x() != 0 ? event->angleDelta().x() : event->angleDelta().y();
+    horizontalScrollBar()->setValue(horizontalScrollBar()->value() - delta * FRAMES_PER_WHEEL_NOTCH * FRAME_WIDTH / 120);
+    event->accept();
+}
+
+void SoundEffectTimeline::thumbnailReady (const QString &filename)
+{
+    int frame = _frameForFilename.value(filename, -1);
+    if (frame >= 0) {
+        viewport()->update(frameRect(frame).translated(-offset()));
+    }
+}
+
+QHash<int, QRect> SoundEffectTimeline::regionRects () const
+{
+    QHash<int, QRect> rects;
+    for (auto region = _regions.constBegin(); region != _regions.constEnd(); ++region) {
+        rects.insert(region.key(), regionRect(*region, region.key()));
+    }
+    return rects;
+}
+
+void SoundEffectTimeline::layoutRegions (const QHash<int, QRect> &before, int changedFrame)
+{
+    // Each region goes in the first lane that is free by the frame it starts on. The regions are
+    // in start order, so this uses as few lanes as possible.
+    QVector<int> laneEnds;
+    for (auto region = _regions.begin(); region != _regions.end(); ++region) {
+        double duration = region->sfx.getOutPoint() - region->sfx.getInPoint();
+        region->lengthInFrames = lengthInColumns(region.key(), int(std::ceil(duration * _framesPerSecond - 1e-6)));
+        int lane = 0;
+        while (lane < laneEnds.size() && laneEnds[lane] > region.key()) {
+            ++lane;
+        }
+        if (lane == laneEnds.size()) {
+            laneEnds.append(0);
+        }
+        laneEnds[lane] = region.key() + region->lengthInFrames;
+        region->lane = lane;
+    }
+
+    int numberOfLanes = std::max(1, laneEnds.size());
+    if (numberOfLanes != _numberOfLanes) {
+        _numberOfLanes = numberOfLanes;
+        updateGeometry();
+        updateScrollBars();
+        viewport()->update();
+        return;
+    }
+
+    QPoint o = offset();
+    auto after = regionRects();
+    for (auto old = before.constBegin(); old != before.constEnd(); ++old) {
+        if (after.value(old.key()) != old.value() || old.key() == changedFrame) {
+            viewport()->update(old.value().translated(-o));
+        }
+    }
+    for (auto now = after.constBegin(); now != after.constEnd(); ++now) {
+        if (before.value(now.key()) != now.value() || now.key() == changedFrame) {
+            viewport()->update(now.value().translated(-o));
+        }
+    }
+}
+
+int SoundEffectTimeline::lengthInColumns (int startFrame, int lengthInMovieFrames) const
+{
+    // Columns are frames, but a held frame lasts several frames of the movie. Past the last frame
+    // there's nothing held, so a sound that runs on past the end takes one column per movie frame.
+    int numberOfFrames = _frames.size();
+    int start = std::max(0, std::min(startFrame, numberOfFrames));
+    int end = _movieFrames[start] + std::max(0, lengthInMovieFrames);
+    int endFrame;
+    if (end > _movieFrames[numberOfFrames]) {
+        endFrame = numberOfFrames + (end - _movieFrames[numberOfFrames]);
+    } else {
+        endFrame = int(std::lower_bound(_movieFrames.constBegin(), _movieFrames.constEnd(), end) - _movieFrames.constBegin());
+    }
+    return std::max(1, endFrame - start);
+}
+
+void SoundEffectTimeline::updateScrollBars ()
+{
+    int contentWidth = _frames.size() * FRAME_WIDTH;
+    int contentHeight = LANES_TOP + _numberOfLanes * LANE_HEIGHT + 4;
+    QSize view = viewport()->size();
+    horizontalScrollBar()->setRange(0, std::max(0, contentWidth - view.width()));
+    horizontalScrollBar()->setPageStep(view.width());
+    horizontalScrollBar()->setSingleStep(FRAME_WIDTH);
+    verticalScrollBar()->setRange(0, std::max(0, contentHeight - view.height()));
+    verticalScrollBar()->setPageStep(view.height());
+    verticalScrollBar()->setSingleStep(LANE_HEIGHT);
+}
+
+void SoundEffectTimeline::requestVisibleThumbnails ()
+{
+    int left = horizontalScrollBar()->value();
+    int first = std::max(0, left / FRAME_WIDTH);
+    int last = std::min(_frames.size() - 1, (left + viewport()->width()) / FRAME_WIDTH);
+    for (int frame = first; frame <= last; ++frame) {
+        _thumbnails.Get(_frames[frame]);
+    }
+}
+
+QRect SoundEffectTimeline::frameRect (int frame) const
+{
+    return QRect(frame * FRAME_WIDTH, 0, FRAME_WIDTH, LANES_TOP);
+}
+
+QRect SoundEffectTimeline::regionRect (const Region &region, int frame) const
+{
+    return QRect(frame * FRAME_WIDTH + 1, LANES_TOP + region.lane * LANE_HEIGHT + 1,
+                 region.lengthInFrames * FRAME_WIDTH - 2, LANE_HEIGHT - 2);
+}
+
+QPoint SoundEffectTimeline::offset () const
+{
+    return QPoint(horizontalScrollBar()->value(), verticalScrollBar()->value());
+}
+
+int SoundEffectTimeline::regionAt (const QPoint &viewportPosition) const
+{
+    QPoint position = viewportPosition + offset();
+    for (auto region = _regions.constBegin(); region != _regions.constEnd(); ++region) {
+        if (regionRect(*region, region.key()).contains(position)) {
+            return region.key();
+        }
+    }
+    return -1;
+}
+
+int SoundEffectTimeline::frameAt (const QPoint &viewportPosition) const
+{
+    int frame = (viewportPosition.x() + offset().x()) / FRAME_WIDTH;
+    return (frame >= 0 && frame < _frames.size()) ? frame : -1;
+}
@@ -0,0 +1,113 @@
+#ifndef SOUNDEFFECTTIMELINE_H
+#define SOUNDEFFECTTIMELINE_H
+
+#include <QAbstractScrollArea>
+#include <QHash>
+#include <QImage>
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+
+#include "soundeffect.h"
+#include "thumbnailloader.h"
+
+/**
+ * @brief The SoundEffectTimeline class shows a movie as a strip of frame thumbnails, one column
+ * per frame, with each sound effect drawn underneath as a region from the frame it starts on to
+ * the frame it ends on (allowing for frames that are held). Overlapping sounds are stacked in lanes.
+ *
+ * Nothing is laid out per frame: painting only touches the columns in view, and thumbnails are
+ * decoded in the background the first time their column is shown. Changing a single sound effect
+ * only repaints the regions that actually moved, so the timeline stays responsive with thousands
+ * of frames.
+ */
+class SoundEffectTimeline : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit SoundEffectTimeline(QWidget *parent = nullptr);
+
+    /**
+     * @brief setFrames sets the frames shown, one column each, and how many frames of the movie
+     * each is held for, so that a sound's region covers the frames it actually plays over.
+     */
+    void setFrames (const QStringList &filenames, const QVector<int> &holdCounts, double framesPerSecond);
+
+    void setSoundEffects (const QList<SoundEffect> &sfx);
+
+    /**
+     * @brief setSoundEffect replaces the sound effect starting on a frame: an empty sound removes it.
+     */
+    void setSoundEffect (int frame, const SoundEffect &sfx);
+
+    void removeSoundEffect (const SoundEffect &sfx);
+
+    void setSelectedSoundEffect (const SoundEffect &sfx);
+
+    void setCurrentFrame (int frame);
+
+    QSize sizeHint () const override;
+
+signals:
+
+    void frameClicked (int frame);
+
+    void soundEffectClicked (const SoundEffect &sfx);
+
+    void soundEffectDoubleClicked (const SoundEffect &sfx);
+
+protected:
+    void paintEvent (QPaintEvent *event) override;
+    void resizeEvent (QResizeEvent *event) override;
+    void scrollContentsBy (int dx, int dy) override;
+    void mousePressEvent (QMouseEvent *event) override;
+    void mouseDoubleClickEvent (QMouseEvent *event) override;
+    void wheelEvent (QWheelEvent *event) override;
+
+private slots:
+
+    void thumbnailReady (const QString &filename);
+
+private:
+    struct Region {
+        SoundEffect sfx;
+        int lengthInFrames = 1;
+        int lane = 0;
+    };
+
+    QHash<int, QRect> regionRects () const;
+
+    /**
+     * Re-stack the regions into lanes, and repaint any whose place changed since before (as well
+     * as the region on changedFrame, whose contents changed)
+     */
+    void layoutRegions (const QHash<int, QRect> &before, int changedFrame = -1);
+
+    /**
+     * The number of columns, from startFrame on, that lengthInMovieFrames of the movie covers
+     */
+    int lengthInColumns (int startFrame, int lengthInMovieFrames) const;
+
+    void updateScrollBars ();
+    void requestVisibleThumbnails ();
+
+    // Rectangles in content coordinates (before scrolling)
+    QRect frameRect (int frame) const;
+    QRect regionRect (const Region &region, int frame) const;
+    QPoint offset () const;
+    int regionAt (const QPoint &viewportPosition) const;
+    int frameAt (const QPoint &viewportPosition) const;
+
+    QStringList _frames;
+    QHash<QString, int> _frameForFilename;
+    QVector<int> _movieFrames;  // The frame of the movie each frame first appears on, plus the length
+    double _framesPerSecond;
+    QMap<int, Region> _regions; // By start frame, which is unique
+    int _numberOfLanes;
+    int _selectedRegion;
+    int _currentFrame;
+    ThumbnailLoader _thumbnails;
+};
+
+#endif // SOUNDEFFECTTIMELINE_H
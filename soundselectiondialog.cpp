@@ -2,7 +2,8 @@
 #include "ui_soundselectiondialog.h"
 
 #include <QFileDialog>
-#include <QAudioDecoder>
+#include <QFileInfo>
+#include <QMessageBox>
 #include <QTimer>
 #include <QStyle>
 #include "settings.h"
@@ -19,7 +20,7 @@ SoundSelectionDialog::SoundSelectionDialog(Mode mode, QWidget *parent) :
     ui(new Ui::SoundSelectionDialog),
     _fileDialog (nullptr),
     _mode (mode),
-    _decoder(nullptr),
+    _loader(nullptr),
     _musicSet (false),
     _loading (false)
 {
@@ -44,9 +45,9 @@ SoundSelectionDialog::SoundSelectionDialog(Mode mode, QWidget *parent) :
     connect(_player, &QMediaPlayer::stateChanged, this, &SoundSelectionDialog::playerStateChanged);
     connect(_waveform, &Waveform::playheadManuallyChanged, this, &SoundSelectionDialog::setPlayhead);
 
-    _decoder = new QAudioDecoder(this);
-    connect (_decoder, &QAudioDecoder::bufferReady, this, &SoundSelectionDialog::readBuffer);
-    connect (_decoder, &QAudioDecoder::finished, this, &SoundSelectionDialog::readFinished);
+    _loader = new WaveformLoader(this);
+    connect (_loader, &WaveformLoader::loadFinished, this, &SoundSelectionDialog::peaksLoaded);
+    connect (_loader, &WaveformLoader::loadFailed, this, &SoundSelectionDialog::peaksFailed);
 
     QString startingDirectory = "";
     switch (_mode) {
@@ -68,7 +69,7 @@ SoundSelectionDialog::SoundSelectionDialog(Mode mode, QWidget *parent) :
 
 SoundSelectionDialog::~SoundSelectionDialog()
 {
-    delete _decoder;
+    delete _loader;
     delete _player;
     delete _waveform;
     delete ui;
@@ -114,39 +115,42 @@ void SoundSelectionDialog::loadFile (const QString &filename)
     ui->resetSelectionButton->setDisabled(true);
     _filename = filename;
 
-    QAudioFormat desiredFormat;
-    desiredFormat.setChannelCount(2);
-    desiredFormat.setCodec("audio/x-raw");
-    desiredFormat.setSampleType(QAudioFormat::UnSignedInt);
-    desiredFormat.setSampleRate(48000);
-    desiredFormat.setSampleSize(16);
-
-    _decoder->setAudioFormat(desiredFormat);
-    _decoder->setSourceFilename(filename);
     _waveform->reset();
     _loading = true;
-    _decoder->start();
+    _loader->Load(filename);
 }
 
 
-void SoundSelectionDialog::readBuffer ()
+void SoundSelectionDialog::peaksLoaded (const QString &filename, PeakPyramidPointer peaks)
 {
-    if (!_loading) {
-        qDebug() << "What am I doing here?";
+    if (!_loading || filename != _filename) {
+        // Left over from a file that is no longer wanted
+        return;
+    }
+    _waveform->setDuration(peaks->GetDurationMillis());
+    _waveform->setPeaks(peaks);
+    readFinished();
+}
+
+void SoundSelectionDialog::peaksFailed (const QString &filename, const QString &message)
+{
+    if (!_loading || filename != _filename) {
+        return;
     }
-    QAudioBuffer buffer = _decoder->read();
-    _waveform->setDuration(_decoder->duration());
-    _waveform->addBuffer(buffer);
+    _loading = false;
+    QMessageBox::warning(this, tr("Could not load the sound"),
+                         tr("%1 could not be read: %2").arg(QFileInfo(filename).fileName(), message));
+    ui->buttonBox->setDisabled(false);
+    ui->chooseMusicFileButton->setDisabled(false);
 }
 
 void SoundSelectionDialog::readFinished ()
 {
     _loading = false;
     Settings settings;
-    _waveform->setDuration(_decoder->duration());
     if (_sfx) {
-        _waveform->setSelectionStart (int(_sfx.getInPoint()*1000));
-        _waveform->setSelectionLength (int((_sfx.getOutPoint())-_sfx.getInPoint()*1000));
+        _waveform->setSelectionStart (qRound64(_sfx.getInPoint()*1000));
+        _waveform->setSelectionLength (qRound64((_sfx.getOutPoint()-_sfx.getInPoint())*1000));
 
         double logVolume = QAudio::convertVolume(_sfx.getVolume()/qreal(100.0),
                                                  QAudio::LinearVolumeScale,
@@ -4,12 +4,12 @@
 #include <QDialog>
 #include <QFileDialog>
 #include <QString>
-#include <QAudioDecoder>
 #include <QGraphicsScene>
 #include <QMediaPlayer>
 
 #include "soundeffect.h"
 #include "waveform.h"
+#include "waveformloader.h"
 
 namespace Ui {
 class SoundSelectionDialog;
@@ -47,7 +47,8 @@ private slots:
     void fileDialogAccepted();
     void fileDialogRejected();
     void on_playPauseButton_clicked();
-    void readBuffer ();
+    void peaksLoaded (const QString &filename, PeakPyramidPointer peaks);
+    void peaksFailed (const QString &filename, const QString &message);
     void readFinished ();
     void playerPositionChanged (qint64 newPosition);
     void playerStateChanged (QMediaPlayer::State state);
@@ -69,7 +70,7 @@ private:
     QFileDialog *_fileDialog;
     Mode _mode;
     QString _filename;
-    QAudioDecoder *_decoder;
+    WaveformLoader *_loader;
     QMediaPlayer *_player;
     Waveform *_waveform;
     SoundEffect _sfx;
@@ -0,0 +1,110 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief The SpscQueue class is a fixed-size ring buffer for passing items from exactly one
+ * producer thread to exactly one consumer thread without locking. The producer only writes the
+ * tail and the consumer only writes the head, so neither ever waits for the other: a full queue
+ * just makes TryPush() return false.
+ *
+ * The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue (size_t capacity) :
+        _head (0),
+        _tail (0)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        _items.resize(size);
+        _mask = size - 1;
+    }
+
+    SpscQueue (const SpscQueue &) = delete;
+    SpscQueue &operator= (const SpscQueue &) = delete;
+
+    /**
+     * @brief TryPush adds an item at the back, or returns false if the queue is full. Producer only.
+     */
+    bool TryPush (T item)
+    {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) > _mask) {
+            return false;
+        }
+        _items[tail & _mask] = std::move(item);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Front returns the item at the front without removing it, or nullptr if the queue is
+     * empty. Consumer only.
+     */
+    T *Front ()
+    {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &_items[head & _mask];
+    }
+
+    /**
+     * @brief Pop removes the item at the front, which must exist. Consumer only.
+     */
+    void Pop ()
+    {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        _items[head & _mask] = T();
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief TryPop moves the item at the front into item, or returns false if the queue is empty.
+     * Consumer only.
+     */
+    bool TryPop (T &item)
+    {
+        T *front = Front();
+        if (!front) {
+            return false;
+        }
+        item = std::move(*front);
+        Pop();
+        return true;
+    }
+
+    size_t Capacity () const
+    {
+        return _mask + 1;
+    }
+
+    /**
+     * @brief Size is exact from either end's own thread, and a snapshot from anywhere else.
+     */
+    size_t Size () const
+    {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> _items;
+    size_t _mask;
+
+    // Each index is written by one thread only; keep them off each other's cache line
+    alignas(64) std::atomic<size_t> _head;
+    alignas(64) std::atomic<size_t> _tail;
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,160 @@
+#include "startuptimer.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+
+#include <cstring>
+
+namespace {
+    const char *TRACE_ENVIRONMENT_VARIABLE = "PLS_STARTUP_TRACE";
+    const char *TRACE_OPTION = "--startup-trace";
+
+    struct Trace {
+        QMutex mutex;
+        QString filename;
+        QJsonArray events;
+        QMap<QString, qint64> openPhases;
+    };
+
+    Trace &GetTrace ()
+    {
+        static Trace trace;
+        return trace;
+    }
+}
+
+QElapsedTimer &StartupTimer::Clock ()
+{
+    static QElapsedTimer clock;
+    return clock;
+}
+
+void StartupTimer::Start (int argc, char *argv[])
+{
+    Clock().start();
+
+    // This runs before the QApplication exists, so the arguments are read by hand
+    Trace &trace = GetTrace();
+    trace.filename = QString::fromLocal8Bit(qgetenv(TRACE_ENVIRONMENT_VARIABLE));
+    for (int arg = 1; arg < argc; ++arg) {
+        QString argument = QString::fromLocal8Bit(argv[arg]);
+        if (argument == TRACE_OPTION && arg + 1 < argc) {
+            trace.filename = QString::fromLocal8Bit(argv[arg + 1]);
+        } else if (argument.startsWith(QString(TRACE_OPTION) + "=")) {
+            trace.filename = argument.mid(int(strlen(TRACE_OPTION)) + 1);
+        }
+    }
+    if (IsTracing()) {
+        qDebug() << "Startup: tracing to" << trace.filename;
+    }
+}
+
+bool StartupTimer::IsTracing ()
+{
+    return !GetTrace().filename.isEmpty();
+}
+
+void StartupTimer::Mark (const QString &event)
+{
+    qDebug() << "Startup:" << event << "at" << Elapsed() << "ms";
+    Record(event, 'i', Microseconds());
+}
+
+void StartupTimer::Begin (const QString &name)
+{
+    qDebug() << "Startup:" << name << "started at" << Elapsed() << "ms";
+    if (IsTracing()) {
+        Trace &trace = GetTrace();
+        QMutexLocker lock (&trace.mutex);
+        trace.openPhases[name] = Microseconds();
+    }
+}
+
+void StartupTimer::End (const QString &name)
+{
+    qint64 start = -1;
+    if (IsTracing()) {
+        Trace &trace = GetTrace();
+        QMutexLocker lock (&trace.mutex);
+        if (trace.openPhases.contains(name)) {
+            start = trace.openPhases.take(name);
+        }
+    }
+    qDebug() << "Startup:" << name << "ended at" << Elapsed() << "ms";
+    if (start >= 0) {
+        Record(name, 'X', start, Microseconds() - start);
+    }
+}
+
+qint64 StartupTimer::Elapsed ()
+{
+    return Clock().isValid() ? Clock().elapsed() : 0;
+}
+
+qint64 StartupTimer::Microseconds ()
+{
+    return Clock().isValid() ? Clock().nsecsElapsed() / 1000 : 0;
+}
+
+void StartupTimer::Record (const QString &name, char phase, qint64 start, qint64 duration)
+{
+    if (!IsTracing()) {
+        return;
+    }
+    QJsonObject event;
+    event["name"] = name;
+    event["cat"] = "startup";
+    event["ph"] = QString(QLatin1Char(phase));
+    event["ts"] = double(start);
+    if (phase == 'X') {
+        event["dur"] = double(duration);
+    } else {
+        event["s"] = "g"; // Instant events are drawn across the whole timeline
+    }
+    event["pid"] = double(QCoreApplication::applicationPid());
+    event["tid"] = double(quintptr(QThread::currentThreadId()));
+
+    Trace &trace = GetTrace();
+    QMutexLocker lock (&trace.mutex);
+    trace.events.append(event);
+}
+
+void StartupTimer::Save ()
+{
+    if (!IsTracing()) {
+        return;
+    }
+    Trace &trace = GetTrace();
+    QJsonObject json;
+    {
+        QMutexLocker lock (&trace.mutex);
+        json["traceEvents"] = trace.events;
+    }
+    json["displayTimeUnit"] = "ms";
+
+    QSaveFile file (trace.filename);
+    QByteArray data = QJsonDocument(json).toJson();
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qDebug() << "Could not save the startup trace" << trace.filename << ":" << file.errorString();
+    }
+}
+
+StartupTimer::Phase::Phase (const QString &name) :
+    _name (name),
+    _start (StartupTimer::Microseconds())
+{
+}
+
+StartupTimer::Phase::~Phase ()
+{
+    qint64 duration = StartupTimer::Microseconds() - _start;
+    qDebug() << "Startup:" << _name << "took" << duration / 1000 << "ms, done at" << StartupTimer::Elapsed() << "ms";
+    StartupTimer::Record(_name, 'X', _start, duration);
+}
@@ -0,0 +1,68 @@
+#ifndef STARTUPTIMER_H
+#define STARTUPTIMER_H
+
+#include <QElapsedTimer>
+#include <QString>
+
+/**
+ * @brief The StartupTimer class logs how long each phase of starting the program takes, measured
+ * from when the program started, so it's clear where the wait for a usable viewfinder goes.
+ *
+ * If tracing is enabled (see Start()) the events are also recorded, and Save() writes them as a
+ * Chrome trace-event JSON file that can be opened in chrome://tracing or https://ui.perfetto.dev.
+ */
+class StartupTimer
+{
+public:
+    /**
+     * @brief Start starts the clock. Call it first thing in main(). Tracing is enabled if the
+     * PLS_STARTUP_TRACE environment variable or the --startup-trace option names a file to write.
+     */
+    static void Start (int argc, char *argv[]);
+
+    static bool IsTracing ();
+
+    /**
+     * @brief Mark logs that something happened just now.
+     */
+    static void Mark (const QString &event);
+
+    /**
+     * @brief Begin and End log a phase that starts in one place and ends in another, e.g. a wait
+     * for a signal or a timer. Phases with the same name must not overlap.
+     */
+    static void Begin (const QString &name);
+    static void End (const QString &name);
+
+    /**
+     * @brief Elapsed returns the milliseconds since Start() was called.
+     */
+    static qint64 Elapsed ();
+
+    /**
+     * @brief Save writes the trace recorded so far, if tracing is enabled. It can be called more
+     * than once: each call rewrites the whole file.
+     */
+    static void Save ();
+
+    /**
+     * @brief The Phase class logs the time until it goes out of scope as one phase of startup.
+     */
+    class Phase
+    {
+    public:
+        explicit Phase (const QString &name);
+        ~Phase ();
+
+    private:
+        QString _name;
+        qint64 _start;
+    };
+
+private:
+    static QElapsedTimer &Clock ();
+    static qint64 Microseconds ();
+    static void Record (const QString &name, char phase, qint64 start, qint64 duration = 0);
+};
+
+#endif // STARTUPTIMER_H
@@ -4,12 +4,14 @@
 #include <QDateTime>
 #include <QtMultimedia/QCameraInfo>
 #include <QKeyEvent>
+#include <QMetaEnum>
 #include <QFileDialog>
 #include <QDesktopServices>
 #include <QMessageBox>
 #include "settings.h"
 #include "version.h"
 #include "importprogressdialog.h"
+#include "startuptimer.h"
 
 #include <memory>
 
@@ -18,43 +20,39 @@ StopMotionAnimation::StopMotionAnimation(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::StopMotionAnimation),
     _camera(nullptr),
-    _videoItem(nullptr),
-    _graphicsView(nullptr),
-    _graphicsScene(nullptr),
+    _viewfinder(nullptr),
     _cameraMonitor(nullptr),
     _keydownState(KeydownState::NONE),
-    _backgroundMusic(SoundSelectionDialog::Mode::BACKGROUND_MUSIC, this),
-    _soundEffects(SoundSelectionDialog::Mode::SOUND_EFFECT, this)
+    _startupFinished(false),
+    _cameraAddedRetries(0)
 {
+    StartupTimer::Phase phase ("Main window");
     ui->setupUi(this);
 
     this->setWindowTitle(QCoreApplication::applicationName() + " -- v" + APP_VERSION + "-" + APP_REVISION);
-    connect (&this->_saveFinalMovie, &SaveFinalMovieDialog::accepted, this, &StopMotionAnimation::saveFinalMovieAccepted);
     Settings settings;
     int w = settings.Get("settings/imageWidth").toInt();
     int h = settings.Get("settings/imageHeight").toInt();
     QSize resolution (w,h);
 
-    _videoItem = new QGraphicsVideoItem;
-    _videoItem->setSize(QSize{w,h});
-    _graphicsScene = new QGraphicsScene (this);
-    _graphicsView = new QGraphicsView (_graphicsScene);
-    _graphicsView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    _graphicsView->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    _graphicsScene->addItem(_videoItem);
-    connect (_videoItem, &QGraphicsVideoItem::nativeSizeChanged, this, &StopMotionAnimation::frameSizeChanged);
-
-    ui->videoRegionLayout->insertWidget(2,_graphicsView);
-    _graphicsView->hide();
-    _videoItem->show();
-
-    _overlayEffect = new PreviousFrameOverlayEffect();
-    _videoItem->setGraphicsEffect(_overlayEffect);
-    _overlayEffect->setEnabled(false);
-
+    _viewfinder = new ViewfinderWidget (this);
+    _viewfinder->setMinimumSize(resolution);
+    _viewfinder->setMaximumSize(resolution);
+    ui->videoRegionLayout->insertWidget(2,_viewfinder);
+    _viewfinder->hide();
+    connect (_viewfinder, &ViewfinderWidget::firstFrame, this, &StopMotionAnimation::viewfinderFirstFrame);
+
+    // If the camera never gets a frame to the viewfinder (which shouldn't happen), give up waiting
+    // for one after a while and use it anyway: a still image may work even so.
+    _cameraReadyTimer.setSingleShot(true);
+    _cameraReadyTimer.setInterval(CAMERA_READY_TIMEOUT_MS);
+    connect (&_cameraReadyTimer, &QTimer::timeout, this, &StopMotionAnimation::setUpActiveCamera);
+    _cameraAddedTimer.setSingleShot(true);
+    _cameraAddedTimer.setInterval(CAMERA_ADDED_RETRY_MS);
+    connect (&_cameraAddedTimer, &QTimer::timeout, this, &StopMotionAnimation::pickUpAddedCamera);
+
+    // At startup the splash screen says we're loading, this is for when a new movie is started
     _loadingMessage = std::unique_ptr<QMessageBox>(new QMessageBox(QMessageBox::Information, "Loading", "Connecting to your camera, just a moment...", QMessageBox::Ok));
-    _loadingMessage->show();
-    QApplication::processEvents();
 
     startNewMovie();
     adjustSize();
@@ -62,7 +60,7 @@ StopMotionAnimation::StopMotionAnimation(QWidget *parent) :
     // Grab the x, z, and spacebar keys from everything that might conceivably get them:
     ui->addToPreviousButton->installEventFilter(this);
     ui->backgroundMusicButton->installEventFilter(this);
-    _videoItem->installEventFilter(this);
+    _viewfinder->installEventFilter(this);
     ui->createFinalMovieButton->installEventFilter(this);
     ui->deletePhotoButton->installEventFilter(this);
     ui->helpButton->installEventFilter(this);
@@ -75,21 +73,7 @@ StopMotionAnimation::StopMotionAnimation(QWidget *parent) :
     ui->takePhotoButton->installEventFilter(this);
     ui->soundEffectNumberLabel->installEventFilter(this);
 
-    connect (&_backgroundMusic, &SoundSelectionDialog::accepted, this, &StopMotionAnimation::setBackgroundMusic);
-    connect (&_soundEffects, &SoundSelectionDialog::accepted, this, &StopMotionAnimation::setSoundEffect);
-    connect (&_addToPrevious, &AddToPreviousMovieDialog::accepted, this, &StopMotionAnimation::addToPrevious);
-
-    // The SFX list dialog works a bit like a "remote control" for the main interface, all its main functions are really implemented here
-    connect (&_sfxListDialog, &SoundEffectListDialog::selected, this, &StopMotionAnimation::soundEffectListSelected);
-    connect (&_sfxListDialog, &SoundEffectListDialog::edit, this, &StopMotionAnimation::soundEffectListEdit);
-    connect (&_sfxListDialog, &SoundEffectListDialog::remove, this, &StopMotionAnimation::soundEffectListRemove);
-    connect (&_sfxListDialog, &SoundEffectListDialog::play, this, &StopMotionAnimation::soundEffectListPlay);
-
-    // Remove the Help icon menu from the Help dialog
-    Qt::WindowFlags flags = _help.windowFlags();
-    Qt::WindowFlags helpFlag = Qt::WindowContextHelpButtonHint;
-    flags = flags & (~helpFlag);
-    _help.setWindowFlags(flags);
+    connect (&_timeLapseTimer, &QTimer::timeout, this, &StopMotionAnimation::timeLapseTimeout);
 }
 
 StopMotionAnimation::~StopMotionAnimation()
@@ -97,15 +81,103 @@ StopMotionAnimation::~StopMotionAnimation()
     if (_movie) {
         _movie->save();
     }
-    if (_camera) {
-        delete _camera;
+    stopCamera();
+    stopCameraMonitor();
+    delete ui;
+}
+
+bool StopMotionAnimation::hasFinishedStartup () const
+{
+    return _startupFinished;
+}
+
+void StopMotionAnimation::finishStartup ()
+{
+    if (!_startupFinished) {
+        _startupFinished = true;
+        StartupTimer::Mark("Startup finished");
+        emit startupFinished();
     }
-    if (_cameraMonitor) {
-        _cameraMonitor->requestInterruption();
-        _cameraMonitor->wait(1000);
+}
+
+HelpDialog &StopMotionAnimation::helpDialog ()
+{
+    if (!_help) {
+        StartupTimer::Phase phase ("Help dialog");
+        _help = std::unique_ptr<HelpDialog> (new HelpDialog);
+
+        // Remove the Help icon menu from the Help dialog
+        Qt::WindowFlags flags = _help->windowFlags();
+        Qt::WindowFlags helpFlag = Qt::WindowContextHelpButtonHint;
+        flags = flags & (~helpFlag);
+        _help->setWindowFlags(flags);
     }
-    delete _overlayEffect;
-    delete ui;
+    return *_help;
+}
+
+SettingsDialog &StopMotionAnimation::settingsDialog ()
+{
+    if (!_settings) {
+        StartupTimer::Phase phase ("Settings dialog");
+        _settings = std::unique_ptr<SettingsDialog> (new SettingsDialog);
+    }
+    return *_settings;
+}
+
+SoundSelectionDialog &StopMotionAnimation::backgroundMusicDialog ()
+{
+    if (!_backgroundMusic) {
+        StartupTimer::Phase phase ("Background music dialog");
+        _backgroundMusic = std::unique_ptr<SoundSelectionDialog> (new SoundSelectionDialog (SoundSelectionDialog::Mode::BACKGROUND_MUSIC, this));
+        connect (_backgroundMusic.get(), &SoundSelectionDialog::accepted, this, &StopMotionAnimation::setBackgroundMusic);
+    }
+    return *_backgroundMusic;
+}
+
+SoundSelectionDialog &StopMotionAnimation::soundEffectsDialog ()
+{
+    if (!_soundEffects) {
+        StartupTimer::Phase phase ("Sound effect dialog");
+        _soundEffects = std::unique_ptr<SoundSelectionDialog> (new SoundSelectionDialog (SoundSelectionDialog::Mode::SOUND_EFFECT, this));
+        connect (_soundEffects.get(), &SoundSelectionDialog::accepted, this, &StopMotionAnimation::setSoundEffect);
+    }
+    return *_soundEffects;
+}
+
+SaveFinalMovieDialog &StopMotionAnimation::saveFinalMovieDialog ()
+{
+    if (!_saveFinalMovie) {
+        StartupTimer::Phase phase ("Save final movie dialog");
+        _saveFinalMovie = std::unique_ptr<SaveFinalMovieDialog> (new SaveFinalMovieDialog);
+        connect (_saveFinalMovie.get(), &SaveFinalMovieDialog::accepted, this, &StopMotionAnimation::saveFinalMovieAccepted);
+    }
+    return *_saveFinalMovie;
+}
+
+AddToPreviousMovieDialog &StopMotionAnimation::addToPreviousDialog ()
+{
+    if (!_addToPrevious) {
+        StartupTimer::Phase phase ("Add to previous movie dialog");
+        _addToPrevious = std::unique_ptr<AddToPreviousMovieDialog> (new AddToPreviousMovieDialog);
+        connect (_addToPrevious.get(), &AddToPreviousMovieDialog::accepted, this, &StopMotionAnimation::addToPrevious);
+    }
+    return *_addToPrevious;
+}
+
+SoundEffectListDialog &StopMotionAnimation::soundEffectListDialog ()
+{
+    if (!_sfxListDialog) {
+        StartupTimer::Phase phase ("Sound effect list dialog");
+        _sfxListDialog = std::unique_ptr<SoundEffectListDialog> (new SoundEffectListDialog);
+
+        // The SFX list dialog works a bit like a "remote control" for the main interface, all its main functions are really implemented here
+        connect (_sfxListDialog.get(), &SoundEffectListDialog::selected, this, &StopMotionAnimation::soundEffectListSelected);
+        connect (_sfxListDialog.get(), &SoundEffectListDialog::edit, this, &StopMotionAnimation::soundEffectListEdit);
+        connect (_sfxListDialog.get(), &SoundEffectListDialog::remove, this, &StopMotionAnimation::soundEffectListRemove);
+        connect (_sfxListDialog.get(), &SoundEffectListDialog::play, this, &StopMotionAnimation::soundEffectListPlay);
+        connect (_sfxListDialog.get(), &SoundEffectListDialog::frameSelected, this, &StopMotionAnimation::soundEffectListFrameSelected);
+    }
+    return *_sfxListDialog;
 }
 
 void StopMotionAnimation::on_startNewMovieButton_clicked()
@@ -117,6 +189,8 @@ void StopMotionAnimation::on_startNewMovieButton_clicked()
 
 void StopMotionAnimation::startNewMovie ()
 {
+    StartupTimer::Phase phase ("Start new movie");
+
     // Generate a new timestamp
     QDateTime local(QDateTime::currentDateTime());
     Settings settings;
@@ -137,63 +211,80 @@ void StopMotionAnimation::startNewMovie ()
     if (_movie) {
         _movie->save();
     }
-    if (_camera) {
-        delete _camera;
-        _camera = nullptr;
-    }
-    if (_cameraMonitor) {
-        _cameraMonitor->requestInterruption();
-        _cameraMonitor->wait(1000);
-        delete _cameraMonitor;
-        _cameraMonitor = nullptr;
-    }
+    stopCameraMonitor();
     _movie = std::unique_ptr<Movie> (new Movie (timestamp));
     connect (_movie.get(), &Movie::frameChanged,
              this, &StopMotionAnimation::movieFrameChanged);
+    connect (_movie.get(), &Movie::frameFileSaved,
+             this, &StopMotionAnimation::movieFrameFileSaved);
+    connect (_movie.get(), &Movie::captureFailed,
+             this, &StopMotionAnimation::movieCaptureFailed);
 
-    auto cameras = QCameraInfo::availableCameras();
-    auto requestedCamera = settings.Get("settings/camera").toString();
     auto w = settings.Get("settings/imageWidth").toInt();
     auto h = settings.Get("settings/imageHeight").toInt();
     ui->videoLabel->setBaseSize(w,h);
     ui->videoLabel->setMinimumSize(w,h);
-    ui->videoLabel->setMaximumSize(w,h);    
-    _videoItem->setSize(QSize{w,h});
+    ui->videoLabel->setMaximumSize(w,h);
+    _viewfinder->setMinimumSize(w,h);
+    _viewfinder->setMaximumSize(w,h);
+
+    startCamera();
+
+    updateInterfaceForNewFrame();
+    adjustSize();
+    updateSoundEffectLabel();
+}
 
+void StopMotionAnimation::startCamera ()
+{
+    Settings settings;
+    QList<QCameraInfo> cameras;
+    {
+        StartupTimer::Phase phase ("Camera enumeration");
+        cameras = QCameraInfo::availableCameras();
+    }
+    auto requestedCamera = settings.Get("settings/camera").toString();
     if (!cameras.empty()) {
 
-        _camera = nullptr;
+        QCameraInfo chosenCamera = cameras.back();
         for (auto camera: cameras) {
             if (camera.description() == requestedCamera) {
-                _camera = new QCamera(camera);
-                _cameraInfo = camera;
+                chosenCamera = camera;
                 break;
             }
         }
-        if (!_camera) {
-            _camera = new QCamera(cameras.back());
-            _cameraInfo = cameras.back();
+
+        if (_camera && chosenCamera == _cameraInfo && _camera->status() == QCamera::ActiveStatus) {
+            // Keep the camera running from the last movie: only the new movie needs binding to it
+            setUpActiveCamera();
+            return;
         }
+        stopCamera();
+        _camera = new QCamera(chosenCamera);
+        _cameraInfo = chosenCamera;
 
         connect (_camera, &QCamera::statusChanged, this, &StopMotionAnimation::cameraStatusChanged);
         _camera->setCaptureMode(QCamera::CaptureStillImage);
-        _camera->setViewfinder (_videoItem);
+        _camera->setViewfinder (_viewfinder->videoSurface());
+        StartupTimer::Begin("Camera start");
         _camera->start();
     } else {
         // This should display an error of some kind...
+        stopCamera();
         ui->videoLabel->setText("<big><b>ERROR:</b> No camera found. Plug in a camera and press the <kbd>Save and Start a New Movie</kbd> button.</big>");
-        _graphicsView->hide();
+        _viewfinder->hide();
         ui->videoLabel->show();
         _loadingMessage->hide();
-    }
 
-    updateInterfaceForNewFrame();
-    adjustSize();
-    updateSoundEffectLabel();
+        // Pick the camera up as soon as one is plugged in
+        startCameraMonitor(QCameraInfo());
+        finishStartup();
+    }
 }
 
 void StopMotionAnimation::cameraStatusChanged(QCamera::Status status)
 {
+    StartupTimer::Mark(QString("Camera status: ") + QMetaEnum::fromType<QCamera::Status>().valueToKey(status));
     switch(status) {
         case QCamera::UnavailableStatus: [[fallthrough]];
         case QCamera::UnloadedStatus:    [[fallthrough]];
@@ -206,59 +297,111 @@ void StopMotionAnimation::cameraStatusChanged(QCamera::Status status)
             qDebug() << "Camera status changed to " << status;
             break;
         case QCamera::ActiveStatus:
-            // "Active" seems to be relative, it works better if we give it another second
-            // to become even more active.
-            QTimer::singleShot(1000, this, &StopMotionAnimation::setUpActiveCamera);
+            StartupTimer::End("Camera start");
+            // "Active" seems to be relative: the camera is only really ready once it is
+            // delivering frames, so wait for the first one to reach the viewfinder.
+            if (_viewfinder->hasFrame()) {
+                setUpActiveCamera();
+            } else {
+                StartupTimer::Begin("Waiting for the first frame");
+                _cameraReadyTimer.start();
+            }
             break;
     }
 }
 
-void StopMotionAnimation::setUpActiveCamera()
+void StopMotionAnimation::viewfinderFirstFrame()
 {
-    if (_cameraMonitor) {
-        delete _cameraMonitor;
-        _cameraMonitor = nullptr;
+    if (_cameraReadyTimer.isActive()) {
+        _cameraReadyTimer.stop();
+        setUpActiveCamera();
     }
-    _cameraMonitor = new CameraMonitor (this, _cameraInfo);
-    connect (_cameraMonitor, &CameraMonitor::cameraLost, this, &StopMotionAnimation::cameraLost);
-    connect (_cameraMonitor, &CameraMonitor::finished, _cameraMonitor, &QObject::deleteLater);
-    _videoItem->show();
-    _graphicsView->show();
-    _cameraMonitor->start();
+}
+
+void StopMotionAnimation::setUpActiveCamera()
+{
+    StartupTimer::End("Waiting for the first frame");
+    startCameraMonitor(_cameraInfo);
+    _viewfinder->show();
     setState (State::LIVE);
     _loadingMessage->hide();
     _movie->setCamera(_camera);
-    _graphicsView->fitInView(_videoItem);
+    finishStartup();
 }
 
-void StopMotionAnimation::cameraLost ()
+void StopMotionAnimation::stopCamera ()
 {
+    _cameraReadyTimer.stop();
+    _cameraAddedTimer.stop();
     if (_camera) {
+        if (_movie) {
+            _movie->setCamera(nullptr);
+        }
         delete _camera;
         _camera = nullptr;
+    }
+}
+
+void StopMotionAnimation::cameraLost ()
+{
+    if (_camera) {
+        stopCamera();
         ui->videoLabel->setText("<big><b>ERROR:</b> Camera disconnected. Plug in a camera and press the <kbd>Save and Start a New Movie</kbd> button.</big>");
         setState (State::LIVE);
         updateInterfaceForNewFrame();
     }
-    _cameraMonitor->requestInterruption();
-    _cameraMonitor->wait(1000);
-    delete _cameraMonitor;
-    _cameraMonitor = nullptr;
+    startCameraMonitor(QCameraInfo());
+}
+
+void StopMotionAnimation::cameraAdded (const QString &deviceName)
+{
+    qDebug() << "Camera added:" << deviceName;
+    _cameraAddedRetries = 0;
+    pickUpAddedCamera();
+}
+
+void StopMotionAnimation::pickUpAddedCamera ()
+{
+    if (_camera) {
+        return;
+    }
+    // The device node shows up before the camera is listed. Starting now would find no camera and
+    // restart the monitor, which would then count the new node as already there and never report it.
+    if (QCameraInfo::availableCameras().isEmpty() && _cameraAddedRetries < CAMERA_ADDED_RETRIES) {
+        _cameraAddedRetries++;
+        _cameraAddedTimer.start();
+        return;
+    }
+    startCamera();
 }
 
-void StopMotionAnimation::frameSizeChanged(const QSizeF &size)
+void StopMotionAnimation::startCameraMonitor (const QCameraInfo &camera)
 {
-    _graphicsView->fitInView(QRectF(1,1,size.width(),size.height()));
+    stopCameraMonitor();
+    _cameraMonitor = new CameraMonitor (this, camera);
+    connect (_cameraMonitor, &CameraMonitor::cameraLost, this, &StopMotionAnimation::cameraLost);
+    connect (_cameraMonitor, &CameraMonitor::cameraAdded, this, &StopMotionAnimation::cameraAdded);
+    _cameraMonitor->start();
+}
+
+void StopMotionAnimation::stopCameraMonitor ()
+{
+    if (_cameraMonitor) {
+        _cameraMonitor->Stop();
+        _cameraMonitor->wait();
+        delete _cameraMonitor;
+        _cameraMonitor = nullptr;
+    }
 }
 
 void StopMotionAnimation::on_addToPreviousButton_clicked()
 {
-    _addToPrevious.show();
+    addToPreviousDialog().show();
 }
 
 void StopMotionAnimation::addToPrevious ()
 {
-    QString fileName = _addToPrevious.getSelectedMovie();
+    QString fileName = addToPreviousDialog().getSelectedMovie();
     if (fileName.length() > 0) {
         // See if we can read it first:
         QFileInfo f (fileName);
@@ -277,26 +420,21 @@ void StopMotionAnimation::addToPrevious ()
             _movie->setStillFrame (0, ui->videoLabel);
             updateSoundEffectLabel();
         }
-        try {
-            _overlayEffect->setPreviousFrame(_movie->getMostRecentFrame());
-        } catch (PreviousFrameOverlayEffect::LoadFailedException &e) {
-            //_errorDialog.showMessage("Failed to load the previous frame into the overlay layer.");
-            _errorDialog.showMessage(e.message());
-        }
+        _viewfinder->setPreviousFrame(_movie->getMostRecentFrame());
     }
 }
 
 void StopMotionAnimation::on_createFinalMovieButton_clicked()
 {
-    _saveFinalMovie.reset(_movie->getEncodingFilename(), _movie->getEncodingTitle(), _movie->getEncodingCredits());
-    _saveFinalMovie.show();
+    saveFinalMovieDialog().reset(_movie->getEncodingFilename(), _movie->getEncodingTitle(), _movie->getEncodingCredits());
+    saveFinalMovieDialog().show();
 }
 
 void StopMotionAnimation::saveFinalMovieAccepted()
 {
-    QString filename = _saveFinalMovie.filename();
-    QString title = _saveFinalMovie.movieTitle();
-    QString credits = _saveFinalMovie.credits();
+    QString filename = saveFinalMovieDialog().filename();
+    QString title = saveFinalMovieDialog().movieTitle();
+    QString credits = saveFinalMovieDialog().credits();
     try {
         std::unique_ptr<QMessageBox> message (new QMessageBox(QMessageBox::Information, "Encoding", "Creating your movie, just a moment...", QMessageBox::NoButton));
         message->show();
@@ -331,12 +469,7 @@ void StopMotionAnimation::on_importButton_clicked()
             return;
         }
     }
-    try {
-        _overlayEffect->setPreviousFrame(_movie->getMostRecentFrame());
-    } catch (PreviousFrameOverlayEffect::LoadFailedException &e) {
-        //_errorDialog.showMessage("Failed to load the previous frame into the overlay layer.");
-        _errorDialog.showMessage(e.message());
-    }
+    _viewfinder->setPreviousFrame(_movie->getMostRecentFrame());
     updateInterfaceForNewFrame();
 }
 
@@ -350,68 +483,120 @@ void StopMotionAnimation::on_settingButton_clicked()
     if (ret == QMessageBox::No) {
         return;
     }
-    _settings.load();
-    auto result = _settings.exec();
+    settingsDialog().load();
+    auto result = settingsDialog().exec();
     if (result == QDialog::Accepted) {
-        _settings.store();
+        settingsDialog().store();
         on_startNewMovieButton_clicked();
     }
 }
 
 void StopMotionAnimation::on_helpButton_clicked()
 {
-    _help.show();
+    helpDialog().show();
 }
 
 void StopMotionAnimation::on_takePhotoButton_clicked()
+{
+    takePhoto (Movie::CaptureSource::STILL_IMAGE);
+}
+
+void StopMotionAnimation::on_timeLapseCheckbox_toggled(bool checked)
+{
+    if (checked) {
+        Settings settings;
+        double interval = settings.Get("settings/timeLapseInterval").toDouble();
+        _timeLapseTimer.start(qMax(1, qRound(interval * 1000)));
+    } else {
+        _timeLapseTimer.stop();
+    }
+}
+
+void StopMotionAnimation::timeLapseTimeout()
+{
+    // Timed shots come from the viewfinder stream, so one can never be skipped for the camera
+    // still being busy with the last
+    takePhoto (Movie::CaptureSource::VIEWFINDER);
+}
+
+void StopMotionAnimation::takePhoto(Movie::CaptureSource source)
 {
     // Store the frame
     if (_state == State::LIVE && _camera) {
 
         // Get the frame out of the camera:
-        _movie->addFrame (ui->rotate180Checkbox->isChecked());
-
-        // Update the overlay effect:
         try {
-            _overlayEffect->setPreviousFrame(_movie->getMostRecentFrame());
-        } catch (PreviousFrameOverlayEffect::LoadFailedException &e) {
-            _errorDialog.showMessage("Failed to load the previous frame into the overlay layer.");
+            _movie->addFrame (ui->rotate180Checkbox->isChecked(), source);
+        } catch (Movie::CaptureFailedException &e) {
             _errorDialog.showMessage(e.message());
+            return;
         }
 
+        // Update the onion skin:
+        _viewfinder->setPreviousFrame(_movie->getMostRecentFrame());
+
         updateInterfaceForNewFrame();
     }
 }
 
 void StopMotionAnimation::on_deletePhotoButton_clicked()
 {
-    _movie->deleteLastFrame();
-   updateInterfaceForNewFrame();
+    if (_state == State::STILL) {
+        // Delete the frame being looked at, wherever it is in the movie
+        _movie->deleteFrame(ui->horizontalSlider->value()-1);
+    } else {
+        _movie->deleteLastFrame();
+    }
+    _viewfinder->setPreviousFrame(_movie->getMostRecentFrame());
+    updateInterfaceForNewFrame();
+    updateSoundEffectLabel();
+}
+
+void StopMotionAnimation::on_holdSpinBox_valueChanged(int holdCount)
+{
+    if (_state == State::STILL) {
+        _movie->setFrameHold(ui->horizontalSlider->value()-1, holdCount);
+        updateMovieLength();
+    }
+}
+
+void StopMotionAnimation::updateHoldSpinBox ()
+{
+    // Only a frame being looked at can be held
+    QSignalBlocker blocker (ui->holdSpinBox);
+    if (_state == State::STILL) {
+        ui->holdSpinBox->setValue(_movie->getFrameHold(ui->horizontalSlider->value()-1));
+        ui->holdSpinBox->setEnabled(true);
+    } else {
+        ui->holdSpinBox->setValue(1);
+        ui->holdSpinBox->setEnabled(false);
+    }
 }
 
 void StopMotionAnimation::on_backgroundMusicButton_clicked()
 {
     Settings settings;
     qint32 framesPerSecond = settings.Get("settings/framesPerSecond").toInt();
-    _backgroundMusic.setMovieDuration(double(_movie->getNumberOfFrames()) / double(framesPerSecond));
-    _backgroundMusic.setSound (_movie->getBackgroundMusic());
-    _backgroundMusic.show();
+    backgroundMusicDialog().setMovieDuration(double(_movie->getMovieFrame(_movie->getNumberOfFrames())) / double(framesPerSecond));
+    backgroundMusicDialog().setSound (_movie->getBackgroundMusic());
+    backgroundMusicDialog().show();
 }
 
 void StopMotionAnimation::setBackgroundMusic ()
 {
-    _movie->addBackgroundMusic (_backgroundMusic.getSelectedSound());
+    _movie->addBackgroundMusic (backgroundMusicDialog().getSelectedSound());
 }
 
 void StopMotionAnimation::setSoundEffect()
 {
-    _movie->addSoundEffect (_soundEffects.getSelectedSound());
+    _movie->addSoundEffect (soundEffectsDialog().getSelectedSound());
     ui->soundEffectButton->setText("Edit sound effect...");
     updateSoundEffectLabel();
-    if (_sfxListDialog.isVisible()) {
-        _sfxListDialog.RemoveAllSoundEffects();
-        _sfxListDialog.AddSoundEffects(_movie->getSoundEffects());
-        _sfxListDialog.activateWindow();
+    if (_sfxListDialog && _sfxListDialog->isVisible()) {
+        // Only the sound on this frame changed, so that's all the list has to update
+        int frame = ui->frameNumberLabel->text().toInt() - 1;
+        _sfxListDialog->SetSoundEffect(frame, _movie->getSoundEffect(frame));
+        _sfxListDialog->activateWindow();
     }
 }
 
@@ -423,8 +608,8 @@ void StopMotionAnimation::on_soundEffectButton_clicked()
         if (sfx && _movie->getSoundEffects().length() >= MAX_SOUND_EFFECTS) {
             _errorDialog.showMessage("Sound effect limit reached; no more effects can be added.");
         } else {
-            _soundEffects.setSound(sfx);
-            _soundEffects.show();
+            soundEffectsDialog().setSound(sfx);
+            soundEffectsDialog().show();
         }
     }
 }
@@ -442,6 +627,9 @@ void StopMotionAnimation::on_playButton_clicked()
 
 void StopMotionAnimation::movieFrameSliderValueChanged(int value)
 {
+    if (_sfxListDialog && _sfxListDialog->isVisible()) {
+        _sfxListDialog->SetCurrentFrame(value-1);
+    }
     if (value > int(_movie->getNumberOfFrames())) {
         setState (State::LIVE);
     } else {
@@ -452,6 +640,22 @@ void StopMotionAnimation::movieFrameSliderValueChanged(int value)
     }
 }
 
+void StopMotionAnimation::movieFrameFileSaved (const QString &filename)
+{
+    // The onion skin may have been asked for this frame before it was on disk
+    if (QFileInfo(filename).fileName() == QFileInfo(_movie->getMostRecentFrame()).fileName()) {
+        _viewfinder->setPreviousFrame(filename);
+    }
+}
+
+void StopMotionAnimation::movieCaptureFailed (const QString &message)
+{
+    _errorDialog.showMessage(message);
+    _viewfinder->setPreviousFrame(_movie->getMostRecentFrame());
+    updateInterfaceForNewFrame();
+    updateSoundEffectLabel();
+}
+
 void StopMotionAnimation::movieFrameChanged (int newFrame)
 {
     SoundEffect sfx;
@@ -472,6 +676,7 @@ void StopMotionAnimation::movieFrameChanged (int newFrame)
     case State::PLAYBACK:
         ui->frameNumberLabel->setText (QString::number(newFrame+1));
         ui->horizontalSlider->setValue(newFrame+1);
+        updateHoldSpinBox();
 
         break;
     }
@@ -484,11 +689,11 @@ void StopMotionAnimation::setState (State newState)
     case State::LIVE:
         if (_camera) {
             ui->videoLabel->hide();
-            _graphicsView->show();
+            _viewfinder->show();
             ui->takePhotoButton->setDefault(true);
             ui->takePhotoButton->setEnabled(true);
         } else {
-            _graphicsView->hide();
+            _viewfinder->hide();
             ui->videoLabel->show();
             ui->takePhotoButton->setDefault(false);
             ui->takePhotoButton->setEnabled(false);
@@ -501,7 +706,7 @@ void StopMotionAnimation::setState (State newState)
     case State::PLAYBACK:
         ui->frameNumberLabel->setText(QString::number(ui->horizontalSlider->value()));
         ui->playButton->setText("Stop");
-        _graphicsView->hide();
+        _viewfinder->hide();
         ui->videoLabel->show();
         ui->playButton->setDefault(true);
         ui->takePhotoButton->setEnabled(false);
@@ -510,13 +715,14 @@ void StopMotionAnimation::setState (State newState)
     case State::STILL:
         ui->frameNumberLabel->setText(QString::number(ui->horizontalSlider->value()));
         ui->playButton->setText("Play");
-        _graphicsView->hide();
+        _viewfinder->hide();
         ui->videoLabel->show();
         ui->playButton->setDefault(true);
         ui->takePhotoButton->setEnabled(false);
         ui->soundEffectButton->setEnabled(true);
         break;
     }
+    updateHoldSpinBox();
 }
 
 
@@ -527,15 +733,7 @@ void StopMotionAnimation::updateInterfaceForNewFrame()
     ui->numberOfFramesLabel->setText (QString::number(numberOfFrames));
     ui->horizontalSlider->setRange(1,numberOfFrames+1); // The +1 is because the very last "frame" is the live view
     ui->horizontalSlider->setSliderPosition(numberOfFrames+1);
-
-    Settings settings;
-    qint32 framesPerSecond = settings.Get("settings/framesPerSecond").toInt();
-    double movieLength = double(numberOfFrames) / double(framesPerSecond);
-    if (movieLength < 60) {
-        ui->movieLengthLabel->setText(QTime(0,0,0,0).addMSecs(int(movieLength*1000)).toString("s.zzz") + " seconds");
-    } else {
-        ui->movieLengthLabel->setText(QTime(0,0,0,0).addMSecs(int(movieLength*1000)).toString("m:ss.zzz"));
-    }
+    updateMovieLength();
 
     if (numberOfFrames > 0) {
         ui->playButton->setDisabled(false);
@@ -559,6 +757,19 @@ void StopMotionAnimation::updateInterfaceForNewFrame()
 
 
 
+void StopMotionAnimation::updateMovieLength ()
+{
+    // Held frames count for as many frames as they are shown for
+    Settings settings;
+    qint32 framesPerSecond = settings.Get("settings/framesPerSecond").toInt();
+    double movieLength = double(_movie->getMovieFrame(_movie->getNumberOfFrames())) / double(framesPerSecond);
+    if (movieLength < 60) {
+        ui->movieLengthLabel->setText(QTime(0,0,0,0).addMSecs(int(movieLength*1000)).toString("s.zzz") + " seconds");
+    } else {
+        ui->movieLengthLabel->setText(QTime(0,0,0,0).addMSecs(int(movieLength*1000)).toString("m:ss.zzz"));
+    }
+}
+
 void StopMotionAnimation::keyPressEvent(QKeyEvent * e)
 {
     QMainWindow::keyPressEvent(e);
@@ -613,13 +824,11 @@ bool StopMotionAnimation::eventFilter(QObject *, QEvent *event)
         }
     }
     if (_keydownState == KeydownState::OVERLAY_FRAME) {
-        _overlayEffect->setEnabled(true);
-        _overlayEffect->setMode(PreviousFrameOverlayEffect::Mode::BLEND);
+        _viewfinder->setOverlayMode(ViewfinderWidget::OverlayMode::BLEND);
     } else if (_keydownState == KeydownState::PREVIOUS_FRAME) {
-        _overlayEffect->setEnabled(true);
-        _overlayEffect->setMode(PreviousFrameOverlayEffect::Mode::PREVIOUS);
+        _viewfinder->setOverlayMode(ViewfinderWidget::OverlayMode::PREVIOUS);
     } else {
-        _overlayEffect->setEnabled(false);
+        _viewfinder->setOverlayMode(ViewfinderWidget::OverlayMode::NONE);
     }
     return handled;
 }
@@ -632,9 +841,19 @@ void StopMotionAnimation::keyReleaseEvent(QKeyEvent * e)
 
 void StopMotionAnimation::on_soundEffectNumberLabel_linkActivated(const QString &)
 {
-    _sfxListDialog.RemoveAllSoundEffects();
-    _sfxListDialog.AddSoundEffects(_movie->getSoundEffects());
-    _sfxListDialog.show();
+    Settings settings;
+    QStringList frames;
+    QVector<int> holdCounts;
+    for (int frame = 0; frame < _movie->getNumberOfFrames(); ++frame) {
+        frames.append(_movie->getImageFilename(frame));
+        holdCounts.append(_movie->getFrameHold(frame));
+    }
+    SoundEffectListDialog &sfxListDialog = soundEffectListDialog();
+    sfxListDialog.SetFrames(frames, holdCounts, settings.Get("settings/framesPerSecond").toDouble());
+    sfxListDialog.SetCurrentFrame(ui->horizontalSlider->value()-1);
+    sfxListDialog.RemoveAllSoundEffects();
+    sfxListDialog.AddSoundEffects(_movie->getSoundEffects());
+    sfxListDialog.show();
 }
 
 void StopMotionAnimation::soundEffectListSelected(const SoundEffect &sfx)
@@ -642,6 +861,11 @@ void StopMotionAnimation::soundEffectListSelected(const SoundEffect &sfx)
     ui->horizontalSlider->setValue(sfx.getStartFrame()+1);
 }
 
+void StopMotionAnimation::soundEffectListFrameSelected(int frame)
+{
+    ui->horizontalSlider->setValue(frame+1);
+}
+
 void StopMotionAnimation::soundEffectListEdit(const SoundEffect &)
 {
     on_soundEffectButton_clicked();
@@ -668,19 +892,6 @@ void StopMotionAnimation::updateSoundEffectLabel()
 
 void StopMotionAnimation::on_rotate180Checkbox_stateChanged(int)
 {
-    bool rotate = ui->rotate180Checkbox->isChecked();
-    if (rotate) {
-        _videoItem->setTransform(QTransform().rotate(180));
-        _graphicsView->fitInView(_videoItem);
-    } else {
-        _videoItem->setTransform(QTransform().rotate(0));
-        _graphicsView->fitInView(_videoItem);
-    }
-    QTransform m {_graphicsView->transform()};
-    if (m.isScaling()) {
-        // Unscale it:
-        m.scale (1.0/m.m11(), 1.0/m.m22());
-    }
-    _graphicsView->setTransform(m);
+    _viewfinder->setRotate180(ui->rotate180Checkbox->isChecked());
     ui->takePhotoButton->setFocus();
 }
@@ -5,10 +5,8 @@
 #include <QErrorMessage>
 #include <QtMultimedia/QCamera>
 #include <QtMultimedia/QCameraInfo>
-#include <QGraphicsVideoItem>
-#include <QGraphicsScene>
-#include <QGraphicsView>
 #include <QMessageBox>
+#include <QTimer>
 #include "movie.h"
 #include "soundeffect.h"
 #include "helpdialog.h"
@@ -17,7 +15,7 @@
 #include "savefinalmoviedialog.h"
 #include "addtopreviousmoviedialog.h"
 #include "soundeffectlistdialog.h"
-#include "previousframeoverlayeffect.h"
+#include "viewfinderwidget.h"
 #include "cameramonitor.h"
 
 namespace Ui {
@@ -34,6 +32,14 @@ public:
 
     void startNewMovie ();
 
+    /**
+     * @brief hasFinishedStartup returns true once the camera is live, or it's clear there isn't one.
+     */
+    bool hasFinishedStartup () const;
+
+signals:
+    void startupFinished ();
+
 private slots:
     void on_startNewMovieButton_clicked();
 
@@ -43,11 +49,15 @@ private slots:
 
     void cameraLost ();
 
+    void cameraAdded (const QString &deviceName);
+
+    void pickUpAddedCamera ();
+
     void setUpActiveCamera();
 
-    void addToPrevious ();
+    void viewfinderFirstFrame();
 
-    void frameSizeChanged (const QSizeF & size);
+    void addToPrevious ();
 
     void on_createFinalMovieButton_clicked();
 
@@ -59,8 +69,14 @@ private slots:
 
     void on_takePhotoButton_clicked();
 
+    void on_timeLapseCheckbox_toggled(bool checked);
+
+    void timeLapseTimeout();
+
     void on_deletePhotoButton_clicked();
 
+    void on_holdSpinBox_valueChanged(int holdCount);
+
     void on_backgroundMusicButton_clicked();
 
     void on_soundEffectButton_clicked();
@@ -71,6 +87,10 @@ private slots:
 
     void movieFrameChanged (int newFrame);
 
+    void movieFrameFileSaved (const QString &filename);
+
+    void movieCaptureFailed (const QString &message);
+
     void saveFinalMovieAccepted();
 
     void setBackgroundMusic();
@@ -82,6 +102,7 @@ private slots:
     void on_soundEffectNumberLabel_linkActivated(const QString &link);
 
     void soundEffectListSelected(const SoundEffect &sfx);
+    void soundEffectListFrameSelected(int frame);
 
     void soundEffectListEdit(const SoundEffect &sfx);
 
@@ -91,6 +112,10 @@ private slots:
 
     void updateSoundEffectLabel ();
 
+    void updateMovieLength ();
+
+    void updateHoldSpinBox ();
+
     void on_rotate180Checkbox_stateChanged(int arg1);
 
 private:
@@ -101,6 +126,24 @@ protected:
     enum class KeydownState {NONE, OVERLAY_FRAME, PREVIOUS_FRAME};
     void setState (State newState);
 
+    void takePhoto (Movie::CaptureSource source);
+
+    void startCamera ();
+    void stopCamera ();
+    void startCameraMonitor (const QCameraInfo &camera);
+    void stopCameraMonitor ();
+
+    void finishStartup ();
+
+    // The dialogs are only created the first time they're needed, to keep startup quick
+    HelpDialog &helpDialog ();
+    SettingsDialog &settingsDialog ();
+    SoundSelectionDialog &backgroundMusicDialog ();
+    SoundSelectionDialog &soundEffectsDialog ();
+    SaveFinalMovieDialog &saveFinalMovieDialog ();
+    AddToPreviousMovieDialog &addToPreviousDialog ();
+    SoundEffectListDialog &soundEffectListDialog ();
+
     virtual bool eventFilter (QObject *object, QEvent *event);
 
     virtual void keyPressEvent(QKeyEvent * e);
@@ -109,10 +152,11 @@ protected:
 
 private:
     static constexpr int MAX_SOUND_EFFECTS = 25;
+    static constexpr int CAMERA_READY_TIMEOUT_MS = 3000;
+    static constexpr int CAMERA_ADDED_RETRY_MS = 250;
+    static constexpr int CAMERA_ADDED_RETRIES = 20;
     QCamera *_camera;
-    QGraphicsVideoItem *_videoItem;
-    QGraphicsView *_graphicsView;
-    QGraphicsScene *_graphicsScene;
+    ViewfinderWidget *_viewfinder;
     QCameraInfo _cameraInfo;
     CameraMonitor *_cameraMonitor;
     QErrorMessage _errorDialog;
@@ -120,16 +164,20 @@ private:
     State _state;
     KeydownState _keydownState;
 
-    PreviousFrameOverlayEffect *_overlayEffect;
+    bool _startupFinished;
+    int _cameraAddedRetries;
 
-    HelpDialog _help;
-    SettingsDialog _settings;
-    SoundSelectionDialog _backgroundMusic;
-    SoundSelectionDialog _soundEffects;
-    SaveFinalMovieDialog _saveFinalMovie;
-    AddToPreviousMovieDialog _addToPrevious;
-    SoundEffectListDialog _sfxListDialog;
+    std::unique_ptr<HelpDialog> _help;
+    std::unique_ptr<SettingsDialog> _settings;
+    std::unique_ptr<SoundSelectionDialog> _backgroundMusic;
+    std::unique_ptr<SoundSelectionDialog> _soundEffects;
+    std::unique_ptr<SaveFinalMovieDialog> _saveFinalMovie;
+    std::unique_ptr<AddToPreviousMovieDialog> _addToPrevious;
+    std::unique_ptr<SoundEffectListDialog> _sfxListDialog;
     std::unique_ptr<QMessageBox> _loadingMessage;
+    QTimer _timeLapseTimer;
+    QTimer _cameraReadyTimer;
+    QTimer _cameraAddedTimer;
 
 };
 
@@ -0,0 +1,143 @@
+#include "streamcapture.h"
+#include "videoframeconverter.h"
+
+#include <QCamera>
+#include <QDebug>
+#include <QTransform>
+
+static const int MAX_QUEUED_REQUESTS = 256;
+static const int MAX_QUEUED_FRAMES = 16; // Full-size images waiting to be encoded
+
+StreamCapture::StreamCapture(QObject *parent) :
+    QThread (parent),
+    _requests (MAX_QUEUED_REQUESTS),
+    _frames (MAX_QUEUED_FRAMES),
+    _width (0),
+    _height (0),
+    _pending (0)
+{
+    // The probe emits on whatever thread the camera delivers frames on, and that's where the
+    // frames are wanted: copying them out there keeps the GUI thread out of it entirely.
+    connect (&_probe, &QVideoProbe::videoFrameProbed, this, &StreamCapture::videoFrameProbed, Qt::DirectConnection);
+    start();
+}
+
+StreamCapture::~StreamCapture()
+{
+    _probe.setSource(static_cast<QMediaObject *>(nullptr));
+    requestInterruption();
+    _framesAvailable.release();
+    wait();
+
+    // With the probe detached nothing will ever fill the requests still queued, so report them
+    // as failed while the connections are still there to hear it
+    Request request;
+    while (_requests.TryPop(request)) {
+        --_pending;
+        emit saveFailed(request.filename);
+    }
+}
+
+bool StreamCapture::SetCamera (QCamera *camera)
+{
+    return _probe.setSource(camera);
+}
+
+void StreamCapture::SetOptions (const ImageWriter::Options &options)
+{
+    QMutexLocker lock (&_optionsMutex);
+    _options = options;
+}
+
+void StreamCapture::SetResolution (const QSize &resolution)
+{
+    _width = resolution.width();
+    _height = resolution.height();
+}
+
+bool StreamCapture::Capture (const QString &filename, bool rotate180)
+{
+    Request request;
+    request.filename = filename;
+    request.rotate180 = rotate180;
+    ++_pending;
+    if (!_requests.TryPush(request)) {
+        --_pending;
+        return false;
+    }
+    return true;
+}
+
+int StreamCapture::GetPendingCount () const
+{
+    return _pending.load();
+}
+
+void StreamCapture::videoFrameProbed (const QVideoFrame &frame)
+{
+    Request *request = _requests.Front();
+    if (!request) {
+        return;
+    }
+    // Only take a frame if there is room to pass it on: otherwise the request waits for the next one
+    if (_frames.Size() >= _frames.Capacity()) {
+        return;
+    }
+    CapturedFrame captured;
+    captured.request = *request;
+    captured.image = ImageFromFrame(frame);
+    _requests.Pop();
+    _frames.TryPush(std::move(captured));
+    _framesAvailable.release();
+}
+
+void StreamCapture::run()
+{
+    while (true) {
+        _framesAvailable.acquire();
+        CapturedFrame captured;
+        if (!_frames.TryPop(captured)) {
+            if (isInterruptionRequested()) {
+                return;
+            }
+            continue;
+        }
+
+        // Everything already captured is written, even while shutting down
+        const QString &filename = captured.request.filename;
+        bool saved (false);
+        if (!captured.image.isNull()) {
+            QSize size (_width.load(), _height.load());
+            if (!size.isEmpty() && captured.image.size() != size) {
+                captured.image = captured.image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            }
+            if (captured.request.rotate180) {
+                captured.image = captured.image.transformed(QTransform().rotate(180));
+            }
+            ImageWriter::Options options;
+            {
+                QMutexLocker lock (&_optionsMutex);
+                options = _options;
+            }
+            saved = ImageWriter::Instance().WriteNow(captured.image, filename, options);
+        } else {
+            qDebug() << "Could not convert the viewfinder frame for" << filename;
+        }
+        --_pending;
+        if (saved) {
+            emit frameSaved(filename);
+        } else {
+            emit saveFailed(filename);
+        }
+    }
+}
+
+QImage StreamCapture::ImageFromFrame (const QVideoFrame &frame)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    return frame.image();
+#else
+    // Cameras mostly deliver YUV, which QVideoFrame can't turn into an image here
+    return VideoFrameConverter::ToImage(frame);
+#endif
+}
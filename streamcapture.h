@@ -0,0 +1,104 @@
+#ifndef STREAMCAPTURE_H
+#define STREAMCAPTURE_H
+
+#include <QThread>
+#include <QImage>
+#include <QMutex>
+#include <QSemaphore>
+#include <QString>
+#include <QVideoFrame>
+#include <QVideoProbe>
+
+#include <atomic>
+
+#include "imagewriter.h"
+#include "spscqueue.h"
+
+class QCamera;
+
+/**
+ * @brief The StreamCapture class captures frames straight from the camera's viewfinder stream, so
+ * unlike QCameraImageCapture it is never "not ready": every request is filled by the next frame
+ * the camera delivers, however quickly the requests arrive.
+ *
+ * Requests are queued by the GUI thread and picked up on the thread that delivers the viewfinder
+ * frames, which copies the frame out of the camera's buffer and queues it for this thread to
+ * rotate and save with the ImageWriter. Both queues are lock-free single-producer/single-consumer rings,
+ * so neither the GUI nor the camera ever waits on the encoder. If the encoder falls far enough
+ * behind to fill its queue, requests simply wait for a later frame rather than being dropped.
+ */
+class StreamCapture : public QThread
+{
+    Q_OBJECT
+
+public:
+    StreamCapture(QObject *parent = nullptr);
+
+    /**
+     * Frames already captured are written before this returns; requests still waiting for a
+     * frame are reported with saveFailed().
+     */
+    ~StreamCapture() override;
+
+    /**
+     * @brief SetCamera starts watching a camera's viewfinder. Returns false if the camera's
+     * backend can't be probed, in which case nothing can be captured from it this way.
+     */
+    bool SetCamera (QCamera *camera);
+
+    void SetOptions (const ImageWriter::Options &options);
+
+    /**
+     * @brief SetResolution scales frames to this size if the viewfinder runs at a different one,
+     * so they match the movie's still images. An empty size saves them as they come.
+     */
+    void SetResolution (const QSize &resolution);
+
+    /**
+     * @brief Capture saves the next viewfinder frame to filename. Returns false only if the
+     * request queue is full.
+     */
+    bool Capture (const QString &filename, bool rotate180);
+
+    /**
+     * @brief GetPendingCount returns how many requested frames haven't been written yet.
+     */
+    int GetPendingCount () const;
+
+    void run() Q_DECL_OVERRIDE;
+
+signals:
+
+    void frameSaved (const QString &filename);
+
+    void saveFailed (const QString &filename);
+
+private slots:
+
+    void videoFrameProbed (const QVideoFrame &frame);
+
+private:
+    struct Request {
+        QString filename;
+        bool rotate180 = false;
+    };
+
+    struct CapturedFrame {
+        Request request;
+        QImage image;
+    };
+
+    static QImage ImageFromFrame (const QVideoFrame &frame);
+
+    QVideoProbe _probe;
+    SpscQueue<Request> _requests;     // GUI thread -> viewfinder thread
+    SpscQueue<CapturedFrame> _frames; // Viewfinder thread -> this thread
+    QSemaphore _framesAvailable;
+    ImageWriter::Options _options;
+    QMutex _optionsMutex;
+    std::atomic<int> _width;
+    std::atomic<int> _height;
+    std::atomic<int> _pending;
+};
+
+#endif // STREAMCAPTURE_H
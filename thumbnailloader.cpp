@@ -0,0 +1,98 @@
+#include "thumbnailloader.h"
+
+#include <QImageReader>
+#include <QRunnable>
+
+#include <functional>
+
+namespace {
+
+class DecodeTask : public QRunnable
+{
+public:
+    DecodeTask (ThumbnailLoader *loader, const QString &filename, const QSize &size,
+                std::function<void(const QString &, const QImage &)> finished) :
+        _loader (loader),
+        _filename (filename),
+        _size (size),
+        _finished (finished)
+    {
+    }
+
+    void run() override
+    {
+        QImageReader reader (_filename);
+        QSize original = reader.size();
+        if (original.isValid()) {
+            reader.setScaledSize(original.scaled(_size, Qt::KeepAspectRatio));
+        }
+        QImage image = reader.read();
+
+        // Hand the result back on the loader's thread. If the loader is gone by then the call is
+        // simply dropped.
+        auto finished = _finished;
+        auto filename = _filename;
+        QMetaObject::invokeMethod(_loader, [finished, filename, image]() {
+            finished(filename, image);
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    ThumbnailLoader *_loader;
+    QString _filename;
+    QSize _size;
+    std::function<void(const QString &, const QImage &)> _finished;
+};
+
+}
+
+ThumbnailLoader::ThumbnailLoader(const QSize &size, int cacheKilobytes, int maxThreads, QObject *parent) :
+    QObject (parent),
+    _size (size),
+    _cache (cacheKilobytes)
+{
+    _pool.setMaxThreadCount(maxThreads);
+}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+    _pool.clear();
+    _pool.waitForDone();
+}
+
+QImage ThumbnailLoader::Get (const QString &filename)
+{
+    QImage *cached = _cache.object(filename);
+    if (cached) {
+        return *cached;
+    }
+    if (!_pending.contains(filename)) {
+        _pending.insert(filename);
+        _pool.start(new DecodeTask(this, filename, _size, [this](const QString &f, const QImage &i) {
+            DecodeFinished(f, i);
+        }));
+    }
+    return QImage();
+}
+
+void ThumbnailLoader::CancelPending ()
+{
+    _pool.clear();
+    _pending.clear();
+}
+
+QSize ThumbnailLoader::GetSize () const
+{
+    return _size;
+}
+
+void ThumbnailLoader::DecodeFinished (const QString &filename, const QImage &image)
+{
+    _pending.remove(filename);
+    if (image.isNull()) {
+        return;
+    }
+    int kilobytes = std::max(1, int(image.sizeInBytes() / 1024));
+    _cache.insert(filename, new QImage(image), kilobytes);
+    emit thumbnailReady(filename, image);
+}
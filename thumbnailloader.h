@@ -0,0 +1,53 @@
+#ifndef THUMBNAILLOADER_H
+#define THUMBNAILLOADER_H
+
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <QSet>
+#include <QSize>
+#include <QThreadPool>
+
+/**
+ * @brief The ThumbnailLoader class decodes images, scaled down to fit a fixed size, on its own
+ * thread pool, and keeps the most recently used results in a cache of bounded size. JPEGs are
+ * scaled while they are decoded, which is much cheaper than decoding them at full size.
+ *
+ * Get() never blocks: if the image isn't cached it is queued, and thumbnailReady() is emitted
+ * once it has been decoded. CancelPending() drops everything that hasn't started decoding yet.
+ */
+class ThumbnailLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    ThumbnailLoader(const QSize &size, int cacheKilobytes, int maxThreads = 2, QObject *parent = nullptr);
+    ~ThumbnailLoader() override;
+
+    /**
+     * @brief Get returns the thumbnail if it is cached, or a null image after queueing it.
+     */
+    QImage Get (const QString &filename);
+
+    /**
+     * @brief CancelPending forgets every queued request that hasn't started yet. Decodes already
+     * running still finish, and are cached.
+     */
+    void CancelPending ();
+
+    QSize GetSize () const;
+
+signals:
+
+    void thumbnailReady (const QString &filename, const QImage &image);
+
+private:
+    void DecodeFinished (const QString &filename, const QImage &image);
+
+    QSize _size;
+    QThreadPool _pool;
+    QCache<QString, QImage> _cache;
+    QSet<QString> _pending;
+};
+
+#endif // THUMBNAILLOADER_H
@@ -41,6 +41,7 @@
 #include <QAudioFormat>
 #include <QImage>
 #include "utils.h"
+#include "imagewriter.h"
 
 qint64 audioDuration(const QAudioFormat &format, qint64 bytes)
 {
@@ -143,6 +144,6 @@ void rotateImageFile(QString filename)
     QImage i (filename);
     if (!i.isNull()) {
         auto iRotated = i.transformed(QTransform().rotate(180));
-        iRotated.save(filename);
+        ImageWriter::Instance().WriteNow(iRotated, filename, ImageWriter::Options::FromSettings());
     }
 }
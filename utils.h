@@ -110,4 +110,10 @@ inline NullDebug nullDebug() { return NullDebug(); }
 #   define WAVEFORM_DEBUG nullDebug()
 #endif
 
+#ifdef LOG_ENCODER
+#   define ENCODER_DEBUG qDebug()
+#else
+#   define ENCODER_DEBUG nullDebug()
+#endif
+
 #endif // UTILS_H
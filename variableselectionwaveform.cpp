@@ -1,5 +1,6 @@
 #include "variableselectionwaveform.h"
 #include <QMouseEvent>
+#include <cmath>
 
 VariableSelectionWaveform::VariableSelectionWaveform(QWidget *parent) :
     Waveform(parent),
@@ -18,10 +19,10 @@ void VariableSelectionWaveform::reset ()
 
 void VariableSelectionWaveform::mousePressEvent(QMouseEvent *event)
 {
-    _selectionStart = event->pos().x();
-    _selectionLength = 1;
+    _dragStartX = sceneX(event);
+    _selectionStart = pixelsToMillis(_dragStartX);
+    _selectionLength = pixelsToMillis(_dragStartX + 1) - _selectionStart;
     _dragStartTime.start();
-    _dragStartX = int(_selectionStart);
     _currentlyDragging = true;
     emit (selectionRegionChanged(_selectionStart, _selectionLength));
     Waveform::mousePressEvent(event);
@@ -34,33 +35,40 @@ void VariableSelectionWaveform::mouseReleaseEvent(QMouseEvent *event)
     // Make our selection always positive...
     if (_selectionLength < 0) {
         _selectionStart += _selectionLength;
-        _selectionLength = abs(_selectionLength);
+        _selectionLength = std::abs(_selectionLength);
     }
     emit (selectionRegionChanged(_selectionStart, _selectionLength));
-    setPlayheadPosition(pixelsToMillis(int(_selectionStart)));
-    emit (playheadManuallyChanged(pixelsToMillis(int(_selectionStart))));
+    setPlayheadPosition(_selectionStart);
+    emit (playheadManuallyChanged(_selectionStart));
     Waveform::mouseReleaseEvent(event);
 }
 
 void VariableSelectionWaveform::mouseMoveEvent(QMouseEvent *event)
 {
     if (_currentlyDragging) {
-        qint64 currentX = event->pos().x();
-        _selectionLength = currentX - _dragStartX;
+        _selectionLength = pixelsToMillis(sceneX(event)) - _selectionStart;
         emit (selectionRegionChanged(_selectionStart, _selectionLength));
     }
     Waveform::mouseMoveEvent(event);
 }
 
+void VariableSelectionWaveform::layoutItems ()
+{
+    Waveform::layoutItems();
+    if (_selectionRegion) {
+        onSelectionRegionChanged(_selectionStart, _selectionLength);
+    }
+}
+
 void VariableSelectionWaveform::onSelectionRegionChanged (qint64 start, qint64 length)
 {
-    qint64 rStart, rWidth;
+    double rStart, rWidth;
     if (length >= 0) {
-        rStart = start;
-        rWidth = length;
+        rStart = millisToPixels(start);
+        rWidth = millisToPixels(length);
     } else {
-        rStart = start + length;
-        rWidth = abs(length);
+        rStart = millisToPixels(start + length);
+        rWidth = millisToPixels(std::abs(length));
     }
     QRectF r (rStart, 0, rWidth, _scene.height());
     if (_selectionRegion && _scene.items().contains(_selectionRegion)) {
@@ -76,11 +84,10 @@ void VariableSelectionWaveform::onSelectionRegionChanged (qint64 start, qint64 l
 
 qint64 VariableSelectionWaveform::getSelectionLength () const
 {
-    // If the selection is super small, assume it wasn't meant to be a selection at all
-    if (_selectionLength < 5) {
-        auto fullWidth = this->width() - _selectionStart;
-        return pixelsToMillis(fullWidth);
+    // If the selection is super small (on screen), assume it wasn't meant to be a selection at all
+    if (millisToPixels(_selectionLength) < 5) {
+        return _totalLength - _selectionStart;
     } else {
-        return pixelsToMillis(_selectionLength);
+        return _selectionLength;
     }
 }
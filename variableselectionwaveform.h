@@ -15,7 +15,7 @@ protected:
     virtual void mousePressEvent(QMouseEvent *event);
     virtual void mouseReleaseEvent(QMouseEvent *event);
     virtual void mouseMoveEvent(QMouseEvent *event);
-
+    virtual void layoutItems ();
 
 protected slots:
     void onSelectionRegionChanged (qint64 start, qint64 length);
@@ -24,7 +24,7 @@ protected slots:
 private:
     QGraphicsRectItem *_selectionRegion;
     bool _currentlyDragging;
-    qint64 _dragStartX;
+    double _dragStartX;
     QTime _dragStartTime;
 };
 
@@ -0,0 +1,157 @@
+#include "videoframeconverter.h"
+
+#include <QVector>
+
+// BT.601 studio-range YUV to RGB, in integers
+static inline QRgb YuvToRgb (int y, int u, int v)
+{
+    int c = 298 * (y - 16) + 128;
+    int d = u - 128;
+    int e = v - 128;
+    int r = (c + 409 * e) >> 8;
+    int g = (c - 100 * d - 208 * e) >> 8;
+    int b = (c + 516 * d) >> 8;
+    return qRgb(qBound(0, r, 255), qBound(0, g, 255), qBound(0, b, 255));
+}
+
+/**
+ * Fill target by sampling the nearest source pixel for each target pixel, so only the pixels that
+ * are actually shown are ever converted. rowSampler(sy) returns a function of sx for that row.
+ */
+template <typename RowSampler>
+static void Resample (QImage &target, int sourceWidth, int sourceHeight, bool flipX, bool flipY, RowSampler rowSampler)
+{
+    const int width = target.width();
+    const int height = target.height();
+    QVector<int> xs (width);
+    for (int x = 0; x < width; ++x) {
+        int sx = int(qint64(x) * sourceWidth / width);
+        xs[x] = flipX ? sourceWidth - 1 - sx : sx;
+    }
+    for (int y = 0; y < height; ++y) {
+        int sy = int(qint64(y) * sourceHeight / height);
+        auto sample = rowSampler(flipY ? sourceHeight - 1 - sy : sy);
+        QRgb *out = reinterpret_cast<QRgb *>(target.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            out[x] = sample(xs[x]);
+        }
+    }
+}
+
+QList<QVideoFrame::PixelFormat> VideoFrameConverter::GetSupportedPixelFormats ()
+{
+    return QList<QVideoFrame::PixelFormat>()
+            << QVideoFrame::Format_RGB32
+            << QVideoFrame::Format_ARGB32
+            << QVideoFrame::Format_ARGB32_Premultiplied
+            << QVideoFrame::Format_YUYV
+            << QVideoFrame::Format_UYVY
+            << QVideoFrame::Format_NV12
+            << QVideoFrame::Format_NV21
+            << QVideoFrame::Format_YUV420P
+            << QVideoFrame::Format_YV12;
+}
+
+bool VideoFrameConverter::Convert (const QVideoFrame &frame, QImage &target, bool flipX, bool flipY)
+{
+    if (target.isNull() || target.format() != QImage::Format_RGB32) {
+        return false;
+    }
+    QVideoFrame mapped (frame);
+    if (!mapped.map(QAbstractVideoBuffer::ReadOnly)) {
+        return false;
+    }
+    const int w = mapped.width();
+    const int h = mapped.height();
+    bool converted (true);
+
+    switch (mapped.pixelFormat()) {
+    case QVideoFrame::Format_RGB32:
+    case QVideoFrame::Format_ARGB32:
+    case QVideoFrame::Format_ARGB32_Premultiplied: {
+        const uchar *bits = mapped.bits();
+        const int stride = mapped.bytesPerLine();
+        Resample(target, w, h, flipX, flipY, [bits, stride](int sy) {
+            const QRgb *row = reinterpret_cast<const QRgb *>(bits + sy * stride);
+            return [row](int sx) { return row[sx] | 0xff000000; };
+        });
+        break;
+    }
+    case QVideoFrame::Format_YUYV:
+    case QVideoFrame::Format_UYVY: {
+        // Two pixels per four bytes, sharing their chroma
+        const uchar *bits = mapped.bits();
+        const int stride = mapped.bytesPerLine();
+        const bool yuyv = mapped.pixelFormat() == QVideoFrame::Format_YUYV;
+        const int yOffset = yuyv ? 0 : 1;
+        const int uOffset = yuyv ? 1 : 0;
+        const int vOffset = yuyv ? 3 : 2;
+        Resample(target, w, h, flipX, flipY, [=](int sy) {
+            const uchar *row = bits + sy * stride;
+            return [=](int sx) {
+                const uchar *pair = row + (sx >> 1) * 4;
+                return YuvToRgb(pair[yOffset + (sx & 1) * 2], pair[uOffset], pair[vOffset]);
+            };
+        });
+        break;
+    }
+    case QVideoFrame::Format_NV12:
+    case QVideoFrame::Format_NV21: {
+        // A full-size luma plane, then interleaved chroma at half size in both directions
+        const uchar *luma = mapped.bits(0);
+        const uchar *chroma = mapped.bits(1);
+        const int lumaStride = mapped.bytesPerLine(0);
+        const int chromaStride = mapped.bytesPerLine(1);
+        const bool nv12 = mapped.pixelFormat() == QVideoFrame::Format_NV12;
+        const int uOffset = nv12 ? 0 : 1;
+        const int vOffset = nv12 ? 1 : 0;
+        Resample(target, w, h, flipX, flipY, [=](int sy) {
+            const uchar *yRow = luma + sy * lumaStride;
+            const uchar *uvRow = chroma + (sy >> 1) * chromaStride;
+            return [=](int sx) {
+                const uchar *uv = uvRow + (sx >> 1) * 2;
+                return YuvToRgb(yRow[sx], uv[uOffset], uv[vOffset]);
+            };
+        });
+        break;
+    }
+    case QVideoFrame::Format_YUV420P:
+    case QVideoFrame::Format_YV12: {
+        // Three planes; YV12 has V before U
+        const bool yv12 = mapped.pixelFormat() == QVideoFrame::Format_YV12;
+        const uchar *luma = mapped.bits(0);
+        const uchar *uPlane = mapped.bits(yv12 ? 2 : 1);
+        const uchar *vPlane = mapped.bits(yv12 ? 1 : 2);
+        const int lumaStride = mapped.bytesPerLine(0);
+        const int uStride = mapped.bytesPerLine(yv12 ? 2 : 1);
+        const int vStride = mapped.bytesPerLine(yv12 ? 1 : 2);
+        Resample(target, w, h, flipX, flipY, [=](int sy) {
+            const uchar *yRow = luma + sy * lumaStride;
+            const uchar *uRow = uPlane + (sy >> 1) * uStride;
+            const uchar *vRow = vPlane + (sy >> 1) * vStride;
+            return [=](int sx) {
+                return YuvToRgb(yRow[sx], uRow[sx >> 1], vRow[sx >> 1]);
+            };
+        });
+        break;
+    }
+    default:
+        converted = false;
+        break;
+    }
+
+    mapped.unmap();
+    return converted;
+}
+
+QImage VideoFrameConverter::ToImage (const QVideoFrame &frame)
+{
+    if (!frame.size().isValid()) {
+        return QImage();
+    }
+    QImage image (frame.size(), QImage::Format_RGB32);
+    if (!Convert(frame, image)) {
+        return QImage();
+    }
+    return image;
+}
@@ -0,0 +1,38 @@
+#ifndef VIDEOFRAMECONVERTER_H
+#define VIDEOFRAMECONVERTER_H
+
+#include <QImage>
+#include <QList>
+#include <QVideoFrame>
+
+/**
+ * @brief The VideoFrameConverter class turns camera frames into RGB images, straight from the
+ * pixel formats cameras actually deliver (the packed and planar YUV ones included), without going
+ * through QVideoFrame's own conversion, which older Qt versions don't have.
+ *
+ * Each target pixel is sampled from the nearest source pixel, so a target smaller than the frame
+ * only converts the pixels that are shown, and one the same size converts every pixel exactly.
+ */
+class VideoFrameConverter
+{
+public:
+    /**
+     * @brief GetSupportedPixelFormats returns the formats Convert() understands.
+     */
+    static QList<QVideoFrame::PixelFormat> GetSupportedPixelFormats ();
+
+    /**
+     * @brief Convert fills target, which must be a Format_RGB32 image of any size, from the frame,
+     * optionally mirrored in either direction. Returns false if the frame couldn't be mapped or is
+     * in a format that isn't supported.
+     */
+    static bool Convert (const QVideoFrame &frame, QImage &target, bool flipX = false, bool flipY = false);
+
+    /**
+     * @brief ToImage converts the whole frame at its own resolution. Returns a null image if it
+     * can't be converted.
+     */
+    static QImage ToImage (const QVideoFrame &frame);
+};
+
+#endif // VIDEOFRAMECONVERTER_H
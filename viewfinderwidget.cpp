@@ -0,0 +1,197 @@
+#include "viewfinderwidget.h"
+#include "videoframeconverter.h"
+
+#include <QDebug>
+#include <QMetaObject>
+#include <QPainter>
+#include <QPaintEvent>
+
+ViewfinderSurface::ViewfinderSurface (ViewfinderWidget *widget) :
+    QAbstractVideoSurface (widget),
+    _widget (widget)
+{
+}
+
+QList<QVideoFrame::PixelFormat> ViewfinderSurface::supportedPixelFormats (QAbstractVideoBuffer::HandleType type) const
+{
+    if (type != QAbstractVideoBuffer::NoHandle) {
+        return QList<QVideoFrame::PixelFormat>();
+    }
+    return VideoFrameConverter::GetSupportedPixelFormats();
+}
+
+bool ViewfinderSurface::start (const QVideoSurfaceFormat &format)
+{
+    _widget->clearFrame();
+    return QAbstractVideoSurface::start(format);
+}
+
+void ViewfinderSurface::stop ()
+{
+    _widget->clearFrame();
+    QAbstractVideoSurface::stop();
+}
+
+bool ViewfinderSurface::present (const QVideoFrame &frame)
+{
+    if (!_widget->presentFrame(frame, surfaceFormat().scanLineDirection())) {
+        setError(IncorrectFormatError);
+        return false;
+    }
+    return true;
+}
+
+
+
+ViewfinderWidget::ViewfinderWidget (QWidget *parent) :
+    QWidget (parent),
+    _overlayMode (OverlayMode::NONE),
+    _rotate180 (false),
+    _previousFrameChanged (false),
+    _hasFrame (false)
+{
+    _surface = new ViewfinderSurface (this);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+ViewfinderWidget::~ViewfinderWidget ()
+{
+    if (_surface->isActive()) {
+        _surface->stop();
+    }
+}
+
+QAbstractVideoSurface *ViewfinderWidget::videoSurface ()
+{
+    return _surface;
+}
+
+void ViewfinderWidget::setPreviousFrame (const QString &filename)
+{
+    // The file may not have been written yet, so it is only loaded when it's first shown
+    QMutexLocker lock (&_mutex);
+    _previousFrameFile = filename;
+    _previousFrameChanged = true;
+}
+
+void ViewfinderWidget::setOverlayMode (OverlayMode mode)
+{
+    QMutexLocker lock (&_mutex);
+    _overlayMode = mode;
+}
+
+ViewfinderWidget::OverlayMode ViewfinderWidget::getOverlayMode () const
+{
+    QMutexLocker lock (&_mutex);
+    return _overlayMode;
+}
+
+void ViewfinderWidget::setRotate180 (bool rotate)
+{
+    QMutexLocker lock (&_mutex);
+    _rotate180 = rotate;
+}
+
+bool ViewfinderWidget::hasFrame () const
+{
+    QMutexLocker lock (&_mutex);
+    return _hasFrame;
+}
+
+void ViewfinderWidget::clearFrame ()
+{
+    QMutexLocker lock (&_mutex);
+    _hasFrame = false;
+}
+
+void ViewfinderWidget::paintEvent (QPaintEvent *event)
+{
+    QPainter painter (this);
+    QMutexLocker lock (&_mutex);
+    QRect target (QPoint(0, 0), _display.size());
+    target.moveCenter(rect().center());
+    if (!target.contains(event->rect())) {
+        painter.fillRect(event->rect(), Qt::black);
+    }
+    if (!_display.isNull()) {
+        painter.drawImage(target.topLeft(), _display);
+    }
+}
+
+void ViewfinderWidget::resizeEvent (QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    QMutexLocker lock (&_mutex);
+    _viewSize = size();
+}
+
+bool ViewfinderWidget::presentFrame (const QVideoFrame &frame, QVideoSurfaceFormat::Direction scanLineDirection)
+{
+    QSize viewSize;
+    OverlayMode mode;
+    bool rotate;
+    QString previousFrameFile;
+    bool first;
+    {
+        QMutexLocker lock (&_mutex);
+        first = !_hasFrame;
+        _hasFrame = true;
+        viewSize = _viewSize;
+        mode = _overlayMode;
+        rotate = _rotate180;
+        if (_previousFrameChanged) {
+            previousFrameFile = _previousFrameFile;
+        }
+    }
+    if (first) {
+        // Even if the widget is still hidden: this is what says the camera is ready
+        emit firstFrame();
+    }
+    if (viewSize.isEmpty()) {
+        return true;
+    }
+
+    QSize displaySize = frame.size().scaled(viewSize, Qt::KeepAspectRatio);
+    if (_back.size() != displaySize) {
+        _back = QImage (displaySize, QImage::Format_RGB32);
+        _scaledPreviousFrame = QImage();
+    }
+
+    if (mode != OverlayMode::NONE) {
+        if (!previousFrameFile.isEmpty()) {
+            if (_previousFrame.load(previousFrameFile)) {
+                QMutexLocker lock (&_mutex);
+                _previousFrameChanged = false;
+            } else {
+                qDebug() << "Could not load the previous frame" << previousFrameFile;
+            }
+            _scaledPreviousFrame = QImage();
+        }
+        if (_scaledPreviousFrame.isNull() && !_previousFrame.isNull()) {
+            _scaledPreviousFrame = _previousFrame.scaled(displaySize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                                                 .convertToFormat(QImage::Format_RGB32);
+        }
+    }
+
+    if (mode == OverlayMode::PREVIOUS && !_scaledPreviousFrame.isNull()) {
+        // The live picture is hidden, so there's no need to convert it
+        _back = _scaledPreviousFrame.copy();
+    } else {
+        bool flipY = rotate != (scanLineDirection == QVideoSurfaceFormat::BottomToTop);
+        if (!VideoFrameConverter::Convert(frame, _back, rotate, flipY)) {
+            return false;
+        }
+        if (mode == OverlayMode::BLEND && !_scaledPreviousFrame.isNull()) {
+            QPainter painter (&_back);
+            painter.setCompositionMode(QPainter::CompositionMode_Screen);
+            painter.drawImage(0, 0, _scaledPreviousFrame);
+        }
+    }
+
+    {
+        QMutexLocker lock (&_mutex);
+        _display.swap(_back);
+    }
+    QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
+    return true;
+}
@@ -0,0 +1,111 @@
+#ifndef VIEWFINDERWIDGET_H
+#define VIEWFINDERWIDGET_H
+
+#include <QWidget>
+#include <QAbstractVideoSurface>
+#include <QVideoSurfaceFormat>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+class ViewfinderWidget;
+
+/**
+ * @brief The ViewfinderSurface class receives the camera's frames and hands them straight to
+ * its ViewfinderWidget.
+ */
+class ViewfinderSurface : public QAbstractVideoSurface
+{
+    Q_OBJECT
+
+public:
+    explicit ViewfinderSurface (ViewfinderWidget *widget);
+
+    QList<QVideoFrame::PixelFormat> supportedPixelFormats (QAbstractVideoBuffer::HandleType type) const override;
+
+    bool start (const QVideoSurfaceFormat &format) override;
+
+    void stop () override;
+
+    bool present (const QVideoFrame &frame) override;
+
+private:
+    ViewfinderWidget *_widget;
+};
+
+/**
+ * @brief The ViewfinderWidget class shows the live camera picture, optionally with the previous
+ * frame laid over it (the "onion skin").
+ *
+ * Each camera frame is converted exactly once, straight from the camera's pixel format into a
+ * display image at the size it will be shown, with the previous frame composited into that same
+ * image. Painting is then just a copy to the screen: nothing is scaled, transformed or rendered
+ * offscreen per frame, however large the camera's frames are.
+ */
+class ViewfinderWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    enum class OverlayMode {
+        NONE,
+        PREVIOUS, // Show only the previous frame
+        BLEND     // Screen the previous frame over the live picture
+    };
+
+    explicit ViewfinderWidget (QWidget *parent = nullptr);
+    ~ViewfinderWidget () override;
+
+    QAbstractVideoSurface *videoSurface ();
+
+    void setPreviousFrame (const QString &filename);
+
+    void setOverlayMode (OverlayMode mode);
+
+    OverlayMode getOverlayMode () const;
+
+    void setRotate180 (bool rotate);
+
+    /**
+     * @brief hasFrame returns true once a frame from the current camera session has been shown.
+     */
+    bool hasFrame () const;
+
+signals:
+    /**
+     * @brief firstFrame is emitted when the first frame of each camera session is shown: that's
+     * when the camera is really ready, whatever its status says.
+     */
+    void firstFrame ();
+
+protected:
+    void paintEvent (QPaintEvent *event) override;
+    void resizeEvent (QResizeEvent *event) override;
+
+private:
+    friend class ViewfinderSurface;
+
+    // Called on whichever thread the camera delivers its frames on
+    bool presentFrame (const QVideoFrame &frame, QVideoSurfaceFormat::Direction scanLineDirection);
+
+    void clearFrame ();
+
+    ViewfinderSurface *_surface;
+
+    // Shared with the camera's thread
+    mutable QMutex _mutex;
+    QImage _display;
+    QSize _viewSize;
+    OverlayMode _overlayMode;
+    bool _rotate180;
+    QString _previousFrameFile;
+    bool _previousFrameChanged;
+    bool _hasFrame;
+
+    // Only used on the camera's thread
+    QImage _back;
+    QImage _previousFrame;
+    QImage _scaledPreviousFrame;
+};
+
+#endif // VIEWFINDERWIDGET_H
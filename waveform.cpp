@@ -1,24 +1,36 @@
 #include "waveform.h"
 
 #include "utils.h"
-#include <iostream>
+#include <cmath>
+#include <QCursor>
+#include <QKeyEvent>
 #include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QWheelEvent>
 #include "settings.h"
 #include "settingsdialog.h"
 
+// Each zoom step (a wheel notch, or +/-) multiplies the zoom by this much
+static const double ZOOM_STEP = 1.25;
+
+// Zooming stops once a pixel is this short: enough to place a sound exactly on a frame
+static const double MIN_MILLIS_PER_PIXEL = 1.0;
+
 Waveform::Waveform(QWidget *parent) :
     QGraphicsView (parent),
     _totalLength (0),
     _selectionStart (0),
     _selectionLength (0),
     _playheadPosition (0),
-    _maxValue (0),
+    _zoom (1.0),
     _cursorLine (nullptr),
     _playheadLine (nullptr),
-    _playheadPixels (0)
+    _pixmapSceneX (0)
 {
     QGraphicsView::setScene(&_scene);
     _scene.setItemIndexMethod(QGraphicsScene::NoIndex);
+    this->setAlignment(Qt::AlignLeft | Qt::AlignTop);
     reset();
 }
 
@@ -32,93 +44,44 @@ void Waveform::reset()
     this->setMouseTracking(false);
     this->setDisabled(true);
     _scene.clear();
-    _scene.setSceneRect(0,0,this->width(), this->height());
+    _zoom = 1.0;
+    updateSceneRect();
     QPen cursorPen (QColor(0,0,0,100));
-    _cursorLine = _scene.addLine (0,0,0,this->height(), cursorPen);
+    _cursorLine = _scene.addLine (0,0,0,_scene.height(), cursorPen);
     _cursorLine->setZValue(1000);
     _cursorLine->hide();
     _cursorLine->setEnabled(false);
 
     QPen playheadPen (QColor(0,0,0,200));
-    _playheadLine = _scene.addLine (0,0,0,this->height(), playheadPen);
+    _playheadLine = _scene.addLine (0,0,0,_scene.height(), playheadPen);
     _playheadLine->setZValue(999);
     _playheadLine->hide();
     _playheadLine->setEnabled(false);
 
-    this->setHorizontalScrollBarPolicy (Qt::ScrollBarAlwaysOff);
     this->setVerticalScrollBarPolicy (Qt::ScrollBarAlwaysOff);
 
     _totalLength = 0;
     _selectionStart = 0;
     _selectionLength = 0;
     _playheadPosition = 0;
-    _maxValue = 0;
     _bufferComplete = false;
+
+    _peaks.reset();
+    invalidateWaveform();
 }
 
 
 void Waveform::setDuration (qint64 millis)
 {
     _totalLength = millis;
+    layoutItems();
 }
 
-void Waveform::addBuffer (const QAudioBuffer &buffer)
+void Waveform::setPeaks (PeakPyramidPointer peaks)
 {
     _bufferComplete = false;
-    if (_totalLength == 0) {
-        // Throw an error here, you have to set the length
-        // before adding buffers.
-    }
-
-    if (buffer.format().codec() != "audio/pcm") {
-        // Nothing to do with this buffer, it's not audio data
-        return;
-    }
-
-    // Start processing chunks:
-    if (!isPCMS16LE(buffer.format())) {
-        // Someday throw here
-        std::cerr << "This is not 16-bit PCM little endian" << std::endl;
-        return;
-    }
-
-    const qint16 *data = buffer.constData<qint16>();
-
-    qint64 startMicroseconds = buffer.startTime();
-    qreal microsecondsPerPixel = 1000.0 * qreal(_totalLength) / qreal(this->width());
-    int sampleRate = buffer.format().sampleRate();
-    qreal microsecondsPerSample = 1000000.0 / sampleRate;
-    qint64 startPixel = qint64(startMicroseconds / microsecondsPerPixel);
-    quint64 pixel = 0;
-
-    QVector<qreal> maxValues;
-    qreal max = 0.0;
-
-    // We don't really care if the audio is multi-channel or not: it's just getting displayed as
-    // the peak of whichever channel is highest
-    int numberOfSamplesInThisBuffer = buffer.sampleCount();
-    for (int sample = 0; sample < numberOfSamplesInThisBuffer; sample++) {
-        qreal v = fabs(pcmToReal(data[sample]));
-        max = std::max(max, v);
-        if ((sample+1) * microsecondsPerSample > (pixel+1)*microsecondsPerPixel) {
-            maxValues.append(max);
-            max = 0;
-            pixel++;
-        }
-    }
-    // In cases where this buffer isn't an even number of pixels wide, we cheat and just tack on one
-    // extra pixel, which looks better than one missing pixel.
-    maxValues.append(max);
-
-    for (int pixelOffset = 0; pixelOffset < maxValues.length(); pixelOffset++) {
-        qreal pixelValue = maxValues[pixelOffset];
-        // Draw a line on the graphics view at the right position
-        QGraphicsItem * line =
-          _scene.addLine(QLineF(pixelOffset+startPixel, this->height(), pixelOffset+startPixel,
-                                this->height() - pixelValue * this->height()),
-                         QPen(Qt::green, 1));
-        line->setEnabled(false); // Makes things faster, no need for these lines to get events
-    }
+    _peaks = peaks;
+    invalidateWaveform();
 }
 
 void Waveform::bufferComplete ()
@@ -134,20 +97,27 @@ void Waveform::bufferComplete ()
 
 void Waveform::setSelectionStart (qint64 millis)
 {
-    _selectionStart = millisToPixels(millis);
+    _selectionStart = millis;
     emit selectionRegionChanged(_selectionStart, _selectionLength);
 }
 
 void Waveform::setSelectionLength (qint64 millis)
 {
-    _selectionLength = millisToPixels(millis);
+    _selectionLength = millis;
     emit selectionRegionChanged(_selectionStart, _selectionLength);
 }
 
 void Waveform::setPlayheadPosition (qint64 millis)
 {
-    _playheadPosition = millisToPixels(millis);
-    _playheadLine->setX (_playheadPosition);
+    _playheadPosition = millis;
+    double x = millisToPixels(millis);
+    _playheadLine->setX (x);
+
+    // When zoomed in, page along with the playhead as it plays off the edge of the view
+    int left = horizontalScrollBar()->value();
+    if (_zoom > 1.0 && (x < left || x >= left + viewport()->width())) {
+        horizontalScrollBar()->setValue(int(x));
+    }
 }
 
 qint64 Waveform::getDuration () const
@@ -157,12 +127,12 @@ qint64 Waveform::getDuration () const
 
 qint64 Waveform::getPlayheadPosition () const
 {
-    return pixelsToMillis(_playheadPosition);
+    return _playheadPosition;
 }
 
 qint64 Waveform::getSelectionStart () const
 {
-    return pixelsToMillis(_selectionStart);
+    return _selectionStart;
 }
 
 qint64 Waveform::getSelectionLength () const
@@ -170,6 +140,26 @@ qint64 Waveform::getSelectionLength () const
     return _totalLength;
 }
 
+double Waveform::getZoom () const
+{
+    return _zoom;
+}
+
+void Waveform::zoomIn ()
+{
+    setZoom(_zoom * ZOOM_STEP, viewport()->width() / 2);
+}
+
+void Waveform::zoomOut ()
+{
+    setZoom(_zoom / ZOOM_STEP, viewport()->width() / 2);
+}
+
+void Waveform::zoomToFit ()
+{
+    setZoom(1.0, 0);
+}
+
 
 
 void Waveform::mousePressEvent(QMouseEvent *event)
@@ -179,7 +169,7 @@ void Waveform::mousePressEvent(QMouseEvent *event)
 
 void Waveform::mouseReleaseEvent(QMouseEvent *event)
 {
-    qint64 millis = pixelsToMillis(event->x());
+    qint64 millis = pixelsToMillis(sceneX(event));
     setPlayheadPosition(millis);
     QGraphicsView::mouseReleaseEvent(event);
     emit playheadManuallyChanged (millis);
@@ -187,23 +177,175 @@ void Waveform::mouseReleaseEvent(QMouseEvent *event)
 
 void Waveform::mouseMoveEvent(QMouseEvent *event)
 {
-    _cursorLine->setX (event->x());
+    _cursorLine->setX (sceneX(event));
     QGraphicsView::mouseMoveEvent (event);
 }
 
 void Waveform::resizeEvent(QResizeEvent *event)
 {
-    _scene.setSceneRect(this->rect());
     QGraphicsView::resizeEvent (event);
+    updateSceneRect();
+    layoutItems();
+    invalidateWaveform();
+}
+
+void Waveform::wheelEvent(QWheelEvent *event)
+{
+    if (event->modifiers() & Qt::ControlModifier) {
+        double notches = event->angleDelta().y() / 120.0;
+        setZoom(_zoom * std::pow(ZOOM_STEP, notches), viewport()->mapFromGlobal(QCursor::pos()).x());
+    } else {
+        // Either wheel direction scrolls along the file, an eighth of the view per notch
+        int delta = event->angleDelta().x() != 0 ? event->angleDelta().x() : event->angleDelta().y();
+        horizontalScrollBar()->setValue(horizontalScrollBar()->value() - delta * viewport()->width() / (8 * 120));
+    }
+    event->accept();
+}
+
+void Waveform::keyPressEvent(QKeyEvent *event)
+{
+    switch (event->key()) {
+    case Qt::Key_Plus:
+    case Qt::Key_Equal:
+        zoomIn();
+        break;
+    case Qt::Key_Minus:
+        zoomOut();
+        break;
+    case Qt::Key_0:
+        zoomToFit();
+        break;
+    default:
+        QGraphicsView::keyPressEvent(event);
+    }
+}
+
+void Waveform::drawBackground(QPainter *painter, const QRectF &rect)
+{
+    QGraphicsView::drawBackground(painter, rect);
+
+    // The cached image only covers the view: re-render it once it has been scrolled off
+    int visibleX = horizontalScrollBar()->value();
+    if (_peaks && (_waveformPixmap.isNull() || _waveformPixmap.size() != viewport()->size() ||
+                   _pixmapSceneX != visibleX)) {
+        _pixmapSceneX = visibleX;
+        renderWaveform();
+    }
+    if (!_waveformPixmap.isNull()) {
+        painter->drawPixmap(rect, _waveformPixmap, rect.translated(-_pixmapSceneX, 0));
+    }
+}
+
+void Waveform::layoutItems ()
+{
+    qreal h = _scene.height();
+    if (_cursorLine) {
+        _cursorLine->setLine(0, 0, 0, h);
+    }
+    if (_playheadLine) {
+        _playheadLine->setLine(0, 0, 0, h);
+        _playheadLine->setX(millisToPixels(_playheadPosition));
+    }
+}
+
+void Waveform::setZoom (double zoom, int anchorX)
+{
+    if (_totalLength <= 0 || viewport()->width() <= 0) {
+        return;
+    }
+    zoom = qBound(1.0, zoom, maximumZoom());
+    if (zoom == _zoom) {
+        return;
+    }
+    qint64 anchorMillis = pixelsToMillis(horizontalScrollBar()->value() + anchorX);
+    _zoom = zoom;
+    updateSceneRect();
+    layoutItems();
+    horizontalScrollBar()->setValue(int(millisToPixels(anchorMillis)) - anchorX);
+    invalidateWaveform();
+}
+
+double Waveform::maximumZoom () const
+{
+    if (viewport()->width() <= 0) {
+        return 1.0;
+    }
+    return std::max(1.0, double(_totalLength) / (viewport()->width() * MIN_MILLIS_PER_PIXEL));
 }
 
-qint64 Waveform::pixelsToMillis(qint64 pixels) const
+void Waveform::updateSceneRect ()
 {
-    return qint64(double(pixels) / double(_scene.width() * _totalLength));
+    this->setHorizontalScrollBarPolicy (_zoom > 1.0 ? Qt::ScrollBarAsNeeded : Qt::ScrollBarAlwaysOff);
+    _scene.setSceneRect(0, 0, viewport()->width() * _zoom, viewport()->height());
 }
 
+/**
+ * Draw the visible part of the waveform into the cached image
+ */
+void Waveform::renderWaveform ()
+{
+    QSize size = viewport()->size();
+    if (!_peaks || _peaks->IsEmpty() || size.isEmpty()) {
+        _waveformPixmap = QPixmap();
+        return;
+    }
+    _waveformPixmap = QPixmap(size);
+    _waveformPixmap.fill(Qt::transparent);
+
+    QVector<float> minimum, maximum;
+    double spp = samplesPerPixel();
+    _peaks->GetPeaks(_pixmapSceneX * spp, spp, size.width(), minimum, maximum);
+
+    int h = size.height();
+    QPainter painter (&_waveformPixmap);
+    painter.setPen(QPen(Qt::green, 1));
+    for (int x = 0; x < size.width(); x++) {
+        qreal peak = std::max(std::fabs(minimum[x]), std::fabs(maximum[x]));
+        if (peak > 0.0) {
+            painter.drawLine(QLineF(x, h, x, h - peak * h));
+        }
+    }
+}
+
+/**
+ * Throw away the cached image: it's redrawn the next time the background is painted
+ */
+void Waveform::invalidateWaveform ()
+{
+    _waveformPixmap = QPixmap();
+    _scene.invalidate(QRectF(), QGraphicsScene::BackgroundLayer);
+}
+
+/**
+ * The number of samples (per channel) each column covers at the current zoom
+ */
+double Waveform::samplesPerPixel () const
+{
+    if (!_peaks || _scene.width() <= 0) {
+        return 0.0;
+    }
+    qint64 duration = _totalLength > 0 ? _totalLength : _peaks->GetDurationMillis();
+    return double(duration) * _peaks->GetSampleRate() / 1000.0 / _scene.width();
+}
+
+qint64 Waveform::pixelsToMillis(double pixels) const
+{
+    if (_scene.width() <= 0) {
+        return 0;
+    }
+    return qint64(std::llround(pixels * double(_totalLength) / _scene.width()));
+}
+
+
+double Waveform::millisToPixels (qint64 millis) const
+{
+    if (_totalLength <= 0) {
+        return 0.0;
+    }
+    return double(millis) * _scene.width() / double(_totalLength);
+}
 
-qint64 Waveform::millisToPixels (qint64 millis) const
+double Waveform::sceneX (const QMouseEvent *event) const
 {
-    return qint64(double(millis) / double(_totalLength * _scene.width()));
+    return mapToScene(event->pos()).x();
 }
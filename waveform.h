@@ -2,16 +2,29 @@
 #define WAVEFORM_H
 
 #include <QGraphicsView>
-#include <QAudioBuffer>
 #include <QGraphicsRectItem>
 #include <QGraphicsLineItem>
+#include <QPixmap>
 #include <QTime>
+#include <QVector>
+
+#include "peakpyramid.h"
 
 
 /**
  * @brief The Waveform class displays an audio waveform and allows interaction
  * with it to set a cursor position (for a playhead) and a selection (to grab
  * a subset of the whole audio file).
+ *
+ * The waveform can be zoomed (Ctrl+wheel, or +, - and 0 to fit) and scrolled (the wheel or the
+ * scroll bar). The scene is the whole file at the current zoom, so items are placed in scene
+ * pixels; positions themselves are all kept in milliseconds, and subclasses re-place their items
+ * in layoutItems() whenever the zoom or size changes.
+ *
+ * The visible part of the waveform is drawn into a cached pixmap, which is blitted as the
+ * scene's background: only the playhead, cursor and selection are scene items. The
+ * pixmap is drawn from a PeakPyramid, so zooming or scrolling costs one column per pixel
+ * however long the file is.
  */
 class Waveform : public QGraphicsView
 {
@@ -26,7 +39,7 @@ public:
 
     void setDuration (qint64 millis);
 
-    void addBuffer (const QAudioBuffer &buffer);
+    void setPeaks (PeakPyramidPointer peaks);
 
     void bufferComplete ();
 
@@ -44,10 +57,27 @@ public:
 
     virtual qint64 getSelectionLength () const;
 
+    /**
+     * @brief getZoom returns how many times wider than the view the whole file is drawn (1 fits it).
+     */
+    double getZoom () const;
+
+public slots:
+
+    void zoomIn ();
+
+    void zoomOut ();
+
+    void zoomToFit ();
+
 signals:
 
     void playheadManuallyChanged (qint64 millis);
 
+    /**
+     * @brief selectionRegionChanged is emitted with the selection's start and length in milliseconds.
+     * The length is negative while a selection is being dragged out to the left.
+     */
     void selectionRegionChanged (qint64 start, qint64 length);
 
 protected:
@@ -55,10 +85,31 @@ protected:
     virtual void mouseReleaseEvent(QMouseEvent *event);
     virtual void mouseMoveEvent(QMouseEvent *event);
     virtual void resizeEvent(QResizeEvent *event);
-    //virtual void paintEvent(QPaintEvent *event);
+    virtual void wheelEvent(QWheelEvent *event);
+    virtual void keyPressEvent(QKeyEvent *event);
+    virtual void drawBackground(QPainter *painter, const QRectF &rect);
+
+    /**
+     * @brief layoutItems moves the scene items to match the current zoom and size.
+     */
+    virtual void layoutItems ();
+
+    /**
+     * @brief setZoom zooms about a point in the view, which stays over the same time.
+     */
+    void setZoom (double zoom, int anchorX);
+    double maximumZoom () const;
+    void updateSceneRect ();
+
+    void renderWaveform ();
+    void invalidateWaveform ();
+    double samplesPerPixel () const;
+
+    // Between scene x coordinates and times in the file
+    qint64 pixelsToMillis(double pixels) const;
+    double millisToPixels (qint64 millis) const;
 
-    qint64 pixelsToMillis(qint64 pixels) const;
-    qint64 millisToPixels (qint64 millis) const;
+    double sceneX (const QMouseEvent *event) const;
 
 protected:
     QGraphicsScene _scene;
@@ -66,14 +117,16 @@ protected:
     qint64 _selectionStart;
     qint64 _selectionLength;
     qint64 _playheadPosition;
-    qreal _maxValue;
     bool _bufferComplete;
+    double _zoom;
 
     // Elements in the scene that we need to change over time:
     QGraphicsLineItem *_cursorLine;
     QGraphicsLineItem *_playheadLine;
 
-    qint64 _playheadPixels;
+    PeakPyramidPointer _peaks;
+    QPixmap _waveformPixmap;
+    int _pixmapSceneX; // Where the cached image starts in the scene
 };
 
 #endif // WAVEFORM_H
@@ -0,0 +1,116 @@
+#include "waveformloader.h"
+#include "plsexception.h"
+
+#include "audioinputstream.h"
+
+#include <QDebug>
+
+extern "C" {
+    #include <libavutil/samplefmt.h>
+}
+
+/**
+ * The decoders produce 16-bit or float samples for nearly everything, and those go straight to
+ * the peak kernels in whatever layout the decoder used. Anything else is converted to float.
+ */
+static void AddFrame (PeakPyramid &pyramid, const AVFrame *frame, QVector<float> &converted)
+{
+    const int frames = frame->nb_samples;
+    const int channels = frame->channels;
+    const AVSampleFormat format = AVSampleFormat(frame->format);
+    switch (format) {
+    case AV_SAMPLE_FMT_S16:
+        pyramid.AddSamples(reinterpret_cast<const qint16 *>(frame->extended_data[0]), frames, channels);
+        return;
+    case AV_SAMPLE_FMT_S16P:
+        pyramid.AddPlanarSamples(reinterpret_cast<const qint16 *const *>(frame->extended_data), frames, channels);
+        return;
+    case AV_SAMPLE_FMT_FLT:
+        pyramid.AddSamples(reinterpret_cast<const float *>(frame->extended_data[0]), frames, channels);
+        return;
+    case AV_SAMPLE_FMT_FLTP:
+        pyramid.AddPlanarSamples(reinterpret_cast<const float *const *>(frame->extended_data), frames, channels);
+        return;
+    default:
+        break;
+    }
+
+    const bool planar = av_sample_fmt_is_planar(format);
+    const AVSampleFormat packed = av_get_packed_sample_fmt(format);
+    converted.resize(frames * channels);
+    for (int channel = 0; channel < channels; ++channel) {
+        const uint8_t *data = frame->extended_data[planar ? channel : 0];
+        for (int sample = 0; sample < frames; ++sample) {
+            int index = planar ? sample : sample * channels + channel;
+            float value = 0.0f;
+            switch (packed) {
+            case AV_SAMPLE_FMT_U8:
+                value = (float(data[index]) - 128.0f) / 128.0f;
+                break;
+            case AV_SAMPLE_FMT_S32:
+                value = float(reinterpret_cast<const qint32 *>(data)[index] / 2147483648.0);
+                break;
+            case AV_SAMPLE_FMT_DBL:
+                value = float(reinterpret_cast<const double *>(data)[index]);
+                break;
+            default:
+                break;
+            }
+            converted[sample * channels + channel] = value;
+        }
+    }
+    pyramid.AddSamples(converted.constData(), frames, channels);
+}
+
+WaveformLoader::WaveformLoader(QObject *parent) :
+    QThread (parent)
+{
+    qRegisterMetaType<PeakPyramidPointer>();
+}
+
+WaveformLoader::~WaveformLoader()
+{
+    requestInterruption();
+    wait();
+}
+
+void WaveformLoader::Load (const QString &filename)
+{
+    requestInterruption();
+    wait();
+    _filename = filename;
+    start();
+}
+
+void WaveformLoader::run()
+{
+    QString filename = _filename;
+    QString cacheFilename = PeakPyramid::GetCacheFilename(filename);
+    auto cached = std::make_shared<PeakPyramid>();
+    if (cached->Load(cacheFilename)) {
+        emit loadFinished(filename, cached);
+        return;
+    }
+
+    try {
+        AudioInputStream stream (filename);
+        PeakPyramid pyramid (stream.GetCodecContext()->sample_rate);
+        QVector<float> converted;
+        while (AVFrame *frame = stream.GetNextFrame()) {
+            if (isInterruptionRequested()) {
+                return;
+            }
+            AddFrame(pyramid, frame, converted);
+        }
+        pyramid.Finish();
+        try {
+            pyramid.Save(cacheFilename);
+        } catch (const PLSException &e) {
+            qDebug() << e.message();
+        }
+        emit loadFinished(filename, std::make_shared<PeakPyramid>(pyramid));
+    } catch (const PLSException &e) {
+        qDebug() << "Could not decode" << filename << ":" << e.message();
+        emit loadFailed(filename, e.message());
+    }
+}
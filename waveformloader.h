@@ -0,0 +1,44 @@
+#ifndef WAVEFORMLOADER_H
+#define WAVEFORMLOADER_H
+
+#include <QThread>
+#include <QMetaType>
+#include <QString>
+
+#include "peakpyramid.h"
+
+/**
+ * @brief The WaveformLoader class builds the peak pyramid of an audio file on its own thread,
+ * so that decoding a long music file never holds up the GUI. If the file has been loaded before
+ * its pyramid comes straight from the cache; otherwise the file is decoded with FFmpeg at its own
+ * sample rate and format (there is nothing to gain from resampling just to draw it), and the
+ * finished pyramid is saved to the cache and sent back once.
+ */
+class WaveformLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    WaveformLoader(QObject *parent = nullptr);
+    ~WaveformLoader() override;
+
+    /**
+     * @brief Load starts loading a file, abandoning any load that is still running.
+     */
+    void Load (const QString &filename);
+
+    void run() Q_DECL_OVERRIDE;
+
+signals:
+
+    void loadFinished (const QString &filename, PeakPyramidPointer peaks);
+
+    void loadFailed (const QString &filename, const QString &message);
+
+private:
+    QString _filename;
+};
+
+Q_DECLARE_METATYPE(PeakPyramidPointer)
+
+#endif // WAVEFORMLOADER_H